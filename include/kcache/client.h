@@ -1,17 +1,30 @@
 #ifndef KCACHE_CLIENT_H_
 #define KCACHE_CLIENT_H_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <etcd/Client.hpp>
 #include <etcd/Watcher.hpp>
 
 #include "kcache/consistent_hash.h"
+#include "kcache/loader_pool.h"
+
+namespace grpc {
+class Status;
+}  // namespace grpc
 
 namespace kcache {
 
@@ -24,15 +37,53 @@ public:
     KCacheClient(const KCacheClient&) = delete;
     KCacheClient& operator=(const KCacheClient&) = delete;
 
-    // 获取缓存
+    // 获取缓存，节点标记为热点的 key 会在一段时间内把读请求随机分散到所有节点
     auto Get(const std::string& group, const std::string& key) -> std::optional<std::string>;
 
-    // 设置缓存
-    bool Set(const std::string& group, const std::string& key, const std::string& value);
+    // 获取缓存及其版本号，用于之后的 CompareAndSet
+    auto GetVersioned(const std::string& group, const std::string& key)
+        -> std::optional<std::pair<std::string, uint64_t>>;
+
+    // 设置缓存，owner 节点写入成功后即返回，其他节点的失效通知在后台异步发送
+    bool Set(const std::string& group, const std::string& key, const std::string& value,
+             const std::vector<std::string>& tags = {});
 
-    // 删除缓存
+    // 删除缓存，owner 节点删除成功后即返回，其他节点的失效通知在后台异步发送
     bool Delete(const std::string& group, const std::string& key);
 
+    // 条件写入：owner 节点上的版本号等于 expected_version 时才写入，0 表示仅在不存在时写入
+    bool CompareAndSet(const std::string& group, const std::string& key, const std::string& value,
+                       uint64_t expected_version);
+
+    // 在 owner 节点上原子地加减计数器，一次往返，返回新值
+    auto Incr(const std::string& group, const std::string& key, int64_t delta) -> std::optional<int64_t>;
+
+    // 在 owner 节点上原子地追加数据
+    bool Append(const std::string& group, const std::string& key, const std::string& suffix);
+
+    // 在所有节点上失效带有该标签的缓存，每个节点只需一次 RPC，全部节点成功时返回 true
+    bool InvalidateTag(const std::string& group, const std::string& tag);
+
+    // 在所有节点上失效以 prefix 开头的缓存
+    bool InvalidatePrefix(const std::string& group, const std::string& prefix);
+
+    // 清空所有节点上的缓存组，如数据迁移后使用
+    bool Flush(const std::string& group);
+
+    // 尚未送达的失效通知数
+    auto PendingInvalidations() -> size_t;
+
+    // 等待失效通知全部送达，超时返回 false
+    bool WaitInvalidations(std::chrono::milliseconds timeout);
+
+    // 回源函数，返回空表示数据源中不存在
+    using Loader = std::function<std::optional<std::string>()>;
+
+    // 带租约的读取：未命中时只有拿到租约的调用方执行 loader 并写回缓存，
+    // 其他调用方先使用失效前的旧值，没有旧值时稍后重试，避免 key 失效后所有调用方同时回源
+    auto GetOrLoad(const std::string& group, const std::string& key, const Loader& loader)
+        -> std::optional<std::string>;
+
 private:
     // 服务发现相关
     bool StartServiceDiscovery();
@@ -41,7 +92,36 @@ private:
     auto ParseAddrFromKey(const std::string& key) -> std::string;
     auto GetCacheNode(const std::string& key) -> std::string;
 
+    // 负载上报相关：定期拉取各节点的 Stats，驱动一致性哈希的再平衡
+    void LoadReportLoop();
+    void CollectNodeLoads();
+
+    // 与单个缓存节点的连接及其失效队列，定义在 client_sdk.cpp 中
+    struct Peer;
+
+    // 获取到节点的连接，复用 stub；集群成员的连接不存在时创建并启动失效队列，节点下线时由 HandleWatchEvents 停止，
+    // 不在集群中的节点返回不带失效队列的临时连接
+    auto GetPeer(const std::string& addr) -> std::shared_ptr<Peer>;
+
+    // 失效通知：按节点排队，同一个 key 的失效会被合并，由每个节点各自的后台线程批量发送
+    void EnqueueInvalidation(const std::string& group, const std::string& key, const std::string& owner);
+
+    // 热点 key：节点在响应中标记后，客户端在一段时间内把读请求分散到随机节点
+    auto IsHotKey(const std::string& group, const std::string& key) -> bool;
+    void MarkHotKey(const std::string& group, const std::string& key);
+    auto PickReplica(const std::string& owner) -> std::string;
+
+    // 并行地在所有节点上执行一次调用，全部成功时返回 true
+    bool Broadcast(const std::function<grpc::Status(Peer* peer)>& call);
+
 private:
+    // 节点上一次的负载采样，用于计算速率
+    struct LoadSample {
+        int64_t cpu_time_ns;
+        int64_t requests;
+        std::chrono::steady_clock::time_point at;
+    };
+
     std::string service_name_;
     std::shared_ptr<etcd::Client> etcd_client_;
 
@@ -52,6 +132,22 @@ private:
     std::unique_ptr<etcd::Watcher> etcd_watcher_;
 
     ConsistentHashMap consistent_hash_;
+
+    std::unordered_map<std::string, LoadSample> load_samples_;
+    std::thread load_report_thread_;
+    std::atomic<bool> is_stop_{false};
+    std::mutex stop_mtx_;
+    std::condition_variable stop_cv_;
+
+    std::unordered_map<std::string, std::shared_ptr<Peer>> peers_;
+    std::mutex peers_mtx_;  // 需要同时持有 nodes_mutex_ 时先锁 nodes_mutex_
+
+    // group + '\0' + key -> 停止分散读请求的时间
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> hot_keys_;
+    std::mutex hot_mtx_;
+
+    // Broadcast 共用的有界线程池
+    LoaderPool broadcast_pool_;
 };
 
 }  // namespace kcache
@@ -0,0 +1,55 @@
+#include "kcache/ghost_cache.h"
+
+#include <functional>
+
+namespace kcache {
+
+void GhostCache::Add(const std::string& key, int64_t bytes) {
+    auto max_bytes = MaxBytes();
+    if (max_bytes == 0 || bytes > max_bytes) {
+        return;
+    }
+    auto hash = std::hash<std::string>{}(key);
+    std::lock_guard lock{mtx_};
+    if (auto it = index_.find(hash); it != index_.end()) {
+        bytes_ -= it->second->second;
+        list_.erase(it->second);
+    }
+    list_.emplace_front(hash, bytes);
+    index_[hash] = list_.begin();
+    bytes_ += bytes;
+    Trim(max_bytes);
+}
+
+bool GhostCache::Hit(const std::string& key) {
+    if (MaxBytes() == 0) {
+        return false;
+    }
+    auto hash = std::hash<std::string>{}(key);
+    std::lock_guard lock{mtx_};
+    auto it = index_.find(hash);
+    if (it == index_.end()) {
+        return false;
+    }
+    bytes_ -= it->second->second;
+    list_.erase(it->second);
+    index_.erase(it);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void GhostCache::SetMaxBytes(int64_t max_bytes) {
+    std::lock_guard lock{mtx_};
+    max_bytes_.store(max_bytes, std::memory_order_relaxed);
+    Trim(max_bytes);
+}
+
+void GhostCache::Trim(int64_t max_bytes) {
+    while (!list_.empty() && bytes_ > max_bytes) {
+        bytes_ -= list_.back().second;
+        index_.erase(list_.back().first);
+        list_.pop_back();
+    }
+}
+
+}  // namespace kcache
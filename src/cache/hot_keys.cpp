@@ -0,0 +1,121 @@
+#include "kcache/hot_keys.h"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace kcache {
+
+// 采样数太少时比例不可靠，不判定热点
+constexpr int64_t kMinHotSamples = 100;
+// 除了窗口衰减时，每采样这么多次也重新发布热点集合，窗口较大时新的热点同样能及时生效
+constexpr int64_t kPublishInterval = 1024;
+
+HotKeySketch::HotKeySketch(size_t capacity, int sample_rate, int64_t window, double ratio)
+    : capacity_(std::max<size_t>(capacity, 1)),
+      sample_rate_(std::max(sample_rate, 1)),
+      window_(std::max<int64_t>(window, kMinHotSamples)),
+      ratio_(ratio) {}
+
+void HotKeySketch::Record(const std::string& key) {
+    if (sample_rate_ > 1) {
+        // 每个线程各自生成随机数决定是否采样，未采样的访问不需要加锁
+        thread_local uint64_t state = std::hash<std::thread::id>{}(std::this_thread::get_id()) | 1;
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        if (state % sample_rate_ != 0) {
+            return;
+        }
+    }
+
+    std::lock_guard lock{mtx_};
+    ++total_;
+    auto it = counters_.find(key);
+    if (it != counters_.end()) {
+        order_.erase({it->second.count, key});
+        ++it->second.count;
+        order_.emplace(it->second.count, key);
+    } else if (counters_.size() < capacity_) {
+        counters_.emplace(key, Counter{1, 0});
+        order_.emplace(1, key);
+    } else {
+        // 替换计数最小的 key，新 key 继承它的计数，被继承的部分就是估计误差
+        auto min = order_.begin();
+        int64_t count = min->first;
+        counters_.erase(min->second);
+        order_.erase(min);
+        counters_.emplace(key, Counter{count + 1, count});
+        order_.emplace(count + 1, key);
+    }
+    if (total_ >= window_) {
+        Decay();
+        Publish();
+    } else if (++since_publish_ >= kPublishInterval) {
+        Publish();
+    }
+}
+
+auto HotKeySketch::IsHot(const std::string& key) const -> bool {
+    const auto& set = hot_sets_[current_.load(std::memory_order_acquire)];
+    auto size = set.size.load(std::memory_order_acquire);
+    if (size == 0) {
+        return false;
+    }
+    auto hash = std::hash<std::string>{}(key);
+    for (size_t i = 0; i < size; ++i) {
+        if (set.hashes[i].load(std::memory_order_relaxed) == hash) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto HotKeySketch::TopK(size_t k) -> std::vector<HotKey> {
+    std::lock_guard lock{mtx_};
+    std::vector<HotKey> keys;
+    keys.reserve(std::min(k, order_.size()));
+    for (auto it = order_.rbegin(); it != order_.rend() && keys.size() < k; ++it) {
+        keys.push_back(HotKey{it->second, it->first, counters_[it->second].error});
+    }
+    return keys;
+}
+
+void HotKeySketch::Publish() {
+    since_publish_ = 0;
+    auto next = 1 - current_.load(std::memory_order_relaxed);
+    auto& set = hot_sets_[next];
+    size_t size = 0;
+    if (total_ >= kMinHotSamples) {
+        auto threshold = ratio_ * static_cast<double>(total_);
+        // 计数从高到低，count 低于阈值后 count - error 也不会达到
+        for (auto it = order_.rbegin(); it != order_.rend() && size < kMaxHotKeys; ++it) {
+            if (static_cast<double>(it->first) < threshold) {
+                break;
+            }
+            const auto& counter = counters_[it->second];
+            if (static_cast<double>(counter.count - counter.error) >= threshold) {
+                set.hashes[size++].store(std::hash<std::string>{}(it->second), std::memory_order_relaxed);
+            }
+        }
+    }
+    set.size.store(size, std::memory_order_release);
+    current_.store(next, std::memory_order_release);
+}
+
+void HotKeySketch::Decay() {
+    total_ /= 2;
+    order_.clear();
+    for (auto it = counters_.begin(); it != counters_.end();) {
+        it->second.count /= 2;
+        it->second.error /= 2;
+        if (it->second.count == 0) {
+            it = counters_.erase(it);
+            continue;
+        }
+        order_.emplace(it->second.count, it->first);
+        ++it;
+    }
+}
+
+}  // namespace kcache
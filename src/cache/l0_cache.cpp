@@ -0,0 +1,37 @@
+#include "kcache/l0_cache.h"
+
+#include <utility>
+
+namespace kcache {
+
+auto L0Cache::Local() -> L0Cache& {
+    thread_local L0Cache cache;
+    return cache;
+}
+
+auto L0Cache::Find(uint64_t owner, size_t hash, const std::string& key) -> L0Entry* {
+    auto& slot = slots_[Index(owner, hash)];
+    if (slot.owner != owner || slot.hash != hash || slot.key != key) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+void L0Cache::Put(L0Entry entry) {
+    auto index = Index(entry.owner, entry.hash);
+    auto& slot = slots_[index];
+    if (slot.owner != entry.owner || slot.hash != entry.hash || slot.key != entry.key) {
+        auto tag = entry.hash ^ entry.owner;
+        if (candidates_[index] != tag) {
+            candidates_[index] = tag;
+            return;
+        }
+    }
+    slot = std::move(entry);
+}
+
+auto L0Cache::Index(uint64_t owner, size_t hash) -> size_t {
+    return (hash ^ (owner * 0x9E3779B97F4A7C15ULL)) % kSlots;
+}
+
+}  // namespace kcache
@@ -1,69 +1,317 @@
 #include "kcache/cache.h"
 
+#include <algorithm>
+#include <chrono>
 #include <mutex>
 #include <optional>
 
+#include "kcache/trace.h"
+
 namespace kcache {
 
+// 每次写入时顺带回收的旧代数缓存项数量上限，避免单次写入耗时过长
+constexpr int kReclaimPerWrite = 2;
+
+auto CachePolicyName(CachePolicy policy) -> std::string {
+    switch (policy) {
+        case CachePolicy::kLru:
+            return "lru";
+        case CachePolicy::kGdsf:
+            return "gdsf";
+    }
+    return "unknown";
+}
+
+bool ParseCachePolicy(const std::string& name, CachePolicy* policy) {
+    if (name == "lru") {
+        *policy = CachePolicy::kLru;
+    } else if (name == "gdsf") {
+        *policy = CachePolicy::kGdsf;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+LRUCache::LRUCache(int max_bytes, const EvictedFunc& evicted_func, const EvictedFunc& overflow_func)
+    : max_bytes_(max_bytes),
+      next_version_(std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::system_clock::now().time_since_epoch())
+                        .count()),
+      evicted_func_(evicted_func),
+      overflow_func_(overflow_func) {}
+
 auto LRUCache::Get(const std::string& key) -> ByteViewOptional {
+    auto entry = Lookup(key);
+    if (!entry || entry->IsExpired(NowNs())) {
+        return std::nullopt;
+    }
+    return std::move(entry->value_);
+}
+
+auto LRUCache::Lookup(const std::string& key) -> std::optional<Entry> {
+    TraceSpan wait{TraceStage::kCacheLock};
     std::lock_guard lock{mtx_};
-    if (cache_.find(key) == cache_.end()) {
+    wait.End();
+    TraceSpan span{TraceStage::kCacheLookup};
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
         return std::nullopt;
     }
-    auto ele = cache_[key];
-    auto [k, value] = *ele;
-    list_.erase(ele);
-    list_.emplace_front(key, value);
-    cache_[key] = list_.begin();
-    return value;
+    if (it->second->generation_ < Generation()) {
+        // 已被 Flush 清空，顺便回收
+        Remove(it->second);
+        return std::nullopt;
+    }
+    // 移动到链表头部，迭代器保持有效
+    list_.splice(list_.begin(), list_, it->second);
+    auto& entry = *it->second;
+    ++entry.frequency_;
+    if (Policy() == CachePolicy::kGdsf) {
+        Reprioritize(entry);
+    }
+    return entry;
 }
 
-void LRUCache::Set(const std::string& key, const ByteView& value) {
+auto LRUCache::Set(const std::string& key, const ByteView& value, int64_t expire_at, int64_t cost) -> uint64_t {
+    TraceSpan wait{TraceStage::kCacheLock};
     std::lock_guard lock{mtx_};
+    wait.End();
+    TraceSpan span{TraceStage::kCacheInsert};
+    return Insert(key, value, expire_at, cost);
+}
+
+auto LRUCache::Update(const std::string& key, const UpdateFunc& fn, int64_t expire_at) -> std::optional<Entry> {
+    std::lock_guard lock{mtx_};
+    auto it = FindLive(key);
+    auto value = fn(it == list_.end() ? nullptr : &*it);
+    if (!value) {
+        return std::nullopt;
+    }
+    auto version = Insert(key, *value, expire_at, 0);
+    return Entry{key, std::move(*value), expire_at, Generation(), version};
+}
+
+auto LRUCache::Insert(const std::string& key, const ByteView& value, int64_t expire_at, int64_t cost) -> uint64_t {
+    ReclaimStale(kReclaimPerWrite);
+    if (cost > 0) {
+        cost_total_ += cost;
+        ++cost_samples_;
+    }
+    int64_t frequency = 1;
     if (cache_.find(key) != cache_.end()) {
-        // remove old
+        // remove old，覆盖写入沿用原来的访问次数，没有给出代价时沿用原来的代价
         auto ele = cache_[key];
         bytes_ += value.Len() - ele->value_.Len();
+        frequency = ele->frequency_;
+        cost = cost != 0 ? cost : ele->cost_;
+        priorities_.erase({ele->priority_, &*ele});
         list_.erase(ele);
     } else {
         bytes_ += key.size() + value.Len();
+        // 迁移来的数据、热点副本等没有实测代价，按平均代价估计，避免被当作最廉价的缓存项最先淘汰
+        if (cost == 0 && cost_samples_ > 0) {
+            cost = cost_total_ / cost_samples_;
+        }
     }
     // insert new
-    list_.emplace_front(key, value);
+    auto version = ++next_version_;
+    auto& entry = list_.emplace_front(key, value, expire_at, Generation(), version);
+    entry.cost_ = cost;
+    entry.frequency_ = frequency;
+    if (Policy() == CachePolicy::kGdsf) {
+        entry.priority_ = Priority(entry);
+        priorities_.emplace(entry.priority_, &entry);
+    }
     cache_[key] = list_.begin();
 
-    // 当 LRUCache 中还有缓存时，如果此时 LRUCache 中的容量超过规定大小，就不断将最久未使用的缓存淘汰
-    while (max_bytes_ != 0 && bytes_ > max_bytes_ && !list_.empty()) {
-        RemoveOldest();
+    // 当 LRUCache 中还有缓存时，如果此时 LRUCache 中的容量超过规定大小，就不断按淘汰策略淘汰缓存
+    auto max_bytes = MaxBytes();
+    while (max_bytes != 0 && bytes_ > max_bytes && !list_.empty()) {
+        Evict();
     }
+    Publish();
+    return version;
 }
 
-void LRUCache::Delete(const std::string& key) {
+void LRUCache::AddFrequency(const std::string& key, int64_t hits) {
     std::lock_guard lock{mtx_};
-    if (cache_.find(key) == cache_.end()) {
+    auto it = FindLive(key);
+    if (it == list_.end()) {
         return;
     }
-    auto elem_iter = cache_[key];
-    auto [_, value] = *elem_iter;
-    list_.erase(elem_iter);
-    cache_.erase(key);
-    bytes_ -= key.size() + value.Len();
-    if (evicted_func_) {
-        evicted_func_(key, value);
+    it->frequency_ += hits;
+    if (Policy() == CachePolicy::kGdsf) {
+        Reprioritize(*it);
     }
 }
 
+auto LRUCache::FindLive(const std::string& key) -> ListElementIter {
+    auto it = cache_.find(key);
+    if (it == cache_.end() || it->second->generation_ < Generation() || it->second->IsExpired(NowNs())) {
+        return list_.end();
+    }
+    return it->second;
+}
+
+void LRUCache::Delete(const std::string& key) {
+    std::lock_guard lock{mtx_};
+    auto it = cache_.find(key);
+    if (it == cache_.end()) {
+        return;
+    }
+    Remove(it->second);
+}
+
 void LRUCache::RemoveOldest() {
     if (list_.empty()) {
         return;
     }
-    auto [key, value] = list_.back();
+    Remove(std::prev(list_.end()));
+}
+
+void LRUCache::Remove(ListElementIter it) {
+    auto key = std::move(it->key_);
+    auto value = std::move(it->value_);
     cache_.erase(key);
-    list_.pop_back();
+    priorities_.erase({it->priority_, &*it});
+    list_.erase(it);
     bytes_ -= key.size() + value.Len();
+    Publish();
     if (evicted_func_) {
         evicted_func_(key, value);
     }
 }
 
-}  // namespace kcache
\ No newline at end of file
+void LRUCache::Evict() {
+    // 已被 Flush 的缓存项不会再被访问，总是排在链表尾部，两种策略下都先回收它们
+    auto victim = std::prev(list_.end());
+    bool is_live = victim->generation_ >= Generation();
+    if (is_live && Policy() == CachePolicy::kGdsf && !priorities_.empty()) {
+        victim = cache_[priorities_.begin()->second->key_];
+        inflation_ = victim->priority_;
+    }
+    // 已被 Flush 的缓存项只是在回收，不算容量淘汰，也不计入淘汰数
+    if (overflow_func_ && is_live) {
+        overflow_func_(victim->key_, victim->value_);
+    }
+    Remove(victim);
+    if (is_live) {
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+auto LRUCache::Priority(const Entry& entry) const -> double {
+    // 代价未知时按 1 纳秒计，即认为重新加载很便宜
+    auto cost = static_cast<double>(std::max<int64_t>(entry.cost_, 1));
+    auto size = static_cast<double>(std::max<int64_t>(entry.key_.size() + entry.value_.Len(), 1));
+    return inflation_ + static_cast<double>(entry.frequency_) * cost / size;
+}
+
+void LRUCache::Reprioritize(Entry& entry) {
+    // 复用集合的节点，命中时不需要释放再分配内存，只剩 O(log n) 的重新排序
+    auto node = priorities_.extract({entry.priority_, &entry});
+    entry.priority_ = Priority(entry);
+    if (node) {
+        node.value().first = entry.priority_;
+        priorities_.insert(std::move(node));
+    } else {
+        priorities_.emplace(entry.priority_, &entry);
+    }
+}
+
+void LRUCache::SetPolicy(CachePolicy policy) {
+    std::lock_guard lock{mtx_};
+    if (policy == Policy()) {
+        return;
+    }
+    policy_.store(policy, std::memory_order_relaxed);
+    priorities_.clear();
+    if (policy == CachePolicy::kGdsf) {
+        inflation_ = 0;
+        for (auto& entry : list_) {
+            entry.priority_ = Priority(entry);
+            priorities_.emplace(entry.priority_, &entry);
+        }
+    }
+}
+
+void LRUCache::ReclaimStale(int n) {
+    auto generation = Generation();
+    for (int i = 0; i < n && !list_.empty() && list_.back().generation_ < generation; ++i) {
+        RemoveOldest();
+    }
+}
+
+bool LRUCache::SetIfAbsent(const std::string& key, const ByteView& value, int64_t expire_at, int64_t cost) {
+    std::lock_guard lock{mtx_};
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+        if (it->second->generation_ >= Generation()) {
+            return false;
+        }
+        Remove(it->second);
+    }
+    Insert(key, value, expire_at, cost);
+    return cache_.find(key) != cache_.end();
+}
+
+auto LRUCache::Peek(const std::string& key) -> ByteViewOptional {
+    std::lock_guard lock{mtx_};
+    auto it = cache_.find(key);
+    if (it == cache_.end() || it->second->generation_ < Generation()) {
+        return std::nullopt;
+    }
+    return it->second->value_;
+}
+
+auto LRUCache::PeekEntry(const std::string& key) -> std::optional<Entry> {
+    std::lock_guard lock{mtx_};
+    auto it = cache_.find(key);
+    if (it == cache_.end() || it->second->generation_ < Generation()) {
+        return std::nullopt;
+    }
+    return *it->second;
+}
+
+auto LRUCache::PeekVersion(const std::string& key, const ByteView& value) -> uint64_t {
+    std::lock_guard lock{mtx_};
+    auto it = FindLive(key);
+    if (it == list_.end() || it->value_.data_ != value.data_) {
+        return 0;
+    }
+    return it->version_;
+}
+
+auto LRUCache::SetMaxBytes(int64_t max_bytes) -> int64_t {
+    std::lock_guard lock{mtx_};
+    max_bytes_.store(max_bytes, std::memory_order_relaxed);
+    int64_t evicted = 0;
+    while (max_bytes != 0 && bytes_ > max_bytes && !list_.empty()) {
+        Evict();
+        ++evicted;
+    }
+    return evicted;
+}
+
+auto LRUCache::Keys(size_t limit, bool include_expired) -> std::vector<std::string> {
+    std::lock_guard lock{mtx_};
+    auto generation = Generation();
+    auto now = NowNs();
+    size_t n = limit == 0 ? list_.size() : std::min(limit, list_.size());
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (auto it = list_.begin(); it != list_.end() && keys.size() < n; ++it) {
+        // 旧代数的缓存项不会被访问移动到头部，遇到第一个时后面都是旧的
+        if (it->generation_ < generation) {
+            break;
+        }
+        if (!include_expired && it->IsExpired(now)) {
+            continue;
+        }
+        keys.push_back(it->key_);
+    }
+    return keys;
+}
+
+}  // namespace kcache
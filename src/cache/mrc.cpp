@@ -0,0 +1,157 @@
+#include "kcache/mrc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+namespace kcache {
+
+MissRatioCurve::MissRatioCurve(size_t max_samples, double initial_rate)
+    : max_samples_(max_samples),
+      threshold_(static_cast<uint32_t>(std::clamp(initial_rate, 0.0, 1.0) * kModulus)),
+      tree_(2 * max_samples + 2, 0) {}
+
+void MissRatioCurve::Record(const std::string& key, int64_t bytes) {
+    auto hash = static_cast<uint64_t>(std::hash<std::string>{}(key));
+    auto level = static_cast<uint32_t>(hash >> 40);
+    if (level >= threshold_.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    std::lock_guard lock{mtx_};
+    if (level >= threshold_.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (now_ + 1 >= tree_.size()) {
+        Compact();
+    }
+    ++now_;
+    auto rate = static_cast<double>(threshold_.load(std::memory_order_relaxed)) / kModulus;
+
+    auto it = samples_.find(hash);
+    if (it != samples_.end()) {
+        // 上次访问之后访问过的不同 key 的总大小，加上自己
+        auto distance = TreeSum(now_ - 1) - TreeSum(it->second.time) + bytes;
+        histogram_[BucketIndex(static_cast<int64_t>(static_cast<double>(distance) / rate))] += 1 / rate;
+        TreeAdd(it->second.time, -it->second.bytes);
+        it->second.time = now_;
+        it->second.bytes = bytes;
+        TreeAdd(now_, bytes);
+    } else {
+        cold_ += 1 / rate;
+        samples_.emplace(hash, Sample{now_, bytes});
+        levels_.emplace(level, hash);
+        TreeAdd(now_, bytes);
+        if (samples_.size() > max_samples_) {
+            Shrink();
+        }
+    }
+
+    if (++recorded_ >= kWindow) {
+        Decay();
+    }
+}
+
+auto MissRatioCurve::HitRatio(int64_t cache_bytes) -> double {
+    std::lock_guard lock{mtx_};
+    double total = cold_;
+    double hits = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        total += histogram_[i];
+        if (BucketUpperBound(i) <= cache_bytes) {
+            hits += histogram_[i];
+        }
+    }
+    return total == 0 ? 0 : hits / total;
+}
+
+auto MissRatioCurve::Curve(int64_t min_bytes, int64_t max_bytes) -> std::vector<MrcPoint> {
+    int64_t largest = 0;
+    {
+        std::lock_guard lock{mtx_};
+        for (size_t i = kBuckets; i > 0; --i) {
+            if (histogram_[i - 1] > 0) {
+                largest = BucketUpperBound(i - 1);
+                break;
+            }
+        }
+    }
+    std::vector<MrcPoint> curve;
+    for (auto bytes = std::max<int64_t>(min_bytes, 1); bytes <= max_bytes; bytes *= 2) {
+        curve.push_back(MrcPoint{bytes, HitRatio(bytes)});
+        if (bytes >= largest) {
+            break;  // 更大的容量命中率不会再提高
+        }
+    }
+    return curve;
+}
+
+auto MissRatioCurve::SampleRate() -> double {
+    return static_cast<double>(threshold_.load(std::memory_order_relaxed)) / kModulus;
+}
+
+auto MissRatioCurve::BucketIndex(int64_t distance) -> size_t {
+    if (distance <= 1) {
+        return 0;
+    }
+    auto bits = static_cast<size_t>(63 - __builtin_clzll(static_cast<uint64_t>(distance)));
+    auto lower = static_cast<double>(int64_t{1} << bits);
+    size_t index = 2 * bits + (static_cast<double>(distance) >= lower * M_SQRT2 ? 1 : 0);
+    return std::min(index, kBuckets - 1);
+}
+
+auto MissRatioCurve::BucketUpperBound(size_t index) -> int64_t {
+    return static_cast<int64_t>(std::ceil(std::pow(2.0, static_cast<double>(index + 1) / 2)));
+}
+
+void MissRatioCurve::TreeAdd(uint64_t time, int64_t delta) {
+    for (auto i = time; i < tree_.size(); i += i & (~i + 1)) {
+        tree_[i] += delta;
+    }
+}
+
+auto MissRatioCurve::TreeSum(uint64_t time) const -> int64_t {
+    int64_t sum = 0;
+    for (auto i = time; i > 0; i -= i & (~i + 1)) {
+        sum += tree_[i];
+    }
+    return sum;
+}
+
+void MissRatioCurve::Compact() {
+    std::vector<Sample*> order;
+    order.reserve(samples_.size());
+    for (auto& [_, sample] : samples_) {
+        order.push_back(&sample);
+    }
+    std::sort(order.begin(), order.end(), [](const Sample* a, const Sample* b) { return a->time < b->time; });
+    std::fill(tree_.begin(), tree_.end(), 0);
+    now_ = 0;
+    for (auto* sample : order) {
+        sample->time = ++now_;
+        TreeAdd(sample->time, sample->bytes);
+    }
+}
+
+void MissRatioCurve::Shrink() {
+    while (samples_.size() > max_samples_ && !levels_.empty()) {
+        auto level = levels_.rbegin()->first;
+        threshold_.store(level, std::memory_order_relaxed);
+        while (!levels_.empty() && levels_.rbegin()->first >= level) {
+            auto it = samples_.find(levels_.rbegin()->second);
+            TreeAdd(it->second.time, -it->second.bytes);
+            samples_.erase(it);
+            levels_.erase(std::prev(levels_.end()));
+        }
+    }
+}
+
+void MissRatioCurve::Decay() {
+    for (auto& count : histogram_) {
+        count /= 2;
+    }
+    cold_ /= 2;
+    recorded_ = 0;
+}
+
+}  // namespace kcache
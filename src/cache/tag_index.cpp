@@ -0,0 +1,68 @@
+#include "kcache/tag_index.h"
+
+namespace kcache {
+
+void TagIndex::Add(const std::string& key, const std::vector<std::string>& tags) {
+    std::lock_guard lock{mtx_};
+    if (index_prefixes_) {
+        keys_.insert(key);
+    }
+
+    auto it = key_tags_.find(key);
+    if (it != key_tags_.end()) {
+        for (const auto& tag : it->second) {
+            auto tit = tag_keys_.find(tag);
+            if (tit != tag_keys_.end() && tit->second.erase(key) > 0 && tit->second.empty()) {
+                tag_keys_.erase(tit);
+            }
+        }
+        key_tags_.erase(it);
+    }
+    if (tags.empty()) {
+        return;
+    }
+
+    for (const auto& tag : tags) {
+        tag_keys_[tag].insert(key);
+    }
+    key_tags_[key] = tags;
+}
+
+void TagIndex::Remove(const std::string& key) {
+    std::lock_guard lock{mtx_};
+    if (index_prefixes_) {
+        keys_.erase(key);
+    }
+    auto it = key_tags_.find(key);
+    if (it == key_tags_.end()) {
+        return;
+    }
+    for (const auto& tag : it->second) {
+        auto tit = tag_keys_.find(tag);
+        if (tit != tag_keys_.end() && tit->second.erase(key) > 0 && tit->second.empty()) {
+            tag_keys_.erase(tit);
+        }
+    }
+    key_tags_.erase(it);
+}
+
+auto TagIndex::KeysWithTag(const std::string& tag) -> std::vector<std::string> {
+    std::lock_guard lock{mtx_};
+    auto it = tag_keys_.find(tag);
+    if (it == tag_keys_.end()) {
+        return {};
+    }
+    return {it->second.begin(), it->second.end()};
+}
+
+auto TagIndex::KeysWithPrefix(const std::string& prefix) -> std::vector<std::string> {
+    std::lock_guard lock{mtx_};
+    std::vector<std::string> keys;
+    // 有序集合中以 prefix 开头的 key 是连续的一段
+    for (auto it = keys_.lower_bound(prefix); it != keys_.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+        keys.push_back(*it);
+    }
+    return keys;
+}
+
+}  // namespace kcache
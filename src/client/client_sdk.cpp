@@ -1,19 +1,117 @@
 #include "kcache/client.h"
 
+#include <algorithm>
+#include <future>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
 #include <grpcpp/grpcpp.h>
 #include <spdlog/spdlog.h>
 
 #include "kcache.grpc.pb.h"
+#include "kcache/invalidation_queue.h"
 
 namespace kcache {
 
+// 拉取节点负载的间隔
+constexpr auto kLoadReportInterval = std::chrono::seconds(5);
+// 等待租约持有者填充的最大重试次数，超过后直接回源
+constexpr int kLeaseMaxRetries = 10;
+// 单个失效批次最多的 key 数
+constexpr size_t kInvalidateBatchSize = 256;
+// 失效通知发送失败后的重试间隔
+constexpr auto kInvalidateRetryInterval = std::chrono::milliseconds(100);
+// 失效通知 RPC 的超时时间
+constexpr auto kInvalidateTimeout = std::chrono::seconds(1);
+// 节点最后一次标记热点之后继续分散读请求的时间
+constexpr auto kHotKeyTtl = std::chrono::seconds(2);
+// 热点表超过该大小时清理已过期的 key
+constexpr size_t kHotKeySweepThreshold = 4096;
+// 广播线程池的线程数，即同时进行的广播 RPC 数上限
+constexpr int kBroadcastThreads = 8;
+// 广播线程池最多排队的调用数
+constexpr int kBroadcastMaxPending = 256;
+
+struct KCacheClient::Peer {
+    // with_queue 为 false 时是临时连接，不启动失效队列
+    Peer(const std::string& addr, bool with_queue)
+        : addr(addr), stub(pb::KCache::NewStub(grpc::CreateChannel(addr, grpc::InsecureChannelCredentials()))) {
+        if (with_queue) {
+            invalidations = std::make_unique<InvalidationQueue>(
+                addr, [this](const auto& batch) { return SendInvalidations(batch); }, kInvalidateBatchSize,
+                kInvalidateRetryInterval);
+        }
+    }
+
+    // 该节点上缓存组的编号，还不知道时为 0
+    auto GroupId(const std::string& group) -> uint32_t {
+        std::lock_guard lock{ids_mtx};
+        auto it = group_ids.find(group);
+        return it == group_ids.end() ? 0 : it->second;
+    }
+
+    void SetGroupId(const std::string& group, uint32_t id) {
+        if (id == 0) {
+            return;
+        }
+        std::lock_guard lock{ids_mtx};
+        group_ids[group] = id;
+    }
+
+    // 失效队列的发送函数，一批失效通知只需一次 RPC
+    bool SendInvalidations(const std::vector<std::pair<std::string, std::string>>& batch) {
+        pb::BatchInvalidateRequest request;
+        for (const auto& [group, key] : batch) {
+            auto* entry = request.add_entries();
+            entry->set_group(group);
+            entry->set_key(key);
+        }
+        pb::BatchInvalidateResponse response;
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + kInvalidateTimeout);
+        auto status = stub->BatchInvalidate(&ctx, request, &response);
+        if (!status.ok()) {
+            spdlog::debug("BatchInvalidate on node {} failed: {}", addr, status.error_message());
+        }
+        return status.ok();
+    }
+
+    std::string addr;
+    std::unique_ptr<pb::KCache::Stub> stub;  // stub 是线程安全的，所有请求共用
+
+    std::mutex ids_mtx;
+    std::unordered_map<std::string, uint32_t> group_ids;  // 节点在 GetResponse 中返回的缓存组编号
+
+    // 只有集群成员的连接才有失效队列，声明在 stub 之后，析构时先停止队列
+    std::unique_ptr<InvalidationQueue> invalidations;
+};
+
 KCacheClient::KCacheClient(const std::string& etcd_endpoints, const std::string& service_name)
-    : service_name_(service_name) {
+    : service_name_(service_name), broadcast_pool_(kBroadcastThreads, kBroadcastMaxPending) {
     etcd_client_ = std::make_shared<etcd::Client>(etcd_endpoints);
     StartServiceDiscovery();
+    load_report_thread_ = std::thread{[this] { LoadReportLoop(); }};
 }
 
 KCacheClient::~KCacheClient() {
+    {
+        std::lock_guard lock{stop_mtx_};
+        is_stop_ = true;
+    }
+    stop_cv_.notify_all();
+    if (load_report_thread_.joinable()) {
+        load_report_thread_.join();
+    }
+    std::unordered_map<std::string, std::shared_ptr<Peer>> peers;
+    {
+        std::lock_guard lock{peers_mtx_};
+        peers.swap(peers_);
+    }
+    for (auto& [_, peer] : peers) {
+        peer->invalidations->Stop();
+    }
     if (etcd_watcher_) {
         etcd_watcher_->Cancel();
     }
@@ -29,22 +127,46 @@ auto KCacheClient::Get(const std::string& group, const std::string& key) -> std:
         return std::nullopt;
     }
 
-    auto channel = grpc::CreateChannel(target_addr, grpc::InsecureChannelCredentials());
-    auto client = pb::KCache::NewStub(channel);
-    if (!client) {
-        spdlog::error("Failed to create gRPC stub for node: {}", target_addr);
-        return std::nullopt;
-    }
-
     pb::Request request;
     request.set_group(group);
     request.set_key(key);
 
+    // 热点 key 的读请求分散到随机节点，由这些节点从 owner 拉取并短暂缓存
+    if (IsHotKey(group, key)) {
+        auto replica = PickReplica(target_addr);
+        if (replica != target_addr) {
+            request.set_owner(target_addr);
+            auto peer = GetPeer(replica);
+            request.set_group_id(peer->GroupId(group));
+            pb::GetResponse response;
+            grpc::ClientContext context;
+            auto status = peer->stub->Get(&context, request, &response);
+            if (status.ok()) {
+                peer->SetGroupId(group, response.group_id());
+                if (response.hot()) {
+                    MarkHotKey(group, key);
+                }
+                return response.value();
+            }
+            if (status.error_code() == grpc::StatusCode::NOT_FOUND) {
+                return std::nullopt;
+            }
+            // 副本节点不可用时回退到 owner
+            request.clear_owner();
+        }
+    }
+
+    auto peer = GetPeer(target_addr);
+    request.set_group_id(peer->GroupId(group));
     pb::GetResponse response;
     grpc::ClientContext context;
 
-    auto status = client->Get(&context, request, &response);
+    auto status = peer->stub->Get(&context, request, &response);
     if (status.ok()) {
+        peer->SetGroupId(group, response.group_id());
+        if (response.hot()) {
+            MarkHotKey(group, key);
+        }
         return response.value();
     } else {
         if (status.error_code() != grpc::StatusCode::NOT_FOUND) {
@@ -55,17 +177,35 @@ auto KCacheClient::Get(const std::string& group, const std::string& key) -> std:
     }
 }
 
-bool KCacheClient::Set(const std::string& group, const std::string& key, const std::string& value) {
+auto KCacheClient::GetVersioned(const std::string& group, const std::string& key)
+    -> std::optional<std::pair<std::string, uint64_t>> {
     auto target_addr = GetCacheNode(key);
     if (target_addr.empty()) {
-        spdlog::warn("No cache service available for Set");
-        return false;
+        spdlog::warn("No cache service available for key: {}", key);
+        return std::nullopt;
+    }
+
+    pb::Request request;
+    request.set_group(group);
+    request.set_key(key);
+
+    pb::GetResponse response;
+    grpc::ClientContext context;
+    auto status = GetPeer(target_addr)->stub->Get(&context, request, &response);
+    if (!status.ok()) {
+        if (status.error_code() != grpc::StatusCode::NOT_FOUND) {
+            spdlog::warn("Get failed on node {}: {}", target_addr, status.error_message());
+        }
+        return std::nullopt;
     }
+    return std::make_pair(response.value(), response.version());
+}
 
-    auto channel = grpc::CreateChannel(target_addr, grpc::InsecureChannelCredentials());
-    auto client = pb::KCache::NewStub(channel);
-    if (!client) {
-        spdlog::error("Failed to create gRPC stub for node: {}", target_addr);
+bool KCacheClient::Set(const std::string& group, const std::string& key, const std::string& value,
+                       const std::vector<std::string>& tags) {
+    auto target_addr = GetCacheNode(key);
+    if (target_addr.empty()) {
+        spdlog::warn("No cache service available for Set");
         return false;
     }
 
@@ -73,66 +213,271 @@ bool KCacheClient::Set(const std::string& group, const std::string& key, const s
     request.set_group(group);
     request.set_key(key);
     request.set_value(value);
+    for (const auto& tag : tags) {
+        request.add_tags(tag);
+    }
 
     pb::SetResponse response;
     grpc::ClientContext context;
-    auto status = client->Set(&context, request, &response);
+    auto status = GetPeer(target_addr)->stub->Set(&context, request, &response);
 
     if (!(status.ok() && response.value())) {
         spdlog::error("Failed to set value on node {}: {}", target_addr, status.error_message());
         return false;
     }
 
-    // 广播其他节点发送缓存失效通知
-    bool all_success = true;
-    {
-        std::lock_guard<std::mutex> lock(nodes_mutex_);
-        for (const auto& addr : cache_nodes_) {
-            if (addr != target_addr) {
-                auto channel = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
-                auto client = pb::KCache::NewStub(channel);
-                pb::InvalidateResponse response;
-                grpc::ClientContext ctx;
-
-                auto status = client->Invalidate(&ctx, request, &response);
-                if (!(status.ok() && response.value())) {
-                    all_success = false;
-                    spdlog::warn("Failed to Invalidate key on node {}", addr);
-                }
-            }
-        }
+    // 其他节点的失效通知在后台批量发送
+    EnqueueInvalidation(group, key, target_addr);
+    return true;
+}
+
+bool KCacheClient::Delete(const std::string& group, const std::string& key) {
+    auto target_addr = GetCacheNode(key);
+    if (target_addr.empty()) {
+        spdlog::warn("No cache service available for Delete");
+        return false;
     }
 
-    return all_success;
+    pb::Request request;
+    request.set_group(group);
+    request.set_key(key);
+
+    pb::DeleteResponse response;
+    grpc::ClientContext context;
+    auto status = GetPeer(target_addr)->stub->Delete(&context, request, &response);
+
+    if (!(status.ok() && response.value())) {
+        spdlog::warn("Failed to delete key on node {}", target_addr);
+        return false;
+    }
+
+    EnqueueInvalidation(group, key, target_addr);
+    return true;
 }
 
-bool KCacheClient::Delete(const std::string& group, const std::string& key) {
+bool KCacheClient::CompareAndSet(const std::string& group, const std::string& key, const std::string& value,
+                                 uint64_t expected_version) {
+    auto target_addr = GetCacheNode(key);
+    if (target_addr.empty()) {
+        spdlog::warn("No cache service available for CompareAndSet");
+        return false;
+    }
+
+    pb::CasRequest request;
+    request.set_group(group);
+    request.set_key(key);
+    request.set_value(value);
+    request.set_expected_version(expected_version);
+
+    pb::CasResponse response;
+    grpc::ClientContext context;
+    auto status = GetPeer(target_addr)->stub->CompareAndSet(&context, request, &response);
+    if (!status.ok()) {
+        spdlog::error("Failed to compare and set on node {}: {}", target_addr, status.error_message());
+        return false;
+    }
+    if (!response.ok()) {
+        return false;
+    }
+    EnqueueInvalidation(group, key, target_addr);
+    return true;
+}
+
+auto KCacheClient::Incr(const std::string& group, const std::string& key, int64_t delta) -> std::optional<int64_t> {
+    auto target_addr = GetCacheNode(key);
+    if (target_addr.empty()) {
+        spdlog::warn("No cache service available for Incr");
+        return std::nullopt;
+    }
+
+    pb::IncrRequest request;
+    request.set_group(group);
+    request.set_key(key);
+    request.set_delta(delta);
+
+    pb::IncrResponse response;
+    grpc::ClientContext context;
+    auto status = GetPeer(target_addr)->stub->Incr(&context, request, &response);
+    if (!status.ok()) {
+        spdlog::error("Failed to incr key {} on node {}: {}", key, target_addr, status.error_message());
+        return std::nullopt;
+    }
+    EnqueueInvalidation(group, key, target_addr);
+    return response.value();
+}
+
+bool KCacheClient::Append(const std::string& group, const std::string& key, const std::string& suffix) {
+    auto target_addr = GetCacheNode(key);
+    if (target_addr.empty()) {
+        spdlog::warn("No cache service available for Append");
+        return false;
+    }
+
     pb::Request request;
     request.set_group(group);
     request.set_key(key);
+    request.set_value(suffix);
 
-    bool all_success = true;
+    pb::AppendResponse response;
+    grpc::ClientContext context;
+    auto status = GetPeer(target_addr)->stub->Append(&context, request, &response);
+    if (!status.ok()) {
+        spdlog::error("Failed to append key {} on node {}: {}", key, target_addr, status.error_message());
+        return false;
+    }
+    EnqueueInvalidation(group, key, target_addr);
+    return true;
+}
+
+bool KCacheClient::InvalidateTag(const std::string& group, const std::string& tag) {
+    pb::InvalidateTagRequest request;
+    request.set_group(group);
+    request.set_tag(tag);
+    return Broadcast([&request](Peer* peer) {
+        pb::BulkInvalidateResponse response;
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + kInvalidateTimeout);
+        return peer->stub->InvalidateTag(&ctx, request, &response);
+    });
+}
+
+bool KCacheClient::InvalidatePrefix(const std::string& group, const std::string& prefix) {
+    pb::InvalidatePrefixRequest request;
+    request.set_group(group);
+    request.set_prefix(prefix);
+    return Broadcast([&request](Peer* peer) {
+        pb::BulkInvalidateResponse response;
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + kInvalidateTimeout);
+        return peer->stub->InvalidatePrefix(&ctx, request, &response);
+    });
+}
+
+bool KCacheClient::Flush(const std::string& group) {
+    pb::FlushRequest request;
+    request.set_group(group);
+    return Broadcast([&request](Peer* peer) {
+        pb::FlushResponse response;
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + kInvalidateTimeout);
+        return peer->stub->Flush(&ctx, request, &response);
+    });
+}
+
+bool KCacheClient::Broadcast(const std::function<grpc::Status(Peer* peer)>& call) {
+    std::vector<std::string> nodes;
     {
         std::lock_guard<std::mutex> lock(nodes_mutex_);
-        if (cache_nodes_.empty()) {
-            spdlog::warn("No cache service available for Delete");
+        nodes.assign(cache_nodes_.begin(), cache_nodes_.end());
+    }
+    if (nodes.empty()) {
+        spdlog::warn("No cache service available for broadcast");
+        return false;
+    }
+
+    // 在共用的有界线程池中并行调用，线程池排满时在当前线程执行，并发的广播不会无限制地创建线程
+    std::vector<std::pair<std::string, std::future<grpc::Status>>> results;
+    results.reserve(nodes.size());
+    for (const auto& addr : nodes) {
+        auto task = std::make_shared<std::packaged_task<grpc::Status()>>(
+            [peer = GetPeer(addr), &call] { return call(peer.get()); });
+        results.emplace_back(addr, task->get_future());
+        if (!broadcast_pool_.Submit([task] { (*task)(); })) {
+            (*task)();
+        }
+    }
+
+    bool all_success = true;
+    for (auto& [addr, result] : results) {
+        auto status = result.get();
+        if (!status.ok()) {
+            all_success = false;
+            spdlog::warn("Broadcast to node {} failed: {}", addr, status.error_message());
+        }
+    }
+    return all_success;
+}
+
+auto KCacheClient::PendingInvalidations() -> size_t {
+    std::vector<std::shared_ptr<Peer>> peers;
+    {
+        std::lock_guard lock{peers_mtx_};
+        for (auto& [_, peer] : peers_) {
+            peers.push_back(peer);
+        }
+    }
+    size_t pending = 0;
+    for (auto& peer : peers) {
+        pending += peer->invalidations->Pending();
+    }
+    return pending;
+}
+
+bool KCacheClient::WaitInvalidations(std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (PendingInvalidations() > 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
             return false;
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
 
-        for (const auto& addr : cache_nodes_) {
-            auto channel = grpc::CreateChannel(addr, grpc::InsecureChannelCredentials());
-            auto client = pb::KCache::NewStub(channel);
-            grpc::ClientContext ctx;
-            pb::DeleteResponse response;
-
-            auto status = client->Delete(&ctx, request, &response);
-            if (!(status.ok() && response.value())) {
-                all_success = false;
-                spdlog::warn("Failed to delete key on node {}", addr);
+auto KCacheClient::GetOrLoad(const std::string& group, const std::string& key, const Loader& loader)
+    -> std::optional<std::string> {
+    auto target_addr = GetCacheNode(key);
+    if (target_addr.empty()) {
+        spdlog::warn("No cache service available for key: {}", key);
+        return loader();
+    }
+
+    auto peer = GetPeer(target_addr);
+    auto& client = peer->stub;
+
+    pb::Request request;
+    request.set_group(group);
+    request.set_key(key);
+
+    for (int i = 0; i < kLeaseMaxRetries; ++i) {
+        pb::LeaseResponse response;
+        grpc::ClientContext context;
+        auto status = client->Lease(&context, request, &response);
+        if (!status.ok()) {
+            if (status.error_code() == grpc::StatusCode::NOT_FOUND) {
+                return std::nullopt;
+            }
+            // 缓存节点不可用时直接回源，不影响业务
+            spdlog::warn("Lease failed on node {}: {}", target_addr, status.error_message());
+            return loader();
+        }
+        if (response.hit() || response.stale()) {
+            return response.value();
+        }
+        if (response.token() != 0) {
+            auto value = loader();
+            pb::FillRequest fill;
+            fill.set_group(group);
+            fill.set_key(key);
+            fill.set_token(response.token());
+            fill.set_absent(!value.has_value());
+            if (value) {
+                fill.set_value(*value);
+            }
+            pb::FillResponse fill_response;
+            grpc::ClientContext fill_ctx;
+            auto fill_status = client->Fill(&fill_ctx, fill, &fill_response);
+            if (!fill_status.ok() || !fill_response.value()) {
+                // 租约已被失效，说明期间有新的写入，本次的值不写回缓存
+                spdlog::debug("Fill key {} on node {} rejected", key, target_addr);
             }
+            return value;
         }
+        std::this_thread::sleep_for(std::chrono::milliseconds(response.retry_after_ms()));
     }
-    return all_success;
+
+    spdlog::warn("Wait lease of key {} on node {} too long, load directly", key, target_addr);
+    return loader();
 }
 
 bool KCacheClient::StartServiceDiscovery() {
@@ -150,40 +495,55 @@ bool KCacheClient::StartServiceDiscovery() {
 }
 
 void KCacheClient::HandleWatchEvents(const etcd::Response& resp) {
-    std::lock_guard<std::mutex> lock{nodes_mutex_};
-    if (!resp.is_ok()) {
-        spdlog::error("Failed to watching etcd: {}", resp.error_message());
-        return;
-    }
-
-    for (const auto& event : resp.events()) {
-        std::string key = event.kv().key();
-        std::string addr = ParseAddrFromKey(key);
-        if (addr.empty()) {
-            continue;
+    std::vector<std::shared_ptr<Peer>> removed;
+    {
+        std::lock_guard<std::mutex> lock{nodes_mutex_};
+        if (!resp.is_ok()) {
+            spdlog::error("Failed to watching etcd: {}", resp.error_message());
+            return;
         }
-        switch (event.event_type()) {
-            case etcd::Event::EventType::PUT: {
-                if (cache_nodes_.find(addr) == cache_nodes_.end()) {
-                    cache_nodes_.insert(addr);
-                    consistent_hash_.Add({addr});
-                }
-                spdlog::debug("Service added: {} (key: {})", addr, key);
-                break;
+
+        for (const auto& event : resp.events()) {
+            std::string key = event.kv().key();
+            std::string addr = ParseAddrFromKey(key);
+            if (addr.empty()) {
+                continue;
             }
-            case etcd::Event::EventType::DELETE_: {
-                if (cache_nodes_.find(addr) != cache_nodes_.end()) {
-                    cache_nodes_.erase(addr);
-                    consistent_hash_.Remove(addr);
-                    spdlog::debug("Service removed: {} (key: {})", addr, key);
+            switch (event.event_type()) {
+                case etcd::Event::EventType::PUT: {
+                    if (cache_nodes_.find(addr) == cache_nodes_.end()) {
+                        cache_nodes_.insert(addr);
+                        consistent_hash_.Add({addr});
+                    }
+                    spdlog::debug("Service added: {} (key: {})", addr, key);
+                    break;
+                }
+                case etcd::Event::EventType::DELETE_: {
+                    if (cache_nodes_.find(addr) != cache_nodes_.end()) {
+                        cache_nodes_.erase(addr);
+                        consistent_hash_.Remove(addr);
+                        // 与删除成员在同一个 nodes_mutex_ 临界区内摘除连接，GetPeer 不会再为它创建失效队列
+                        std::lock_guard peers_lock{peers_mtx_};
+                        auto it = peers_.find(addr);
+                        if (it != peers_.end()) {
+                            removed.push_back(std::move(it->second));
+                            peers_.erase(it);
+                        }
+                        spdlog::debug("Service removed: {} (key: {})", addr, key);
+                    }
+                    break;
                 }
-                break;
+                default:
+                    spdlog::debug("Unknown event type: {} for key: {}", static_cast<int>(event.event_type()), key);
+                    break;
             }
-            default:
-                spdlog::debug("Unknown event type: {} for key: {}", static_cast<int>(event.event_type()), key);
-                break;
         }
     }
+
+    // 停止失效队列可能要等待最后一批发送完成，放在锁外进行
+    for (const auto& peer : removed) {
+        peer->invalidations->Stop();
+    }
 }
 
 bool KCacheClient::FetchAllServices() {
@@ -225,8 +585,159 @@ auto KCacheClient::GetCacheNode(const std::string& key) -> std::string {
         target_addr = *cache_nodes_.begin();
     }
 
-    spdlog::debug("Routing key '{}' to node '{}'", key, target_addr);
+    SPDLOG_DEBUG("Routing key '{}' to node '{}'", key, target_addr);
     return target_addr;
 }
 
+auto KCacheClient::IsHotKey(const std::string& group, const std::string& key) -> bool {
+    std::lock_guard lock{hot_mtx_};
+    if (hot_keys_.empty()) {
+        return false;
+    }
+    auto it = hot_keys_.find(group + '\0' + key);
+    if (it == hot_keys_.end()) {
+        return false;
+    }
+    if (it->second <= std::chrono::steady_clock::now()) {
+        hot_keys_.erase(it);
+        return false;
+    }
+    return true;
+}
+
+void KCacheClient::MarkHotKey(const std::string& group, const std::string& key) {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{hot_mtx_};
+    if (hot_keys_.size() >= kHotKeySweepThreshold) {
+        for (auto it = hot_keys_.begin(); it != hot_keys_.end();) {
+            it = it->second <= now ? hot_keys_.erase(it) : std::next(it);
+        }
+    }
+    hot_keys_[group + '\0' + key] = now + kHotKeyTtl;
+}
+
+auto KCacheClient::PickReplica(const std::string& owner) -> std::string {
+    thread_local std::mt19937 rng{std::random_device{}()};
+    std::lock_guard lock{nodes_mutex_};
+    if (cache_nodes_.empty()) {
+        return owner;
+    }
+    auto it = cache_nodes_.begin();
+    std::advance(it, std::uniform_int_distribution<size_t>{0, cache_nodes_.size() - 1}(rng));
+    return *it;
+}
+
+auto KCacheClient::GetPeer(const std::string& addr) -> std::shared_ptr<Peer> {
+    {
+        std::lock_guard lock{peers_mtx_};
+        auto it = peers_.find(addr);
+        if (it != peers_.end()) {
+            return it->second;
+        }
+    }
+    {
+        // 与 HandleWatchEvents 相同，先锁 nodes_mutex_ 再锁 peers_mtx_：成员检查和创建连接之间节点不会下线，
+        // 已下线的节点不会被重新放回 peers_，留下一个没有人停止的失效队列
+        std::lock_guard nodes_lock{nodes_mutex_};
+        std::lock_guard lock{peers_mtx_};
+        auto& peer = peers_[addr];
+        if (peer) {
+            return peer;
+        }
+        if (!is_stop_ && cache_nodes_.count(addr) > 0) {
+            peer = std::make_shared<Peer>(addr, true);
+            return peer;
+        }
+        peers_.erase(addr);
+    }
+    // 不在集群中的节点（如刚刚下线）只建立临时连接，用完即释放
+    return std::make_shared<Peer>(addr, false);
+}
+
+void KCacheClient::EnqueueInvalidation(const std::string& group, const std::string& key, const std::string& owner) {
+    std::vector<std::string> nodes;
+    {
+        std::lock_guard<std::mutex> lock(nodes_mutex_);
+        nodes.reserve(cache_nodes_.size());
+        for (const auto& addr : cache_nodes_) {
+            if (addr != owner) {
+                nodes.push_back(addr);
+            }
+        }
+    }
+
+    for (const auto& addr : nodes) {
+        auto peer = GetPeer(addr);
+        // 取出成员列表之后下线的节点拿到的是临时连接，不需要再通知
+        if (peer->invalidations) {
+            peer->invalidations->Push(group, key);
+        }
+    }
+}
+
+void KCacheClient::LoadReportLoop() {
+    std::unique_lock lock{stop_mtx_};
+    while (!is_stop_) {
+        stop_cv_.wait_for(lock, kLoadReportInterval, [this] { return is_stop_.load(); });
+        if (is_stop_) {
+            break;
+        }
+        lock.unlock();
+        CollectNodeLoads();
+        lock.lock();
+    }
+}
+
+void KCacheClient::CollectNodeLoads() {
+    std::vector<std::string> nodes;
+    {
+        std::lock_guard<std::mutex> lock(nodes_mutex_);
+        nodes.assign(cache_nodes_.begin(), cache_nodes_.end());
+    }
+
+    std::unordered_map<std::string, double> cpu_loads;
+    std::unordered_map<std::string, double> qps_loads;
+    for (const auto& addr : nodes) {
+        auto peer = GetPeer(addr);
+        pb::StatsRequest request;
+        pb::StatsResponse response;
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + std::chrono::seconds(1));
+
+        auto status = peer->stub->Stats(&ctx, request, &response);
+        if (!status.ok()) {
+            spdlog::debug("Failed to fetch stats from node {}: {}", addr, status.error_message());
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto it = load_samples_.find(addr);
+        if (it != load_samples_.end()) {
+            double elapsed = std::chrono::duration<double>(now - it->second.at).count();
+            if (elapsed > 0) {
+                // CPU 占用（核数）综合反映了请求量、value 大小、回源开销以及其他客户端带来的负载
+                cpu_loads[addr] = static_cast<double>(response.cpu_time_ns() - it->second.cpu_time_ns) / 1e9 / elapsed;
+                qps_loads[addr] = static_cast<double>(response.requests() - it->second.requests) / elapsed;
+            }
+        }
+        load_samples_[addr] = LoadSample{response.cpu_time_ns(), response.requests(), now};
+    }
+
+    // 已下线节点的采样不再需要
+    for (auto it = load_samples_.begin(); it != load_samples_.end();) {
+        if (std::find(nodes.begin(), nodes.end(), it->first) == nodes.end()) {
+            it = load_samples_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (cpu_loads.empty()) {
+        return;
+    }
+    // 有节点拿不到 CPU 时间时统一退化为 QPS，保证各节点负载口径一致
+    bool has_cpu = std::all_of(cpu_loads.begin(), cpu_loads.end(), [](const auto& kv) { return kv.second > 0; });
+    consistent_hash_.UpdateLoads(has_cpu ? cpu_loads : qps_loads);
+}
+
 }  // namespace kcache
@@ -0,0 +1,93 @@
+#include "kcache/invalidation_queue.h"
+
+#include <spdlog/spdlog.h>
+
+namespace kcache {
+
+InvalidationQueue::InvalidationQueue(std::string addr, InvalidationSender sender, size_t max_batch_size,
+                                     std::chrono::milliseconds retry_interval)
+    : addr_(std::move(addr)),
+      sender_(std::move(sender)),
+      max_batch_size_(max_batch_size),
+      retry_interval_(retry_interval) {
+    worker_ = std::thread{[this] { SendLoop(); }};
+}
+
+InvalidationQueue::~InvalidationQueue() { Stop(); }
+
+void InvalidationQueue::Push(const std::string& group, const std::string& key) {
+    {
+        std::lock_guard lock{mtx_};
+        // 停止后没有线程再发送，入队只会让通知永远留在队列中
+        if (is_stop_) {
+            return;
+        }
+        // 队列中已有同一个 key 的失效通知时直接合并
+        if (!queued_.insert(group + '\0' + key).second) {
+            return;
+        }
+        queue_.emplace_back(group, key);
+    }
+    cv_.notify_one();
+}
+
+auto InvalidationQueue::Pending() -> size_t {
+    std::lock_guard lock{mtx_};
+    return queue_.size() + inflight_;
+}
+
+void InvalidationQueue::Stop() {
+    {
+        std::lock_guard lock{mtx_};
+        is_stop_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void InvalidationQueue::SendLoop() {
+    std::unique_lock lock{mtx_};
+    while (true) {
+        cv_.wait(lock, [this] { return is_stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;  // 已停止且没有待发送的失效通知
+        }
+
+        // 取出一批，发送期间新到的同一个 key 会重新入队
+        std::vector<std::pair<std::string, std::string>> batch;
+        while (!queue_.empty() && batch.size() < max_batch_size_) {
+            auto item = std::move(queue_.front());
+            queue_.pop_front();
+            queued_.erase(item.first + '\0' + item.second);
+            batch.push_back(std::move(item));
+        }
+        inflight_ = batch.size();
+        lock.unlock();
+
+        bool ok = sender_(batch);
+
+        lock.lock();
+        inflight_ = 0;
+        if (ok) {
+            continue;
+        }
+        if (is_stop_) {
+            spdlog::warn("Drop {} invalidations for node {}", batch.size() + queue_.size(), addr_);
+            queue_.clear();
+            queued_.clear();
+            return;
+        }
+
+        spdlog::warn("Failed to send {} invalidations to node {}, retry later", batch.size(), addr_);
+        for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+            if (queued_.insert(it->first + '\0' + it->second).second) {
+                queue_.push_front(std::move(*it));
+            }
+        }
+        cv_.wait_for(lock, retry_interval_, [this] { return is_stop_; });
+    }
+}
+
+}  // namespace kcache
@@ -1,5 +1,8 @@
 #include "kcache/consistent_hash.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <mutex>
 
 #include <fmt/base.h>
@@ -50,7 +53,9 @@ uint32_t Crc32IEEE(const std::string& data) {
 }
 
 ConsistentHashMap::ConsistentHashMap(HashConfig cfg) : config_(cfg), total_requests_(0), is_balancer_stop_(false) {
-    StartBalancer();  // 启动负载均衡器
+    if (config_.auto_rebalance) {
+        StartBalancer();  // 启动负载均衡器
+    }
 }
 
 ConsistentHashMap::~ConsistentHashMap() {
@@ -92,20 +97,9 @@ bool ConsistentHashMap::Remove(const std::string& node) {
         return false;  // 节点未找到
     }
 
-    int replicas = it_replicas->second;
-
-    // 移除节点的所有虚拟节点
-    for (int i = 0; i < replicas; ++i) {
-        std::string hash_key = fmt::format("{}-{}", node, std::to_string(i));
-        uint32_t hash = config_.hash_func(hash_key);
-        hash_map_.erase(hash);  // 从哈希映射中移除
-        // 从哈希环中移除哈希值
-        auto it = std::remove(keys_.begin(), keys_.end(), hash);
-        keys_.erase(it, keys_.end());
-    }
-
-    node_replicas_.erase(node);
+    RemoveNode(node);
     node_counts_.erase(node);  // 从负载统计中移除
+    reported_loads_.erase(node);
     return true;
 }
 
@@ -152,6 +146,20 @@ auto ConsistentHashMap::GetStats() -> std::unordered_map<std::string, double> {
     return stats;
 }
 
+auto ConsistentHashMap::GetReplicas() -> std::unordered_map<std::string, int> {
+    std::shared_lock lock{mtx_};  // 获取读锁
+    return node_replicas_;
+}
+
+void ConsistentHashMap::UpdateLoads(const std::unordered_map<std::string, double>& loads) {
+    std::unique_lock lock{mtx_};  // 获取写锁
+    for (const auto& [node, load] : loads) {
+        if (node_replicas_.find(node) != node_replicas_.end()) {
+            reported_loads_[node] = load;
+        }
+    }
+}
+
 void ConsistentHashMap::StartBalancer() {
     is_balancer_stop_ = false;
     balancer_thread_ = std::thread{[this] {
@@ -167,7 +175,7 @@ void ConsistentHashMap::StartBalancer() {
 void ConsistentHashMap::AddNode(const std::string& node, int replicas) {
     for (int i = 0; i < replicas; ++i) {
         std::string hash_key = fmt::format("{}-{}", node, std::to_string(i));
-        spdlog::debug("Adding virtual node: {} with hash key: {}", node, hash_key);
+        SPDLOG_DEBUG("Adding virtual node: {} with hash key: {}", node, hash_key);
         uint32_t hash = config_.hash_func(hash_key);
         keys_.push_back(hash);
         hash_map_[hash] = node;
@@ -179,25 +187,73 @@ void ConsistentHashMap::AddNode(const std::string& node, int replicas) {
     }
 }
 
-void ConsistentHashMap::CheckAndRebalance() {
-    if (total_requests_.load() < 1000) {
-        return;  // 样本太少，不进行调整
+void ConsistentHashMap::RemoveNode(const std::string& node) {
+    auto it_replicas = node_replicas_.find(node);
+    if (it_replicas == node_replicas_.end()) {
+        return;
+    }
+    // 移除节点的所有虚拟节点
+    for (int i = 0; i < it_replicas->second; ++i) {
+        std::string hash_key = fmt::format("{}-{}", node, std::to_string(i));
+        uint32_t hash = config_.hash_func(hash_key);
+        hash_map_.erase(hash);  // 从哈希映射中移除
+        // 从哈希环中移除哈希值
+        auto it = std::remove(keys_.begin(), keys_.end(), hash);
+        keys_.erase(it, keys_.end());
+    }
+    node_replicas_.erase(it_replicas);
+}
+
+auto ConsistentHashMap::CollectLoads(bool* enough) -> std::unordered_map<std::string, double> {
+    std::unordered_map<std::string, double> loads;
+    // 所有节点都上报了负载时，使用集群视角的真实负载
+    bool all_reported = !reported_loads_.empty();
+    for (auto const& [node, _] : node_replicas_) {
+        auto it = reported_loads_.find(node);
+        if (it == reported_loads_.end()) {
+            all_reported = false;
+            loads.clear();
+            break;
+        }
+        loads[node] = it->second;
+    }
+    if (all_reported) {
+        *enough = true;
+        return loads;
     }
 
+    // 否则退化为本实例路由的请求数，样本太少时不可靠
+    *enough = total_requests_.load() >= kMinRebalanceSamples;
+    for (auto const& [node, count] : node_counts_) {
+        loads[node] = static_cast<double>(count.load());
+    }
+    return loads;
+}
+
+void ConsistentHashMap::CheckAndRebalance() {
     std::shared_lock lock{mtx_};
 
     if (node_replicas_.empty()) {
         return;
     }
 
-    // 计算系统平均负载：总请求数 / 物理节点数量
-    long long current_total_requests = total_requests_.load();
-    double avg_load = static_cast<double>(current_total_requests) / node_replicas_.size();
+    bool enough = false;
+    auto loads = CollectLoads(&enough);
+    if (!enough) {
+        return;  // 没有完整的上报负载且样本太少，不进行调整
+    }
+
+    // 计算系统平均负载：总负载 / 物理节点数量
+    double total_load = 0.0;
+    for (auto const& [_, load] : loads) {
+        total_load += load;
+    }
+    double avg_load = total_load / node_replicas_.size();
     double max_diff = 0.0;
 
     // 遍历所有节点计算负载偏差，计算每个节点的负载与平均负载的差异百分比
-    for (auto const& [node, count] : node_counts_) {
-        double diff = std::abs(static_cast<double>(count.load()) - avg_load);
+    for (auto const& [node, load] : loads) {
+        double diff = std::abs(load - avg_load);
         // 避免除以零
         if (avg_load > 0) {
             if (diff / avg_load > max_diff) {
@@ -222,23 +278,33 @@ void ConsistentHashMap::RebalanceNodes() {
         return;
     }
 
-    long long current_total_requests = total_requests_.load();
-    double avg_load = static_cast<double>(current_total_requests) / node_replicas_.size();
-
-    // 调整每个节点的虚拟节点数量
-    // 注意：这里需要创建一个副本，因为在循环中可能会修改 nodeReplicas 和 nodeCounts
-    std::unordered_map<std::string, int> curr_replicas = node_replicas_;
-    std::unordered_map<std::string, long long> curr_counts;
-    for (auto const& [node, count] : node_counts_) {
-        curr_counts[node] = count.load();
+    // 释放读锁之后负载可能已经变化，重新检查样本数
+    bool enough = false;
+    auto loads = CollectLoads(&enough);
+    if (!enough) {
+        return;
+    }
+    double total_load = 0.0;
+    for (auto const& [_, load] : loads) {
+        total_load += load;
     }
+    double avg_load = total_load / node_replicas_.size();
 
-    for (auto const& [node, count] : curr_counts) {
-        int old_replicas = curr_replicas[node];
+    // 计算每个节点期望的虚拟节点数量
+    struct Adjustment {
+        std::string node;
+        int old_replicas;
+        int new_replicas;
+        double deviation;  // 负载偏离平均值的程度，偏离越大越优先调整
+    };
+    std::vector<Adjustment> plan;
+
+    for (auto const& [node, old_replicas] : node_replicas_) {
+        double load = loads.count(node) ? loads[node] : 0.0;
         double load_ratio = 0.0;
         if (avg_load > 0) {
-            load_ratio = static_cast<double>(count) / avg_load;
-        } else if (count > 0) {
+            load_ratio = load / avg_load;
+        } else if (load > 0) {
             load_ratio = 2.0;
         } else {
             load_ratio = 1.0;
@@ -262,31 +328,42 @@ void ConsistentHashMap::RebalanceNodes() {
         }
 
         if (new_replicas != old_replicas) {
-            // 重新添加节点的虚拟节点：先移除旧的，再添加新的
-            // 移除节点的所有虚拟节点
-            int replicas_to_remove = node_replicas_[node];
-            for (int i = 0; i < replicas_to_remove; ++i) {
-                std::string hashKey = node + "-" + std::to_string(i);
-                uint32_t hash = config_.hash_func(hashKey);
-                hash_map_.erase(hash);
-                auto it = std::remove(keys_.begin(), keys_.end(), hash);
-                keys_.erase(it, keys_.end());
-            }
-            node_replicas_.erase(node);
+            plan.push_back({node, old_replicas, new_replicas, std::abs(load_ratio - 1.0)});
+        }
+    }
+
+    // 每轮最多变动的虚拟节点数，变动的虚拟节点数近似正比于迁移的 key 数量，
+    // 限制它可以避免一次再平衡造成大面积缓存未命中
+    int budget = std::numeric_limits<int>::max();
+    if (config_.max_move_ratio > 0) {
+        budget = std::max(1, static_cast<int>(config_.max_move_ratio * static_cast<double>(keys_.size())));
+    }
+    std::sort(plan.begin(), plan.end(),
+              [](const Adjustment& a, const Adjustment& b) { return a.deviation > b.deviation; });
 
-            // 添加新的虚拟节点
-            AddNode(node, new_replicas);
+    for (auto& adj : plan) {
+        if (budget <= 0) {
+            break;
         }
+        int step = std::min(std::abs(adj.new_replicas - adj.old_replicas), budget);
+        int new_replicas = adj.new_replicas > adj.old_replicas ? adj.old_replicas + step : adj.old_replicas - step;
+        budget -= step;
+
+        // 重新添加节点的虚拟节点：先移除旧的，再添加新的
+        // 编号 0..n-1 的虚拟节点哈希不变，因此只有增减部分对应的 key 会迁移
+        RemoveNode(adj.node);
+        AddNode(adj.node, new_replicas);
     }
 
-    // 重置计数器
+    // 重置计数器，上报的负载已经反映不了调整后的分布，等待下一轮上报
     for (auto& pair : node_counts_) {
         pair.second.store(0);
     }
     total_requests_.store(0);
+    reported_loads_.clear();
 
     // 重新排序哈希环
     std::sort(keys_.begin(), keys_.end());
 }
 
-}  // namespace kcache
\ No newline at end of file
+}  // namespace kcache
@@ -0,0 +1,118 @@
+#include "kcache/batch_loader.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace kcache {
+
+BatchLoader::BatchLoader(BatchDataGetter getter, std::chrono::microseconds window, size_t max_batch_size,
+                         int concurrency)
+    : getter_(std::move(getter)),
+      window_(window),
+      max_batch_size_(std::max<size_t>(max_batch_size, 1)),
+      pool_(std::make_unique<LoaderPool>(std::max(concurrency, 1), 0)) {
+    collector_ = std::thread{[this] { CollectLoop(); }};
+}
+
+BatchLoader::~BatchLoader() {
+    {
+        std::lock_guard lock{mtx_};
+        is_stop_ = true;
+    }
+    cv_.notify_all();
+    if (collector_.joinable()) {
+        collector_.join();
+    }
+    pool_.reset();  // 等待已提交的批量加载完成
+}
+
+void BatchLoader::Submit(const std::string& key, Callback callback, Abandon abandon) {
+    bool notify = false;
+    {
+        std::lock_guard lock{mtx_};
+        queue_.push_back(Pending{key, std::move(callback), std::move(abandon), std::chrono::steady_clock::now()});
+        // 队列从空变为非空时开始计时，攒够一批时立即发起
+        notify = queue_.size() == 1 || queue_.size() >= max_batch_size_;
+    }
+    if (notify) {
+        cv_.notify_one();
+    }
+}
+
+void BatchLoader::CollectLoop() {
+    std::unique_lock lock{mtx_};
+    while (true) {
+        cv_.wait(lock, [this] { return is_stop_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            return;  // 已停止且没有剩余 key
+        }
+
+        // 等到最早的 key 窗口到期，或者攒够一批
+        auto deadline = queue_.front().arrival + window_;
+        cv_.wait_until(lock, deadline, [this] { return is_stop_ || queue_.size() >= max_batch_size_; });
+
+        size_t n = std::min(queue_.size(), max_batch_size_);
+        auto batch = std::make_shared<std::vector<Pending>>();
+        batch->reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            batch->push_back(std::move(queue_.front()));
+            queue_.pop_front();
+        }
+
+        lock.unlock();
+        if (!pool_->Submit([this, batch] { Flush(*batch); })) {
+            Flush(*batch);
+        }
+        lock.lock();
+    }
+}
+
+void BatchLoader::Flush(const std::vector<Pending>& pendings) {
+    // 攒批期间等待者可能已经全部超时离开，这些 key 不再加载
+    std::vector<const Pending*> batch;
+    batch.reserve(pendings.size());
+    for (const auto& pending : pendings) {
+        if (!pending.abandon || !pending.abandon()) {
+            batch.push_back(&pending);
+        }
+    }
+    if (batch.empty()) {
+        return;
+    }
+
+    std::vector<std::string> keys;
+    keys.reserve(batch.size());
+    for (const auto* pending : batch) {
+        keys.push_back(pending->key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::unordered_map<std::string, ByteViewOptional> values;
+    auto start = NowNs();
+    try {
+        values = getter_(keys);
+    } catch (const std::exception& e) {
+        spdlog::error("Batch getter throws for {} keys: {}", keys.size(), e.what());
+    }
+    auto cost = (NowNs() - start) / static_cast<int64_t>(keys.size());
+
+    // 结果中缺少的 key 说明这次查询出了问题，按失败处理，不能当作不存在写入负缓存
+    size_t missing = 0;
+    for (const auto* pending : batch) {
+        auto it = values.find(pending->key);
+        if (it == values.end()) {
+            ++missing;
+            pending->callback(std::nullopt, LoadStatus::kError, cost);
+        } else {
+            pending->callback(it->second, it->second ? LoadStatus::kOk : LoadStatus::kAbsent, cost);
+        }
+    }
+    if (missing > 0 && !values.empty()) {
+        spdlog::warn("Batch getter returns no result for {} of {} loads", missing, batch.size());
+    }
+}
+
+}  // namespace kcache
@@ -1,42 +1,338 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <shared_mutex>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <fmt/base.h>
 #include <spdlog/spdlog.h>
 
 #include "kcache/cache.h"
 #include "kcache/group.h"
+#include "kcache/log.h"
+#include "kcache/memory_budget.h"
 
 namespace kcache {
 
-std::unordered_map<std::string, KCacheGroup> cache_groups;
-std::mutex mtx;
+// 全局缓存组注册表，读多写少：查找不加锁，直接读取当前快照；注册时在锁内复制出新快照再发布。
+// 旧快照和被替换的缓存组按纪元回收：读取方在 GroupReadGuard 期间登记进入时的纪元，
+// 替换时把全局纪元加一并记下，所有登记的纪元都大于它（或没有读取方）时才释放
+struct GroupTable {
+    std::unordered_map<std::string, KCacheGroup*> by_name;
+    std::vector<KCacheGroup*> by_id;  // 下标为缓存组编号，0 号不使用
+};
 
-auto MakeCacheGroup(const std::string& name, int64_t bytes, DataGetter getter) -> KCacheGroup& {
-    if (getter == nullptr) {
+// 每个线程一个读取方槽位，线程退出后留给其他线程复用，槽位本身不释放
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch{0};  // 进入时的全局纪元，0 表示没有在读
+    std::atomic<bool> in_use{false};
+    ReaderSlot* next{nullptr};
+};
+
+// 等待回收的旧快照或被替换的缓存组
+struct Retired {
+    uint64_t epoch;
+    std::unique_ptr<GroupTable> table;
+    std::unique_ptr<KCacheGroup> group;
+};
+
+std::mutex registry_mtx;  // 注册和回收时使用
+std::unordered_map<std::string, std::unique_ptr<KCacheGroup>> group_storage;
+std::unique_ptr<GroupTable> current_table;
+std::vector<Retired> retired;
+std::atomic<size_t> retired_count{0};
+std::atomic<const GroupTable*> group_table{nullptr};
+std::atomic<uint64_t> global_epoch{1};
+std::atomic<ReaderSlot*> reader_slots{nullptr};
+
+// 当前线程占用的槽位和 GroupReadGuard 的嵌套深度
+class ReaderHandle {
+public:
+    ReaderHandle() {
+        for (auto* slot = reader_slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+            if (!slot->in_use.exchange(true)) {
+                slot_ = slot;
+                return;
+            }
+        }
+        slot_ = new ReaderSlot;
+        slot_->in_use = true;
+        slot_->next = reader_slots.load(std::memory_order_relaxed);
+        while (!reader_slots.compare_exchange_weak(slot_->next, slot_, std::memory_order_release)) {
+        }
+    }
+
+    ~ReaderHandle() { slot_->in_use = false; }
+
+    ReaderSlot* slot_;
+    int depth_{0};
+};
+
+auto LocalReader() -> ReaderHandle& {
+    thread_local ReaderHandle handle;
+    return handle;
+}
+
+// 释放已经没有读取方的旧快照和缓存组，调用时持有 registry_mtx；返回需要在锁外析构的缓存组
+auto CollectRetired() -> std::vector<std::unique_ptr<KCacheGroup>> {
+    std::vector<std::unique_ptr<KCacheGroup>> groups;
+    if (retired.empty()) {
+        return groups;
+    }
+    auto oldest = global_epoch.load();
+    for (auto* slot = reader_slots.load(std::memory_order_acquire); slot; slot = slot->next) {
+        auto epoch = slot->epoch.load();
+        if (epoch != 0) {
+            oldest = std::min(oldest, epoch);
+        }
+    }
+    auto it = std::partition(retired.begin(), retired.end(), [oldest](const Retired& r) { return r.epoch >= oldest; });
+    for (auto i = it; i != retired.end(); ++i) {
+        if (i->group) {
+            groups.push_back(std::move(i->group));
+        }
+    }
+    retired.erase(it, retired.end());
+    retired_count.store(retired.size(), std::memory_order_relaxed);
+    return groups;
+}
+
+// 租约表超过该大小时清理已过期的租约
+constexpr size_t kLeaseSweepThreshold = 1024;
+// 热点统计的窗口：采样数达到该值后计数减半
+constexpr int64_t kHotKeyWindow = 100000;
+
+// L0 缓存命中数攒够该值后计入主缓存的访问次数，分摊加锁的开销
+constexpr int64_t kL0HitBatch = 16;
+
+// 未设置加载超时时，析构等待异步 getter 回调的最长时间
+constexpr auto kAsyncLoadWait = std::chrono::milliseconds(10000);
+
+std::atomic<uint64_t> next_group_uid{1};
+
+// 每次回源失败都可能打日志，每秒最多输出的条数
+constexpr int kLoadLogPerSecond = 10;
+LogRateLimiter load_error_log{kLoadLogPerSecond};
+
+// 加载失败（getter 报错、加载被拒绝等）时通过 SingleFlight 传给所有等待者，与数据不存在区分开
+struct LoadFailed : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+auto MakeCacheGroup(const std::string& name, int64_t bytes, DataGetter getter, GroupOptions opts) -> KCacheGroup& {
+    if (getter == nullptr && opts.async_getter == nullptr && opts.batch_getter == nullptr) {
         spdlog::critical("no getter function!");
         std::exit(1);
     }
-    std::lock_guard lock{mtx};
-    cache_groups[name] = std::move(KCacheGroup{name, bytes, getter});
-    return cache_groups[name];
+    auto group = std::make_unique<KCacheGroup>(name, bytes, getter, opts);
+    auto& ret = *group;
+
+    std::unique_ptr<KCacheGroup> replaced;
+    uint64_t epoch = 0;
+    {
+        std::lock_guard lock{registry_mtx};
+        auto table = std::make_unique<GroupTable>();
+        if (current_table) {
+            *table = *current_table;
+        } else {
+            table->by_id.push_back(nullptr);
+        }
+        if (auto it = table->by_name.find(name); it != table->by_name.end()) {
+            group->id_ = it->second->id_;
+        } else {
+            group->id_ = static_cast<uint32_t>(table->by_id.size());
+            table->by_id.push_back(nullptr);
+        }
+        table->by_id[group->id_] = group.get();
+        table->by_name[name] = group.get();
+
+        auto& stored = group_storage[name];
+        replaced = std::move(stored);
+        stored = std::move(group);
+        group_table.store(table.get());
+        // 发布新快照之后再推进纪元，在此之后进入的读取方一定读到新快照
+        epoch = global_epoch.fetch_add(1);
+        if (current_table) {
+            retired.push_back(Retired{epoch, std::move(current_table), nullptr});
+        }
+        current_table = std::move(table);
+    }
+
+    // 关闭时要写回积压的数据，可能较慢，在锁外进行
+    if (replaced) {
+        spdlog::info("Cache group [{}] is replaced, close the old one", name);
+        replaced->Close();
+    }
+    std::vector<std::unique_ptr<KCacheGroup>> reclaimed;
+    std::lock_guard lock{registry_mtx};
+    if (replaced) {
+        retired.push_back(Retired{epoch, nullptr, std::move(replaced)});
+    }
+    reclaimed = CollectRetired();
+    return ret;
+}
+
+GroupReadGuard::GroupReadGuard() {
+    auto& reader = LocalReader();
+    if (reader.depth_++ == 0) {
+        // 先登记纪元再读取快照，与 MakeCacheGroup 中先发布快照再推进纪元配对
+        reader.slot_->epoch.store(global_epoch.load());
+    }
+}
+
+GroupReadGuard::~GroupReadGuard() {
+    auto& reader = LocalReader();
+    if (--reader.depth_ != 0) {
+        return;
+    }
+    reader.slot_->epoch.store(0, std::memory_order_release);
+    // 有等待回收的对象时顺便回收，拿不到锁就留给下一次
+    if (retired_count.load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    std::vector<std::unique_ptr<KCacheGroup>> reclaimed;
+    std::unique_lock lock{registry_mtx, std::try_to_lock};
+    if (lock.owns_lock()) {
+        reclaimed = CollectRetired();
+    }
 }
 
 auto GetCacheGroup(const std::string& name) -> KCacheGroup* {
-    std::lock_guard lock{mtx};
-    if (cache_groups.find(name) == cache_groups.end()) {
+    auto* table = group_table.load();
+    if (!table) {
         return nullptr;
     }
-    return &cache_groups[name];
+    auto it = table->by_name.find(name);
+    return it == table->by_name.end() ? nullptr : it->second;
+}
+
+auto GetCacheGroup(uint32_t id) -> KCacheGroup* {
+    auto* table = group_table.load();
+    if (!table || id >= table->by_id.size()) {
+        return nullptr;
+    }
+    return table->by_id[id];
+}
+
+auto GetCacheGroups() -> std::vector<KCacheGroup*> {
+    std::vector<KCacheGroup*> groups;
+    auto* table = group_table.load();
+    if (!table) {
+        return groups;
+    }
+    groups.reserve(table->by_name.size());
+    for (auto* group : table->by_id) {
+        if (group) {
+            groups.push_back(group);
+        }
+    }
+    return groups;
+}
+
+KCacheGroup::KCacheGroup(std::string name, int64_t bytes, DataGetter getter, GroupOptions opts)
+    : uid_(next_group_uid++),
+      tag_index_(std::make_unique<TagIndex>(opts.prefix_index)),
+      ghost_(std::make_unique<GhostCache>()),
+      name_(name),
+      getter_(getter),
+      opts_(std::move(opts)) {
+    // 淘汰回调只捕获索引和幽灵缓存本身，不依赖缓存组的其他状态
+    cache_ = std::make_unique<LRUCache>(
+        bytes, [index = tag_index_.get()](std::string key, ByteView) { index->Remove(key); },
+        [ghost = ghost_.get()](std::string key, ByteView value) { ghost->Add(key, key.size() + value.Len()); });
+    cache_->SetPolicy(opts_.eviction_policy);
+    if (opts_.batch_getter) {
+        // 并发未命中攒批加载，同时进行的批量加载数同样受 max_concurrent_loads 限制
+        batch_loader_ = std::make_unique<BatchLoader>(opts_.batch_getter, opts_.batch_window, opts_.max_batch_size,
+                                                      opts_.max_concurrent_loads);
+    } else if (!opts_.async_getter && opts_.max_concurrent_loads > 0) {
+        // 同步 getter 且限制了并发时，在组内的有界线程池上加载，避免慢查询阻塞请求线程
+        loader_pool_ = std::make_unique<LoaderPool>(opts_.max_concurrent_loads, opts_.max_pending_loads);
+    }
+    if (!batch_loader_ && !opts_.async_getter && !loader_pool_ && opts_.load_timeout.count() > 0) {
+        spdlog::warn("Group [{}] loads on request threads, load_timeout only applies to waiting requests, "
+                     "set max_concurrent_loads to bound the loading request as well", name_);
+    }
+    if (opts_.ttl.count() > 0 && opts_.refresh_ahead.count() > 0) {
+        refresh_pool_ = std::make_unique<LoaderPool>(1, 1024);
+    }
+    if (opts_.negative_ttl.count() > 0) {
+        negative_cache_ = std::make_unique<LRUCache>(opts_.negative_cache_bytes);
+    }
+    if (opts_.lease_ttl.count() > 0) {
+        stale_cache_ = std::make_unique<LRUCache>(opts_.lease_stale_bytes);
+    }
+    if (opts_.hot_key_capacity > 0) {
+        hot_keys_ = std::make_unique<HotKeySketch>(opts_.hot_key_capacity, opts_.hot_key_sample_rate,
+                                                   kHotKeyWindow, opts_.hot_key_ratio);
+    }
+    if (opts_.mrc_samples > 0) {
+        mrc_ = std::make_unique<MissRatioCurve>(opts_.mrc_samples, opts_.mrc_sample_rate);
+    }
+    if (opts_.write_behind_setter) {
+        write_behind_ = std::make_unique<WriteBehindQueue>(opts_.write_behind_setter, opts_.write_behind_interval,
+                                                           opts_.write_behind_batch_size,
+                                                           opts_.write_behind_max_pending);
+    }
+}
+
+void KCacheGroup::Close() {
+    if (is_close_.exchange(true)) {
+        return;
+    }
+    // 容量还给预算，预算也不再持有本对象
+    if (auto* budget = budget_.load()) {
+        budget->Detach(this);
+    }
+    if (write_behind_) {
+        write_behind_->Flush();
+    }
+}
+
+KCacheGroup::~KCacheGroup() {
+    refresh_pool_.reset();  // 先停止提前刷新，刷新任务本身也会发起加载
+    // 线程池中的加载在这里执行完或因等待者都已离开而被放弃，之后只剩异步 getter 发起的加载
+    batch_loader_.reset();
+    loader_pool_.reset();
+
+    // 异步 getter 可能永远不回调，等待者早已按 load_timeout 离开，析构不能因此无限期阻塞
+    auto timeout = opts_.load_timeout.count() > 0 ? opts_.load_timeout : kAsyncLoadWait;
+    std::unique_lock lock{inflight_mtx_};
+    if (!inflight_cv_.wait_for(lock, timeout, [this] { return inflight_loads_.load() == 0; })) {
+        spdlog::warn("Cache group [{}] is destroyed with {} async loads not completed in {}ms, drop their results",
+                     name_, inflight_loads_.load(), timeout.count());
+    }
+    lock.unlock();
+    // 等正在执行的回调结束，之后到达的回调直接丢弃
+    std::unique_lock guard_lock{async_guard_->mtx};
+    async_guard_->is_alive = false;
 }
 
 auto KCacheGroup::Get(const std::string& key) -> ByteViewOptional {
+    auto ret = GetVersioned(key);
+    if (!ret) {
+        return std::nullopt;
+    }
+    // 没有被 L0 缓存或其他等待者共享的值只属于这次调用（创建时不是 const 对象），直接移走，不再复制一次
+    if (ret->value.use_count() == 1) {
+        return std::move(*std::const_pointer_cast<ByteView>(ret->value));
+    }
+    return *ret->value;
+}
+
+auto KCacheGroup::GetVersioned(const std::string& key) -> std::optional<VersionedValue> {
+    TraceRoot trace{TraceStage::kGroupGet};
     if (is_close_) {
         spdlog::error("Cache group [{}] is closed!!!", name_);
         return std::nullopt;
@@ -47,18 +343,145 @@ auto KCacheGroup::Get(const std::string& key) -> ByteViewOptional {
         return std::nullopt;
     }
 
-    // 先从本地缓存中获取
-    auto ret = cache_->Get(key);
-    if (ret) {
+    if (hot_keys_) {
+        hot_keys_->Record(key);
+    }
+
+    auto now = NowNs();
+    // 先查线程本地的 L0 缓存，分段失效计数和代数都没有变化时数据仍然有效；必须在查本地缓存之前读取，
+    // 写入方先写缓存再增加失效计数，这样 L0 中不会留下比失效计数更旧的数据
+    size_t hash = 0;
+    uint64_t epoch = 0;
+    uint64_t generation = 0;
+    if (opts_.l0_ttl.count() > 0) {
+        hash = std::hash<std::string>{}(key);
+        epoch = L0Epoch(hash).load(std::memory_order_acquire);
+        generation = cache_->Generation();
+        auto l0 = L0Cache::Local().Find(uid_, hash, key);
+        if (l0 && l0->epoch == epoch && l0->generation == generation && now < l0->expire_at) {
+            ++status_.l0_hits;
+            // L0 命中不经过主缓存，攒够一批后计入访问次数，否则 GDSF 会把最热的 key 当作很少访问
+            if (++l0->hits >= kL0HitBatch && cache_->Policy() == CachePolicy::kGdsf) {
+                cache_->AddFrequency(key, l0->hits);
+                l0->hits = 0;
+            }
+            RecordAccess(key, key.size() + l0->value->Len());
+            return VersionedValue{l0->value, l0->version};
+        }
+    }
+
+    // 再从本地缓存中获取
+    auto entry = cache_->Lookup(key);
+    if (entry && !entry->IsExpired(now)) {
         ++status_.local_hits;  // 本地命中缓存次数+1
-        return ret;
+        RecordAccess(key, key.size() + entry->value_.Len());
+        // 热点数据即将过期时提前在后台刷新，读请求不用承担回源延迟
+        if (refresh_pool_ && entry->expire_at_ != 0 &&
+            entry->expire_at_ - now < std::chrono::nanoseconds(opts_.refresh_ahead).count()) {
+            RefreshAsync(key);
+        }
+        status_.hit_latency.Record(NowNs() - now);
+        auto value = std::make_shared<ByteView>(std::move(entry->value_));
+        if (opts_.l0_ttl.count() > 0) {
+            auto expire_at = now + std::chrono::nanoseconds(opts_.l0_ttl).count();
+            if (entry->expire_at_ != 0) {
+                expire_at = std::min(expire_at, entry->expire_at_);
+            }
+            L0Cache::Local().Put(L0Entry{uid_, hash, key, value, entry->version_, generation, epoch, expire_at});
+        }
+        return VersionedValue{std::move(value), entry->version_};
     }
 
     ++status_.local_misses;  // 本地未命中缓存次数+1
-    return Load(key);
+    ghost_->Hit(key);
+
+    // 已知不存在的 key 直接返回，不再回源
+    if ((opts_.key_filter && !opts_.key_filter(key)) || IsKnownAbsent(key)) {
+        ++status_.negative_hits;
+        RecordMiss(key);
+        return std::nullopt;
+    }
+
+    LoadStatus load_status;
+    auto ret = Load(key, &load_status);
+    auto miss_ns = NowNs() - now;
+    status_.miss_latency.Record(miss_ns);
+    if (ret) {
+        RecordAccess(key, key.size() + ret->Len(), miss_ns);
+    }
+    // 数据源确认不存在时不返回旧值，与负缓存保持一致
+    if (load_status == LoadStatus::kError && entry && opts_.stale_grace.count() > 0 &&
+        now < entry->expire_at_ + std::chrono::nanoseconds(opts_.stale_grace).count()) {
+        // 回源失败时在宽限期内返回旧值，数据源变慢或故障时保护它
+        ++status_.stale_hits;
+        LogRateLimited(load_error_log, spdlog::level::warn,
+                       "Serve stale value of key [{}] in group [{}] since load failed", key, name_);
+        RecordAccess(key, key.size() + entry->value_.Len(), miss_ns);
+        return VersionedValue{std::make_shared<ByteView>(std::move(entry->value_)), entry->version_};
+    }
+    if (!ret) {
+        RecordMiss(key, miss_ns);
+        return std::nullopt;
+    }
+    // 缓存中仍是这次回源的值时带上它的版本号，没有进入缓存或已被覆盖时版本号为 0
+    auto version = cache_->PeekVersion(key, *ret);
+    return VersionedValue{std::move(ret), version};
 }
 
-bool KCacheGroup::Set(const std::string& key, ByteView b) {
+auto KCacheGroup::GetReplica(const std::string& key, const DataGetter& fetch) -> ByteViewOptional {
+    if (is_close_ || key.empty()) {
+        return std::nullopt;
+    }
+    if (hot_keys_) {
+        hot_keys_->Record(key);
+    }
+
+    auto entry = cache_->Lookup(key);
+    if (entry && !entry->IsExpired(NowNs())) {
+        ++status_.local_hits;
+        return std::move(entry->value_);
+    }
+    ++status_.local_misses;
+
+    // 同一个 key 的并发未命中只向 owner 拉取一次
+    SingleFlight::SharedResult ret;
+    try {
+        ret = loader_.DoShared(
+            key,
+            [this, &key, &fetch](const SingleFlight::FlightPtr& flight) {
+                auto generation = cache_->Generation();
+                auto start = NowNs();
+                auto val = fetch(key);
+                auto fetch_ns = NowNs() - start;
+                status_.peer_latency.Record(fetch_ns);
+                if (!val) {
+                    ++status_.peer_misses;
+                } else {
+                    ++status_.peer_hits;
+                    auto ttl = opts_.hot_replica_ttl;
+                    if (opts_.ttl.count() > 0) {
+                        ttl = std::min(ttl, opts_.ttl);
+                    }
+                    if (cache_->Generation() == generation) {
+                        // 副本失效后的重新加载就是再向 owner 拉取一次，以这次拉取的耗时作为代价
+                        cache_->Set(key, *val, NowNs() + std::chrono::nanoseconds(ttl).count(), fetch_ns);
+                    }
+                }
+                flight->Complete(std::move(val));
+            },
+            opts_.load_timeout);
+    } catch (const std::exception& e) {
+        ++status_.peer_misses;
+        spdlog::error("Fetch key [{}] of group [{}] from owner throws: {}", key, name_, e.what());
+        return std::nullopt;
+    }
+    if (!ret) {
+        return std::nullopt;
+    }
+    return *ret;
+}
+
+bool KCacheGroup::Set(const std::string& key, ByteView b, const std::vector<std::string>& tags) {
     if (is_close_) {
         spdlog::error("Cache group [{}] is closed!!!", name_);
         return false;
@@ -67,11 +490,80 @@ bool KCacheGroup::Set(const std::string& key, ByteView b) {
         spdlog::warn("The key [{}] is empty, you can't set it into cache group", key);
         return false;
     }
-    cache_->Set(key, b);
-    spdlog::debug("key:{} is set value:{}", key, b.ToString());
+    // 同一个 key 的写数据源和写缓存串行执行，避免并发写入时两边的最终值不一致
+    std::lock_guard lock{WriteLock(key)};
+    if (!write_behind_ && opts_.setter && !Persist(key, b)) {
+        return false;
+    }
+    ForgetAbsent(key);
+    RevokeLease(key, false);
+    Store(key, b, tags);
+    InvalidateL0(key);
+    if (write_behind_) {
+        write_behind_->Put(key, b);
+    }
+    if (opts_.access_trace) {
+        opts_.access_trace->Record(AccessOp::kSet, key, key.size() + b.Len());
+    }
+    SPDLOG_DEBUG("key:{} is set value:{}", key, b);
     return true;
 }
 
+auto KCacheGroup::CompareAndSet(const std::string& key, ByteView b, uint64_t expected_version) -> CasResult {
+    CasResult result{false, 0};
+    auto entry = Mutate(key, [&](const Entry* current) -> ByteViewOptional {
+        result.version = current ? current->version_ : 0;
+        if (result.version != expected_version) {
+            return std::nullopt;
+        }
+        return b;
+    });
+    if (entry) {
+        result.ok = true;
+        result.version = entry->version_;
+    }
+    return result;
+}
+
+auto KCacheGroup::Incr(const std::string& key, int64_t delta) -> std::optional<std::pair<int64_t, uint64_t>> {
+    int64_t result = 0;
+    auto incr = [&](const Entry* current) -> ByteViewOptional {
+        int64_t value = 0;
+        if (current) {
+            const auto& data = current->value_.data_;
+            auto [ptr, ec] = std::from_chars(data.data(), data.data() + data.size(), value);
+            if (ec != std::errc{} || ptr != data.data() + data.size()) {
+                spdlog::warn("Value of key [{}] in group [{}] is not an integer", key, name_);
+                return std::nullopt;
+            }
+        }
+        if (__builtin_add_overflow(value, delta, &result)) {
+            spdlog::warn("Incr key [{}] in group [{}] overflows", key, name_);
+            return std::nullopt;
+        }
+        return ByteView{std::to_string(result)};
+    };
+    // 计数器可能只存在于数据源中，缓存中没有时先回源
+    auto entry = Mutate(key, incr, true);
+    if (!entry) {
+        return std::nullopt;
+    }
+    return std::make_pair(result, entry->version_);
+}
+
+auto KCacheGroup::Append(const std::string& key, ByteView suffix) -> uint64_t {
+    auto append = [&](const Entry* current) -> ByteViewOptional {
+        if (!current) {
+            return suffix;
+        }
+        ByteView value = current->value_;
+        value.data_.insert(value.data_.end(), suffix.data_.begin(), suffix.data_.end());
+        return value;
+    };
+    auto entry = Mutate(key, append, true);
+    return entry ? entry->version_ : 0;
+}
+
 bool KCacheGroup::Delete(const std::string& key) {
     if (is_close_) {
         spdlog::error("Cache group [{}] is closed!!!", name_);
@@ -81,8 +573,14 @@ bool KCacheGroup::Delete(const std::string& key) {
         spdlog::warn("The key [{}] is empty, you can't delete it from cache group", key);
         return false;
     }
+    ForgetAbsent(key);
+    RevokeLease(key, true);
     cache_->Delete(key);
-    spdlog::debug("key:{} is deleted", key);
+    InvalidateL0(key);
+    if (opts_.access_trace) {
+        opts_.access_trace->Record(AccessOp::kDelete, key, 0);
+    }
+    SPDLOG_DEBUG("key:{} is deleted", key);
     return true;
 }
 
@@ -96,32 +594,700 @@ bool KCacheGroup::InvalidateFromPeer(const std::string& key) {
         return false;
     }
 
-    // 来自其他节点的失效请求，删除本地缓存
+    // 来自其他节点的失效请求，删除本地缓存，key 可能已在其他节点被写入，负缓存也一并清除
+    ForgetAbsent(key);
+    RevokeLease(key, true);
     cache_->Delete(key);
-    spdlog::debug("Invalidated key [{}] from local cache (from peer)", key);
+    InvalidateL0(key);
+    SPDLOG_DEBUG("Invalidated key [{}] from local cache (from peer)", key);
+    return true;
+}
+
+auto KCacheGroup::InvalidateTag(const std::string& tag) -> int64_t {
+    if (is_close_ || tag.empty()) {
+        return 0;
+    }
+    auto keys = tag_index_->KeysWithTag(tag);
+    // 租约持有者填充时只带 tagger 生成的标签，因此只需撤销索引中带该标签的 key 以及 tagger 会打上该标签的 key
+    std::unordered_set<std::string> tagged{keys.begin(), keys.end()};
+    RevokeLeases([this, &tag, &tagged](const std::string& key) {
+        if (tagged.count(key) > 0) {
+            return true;
+        }
+        if (!opts_.tagger) {
+            return false;
+        }
+        auto tags = opts_.tagger(key);
+        return std::find(tags.begin(), tags.end(), tag) != tags.end();
+    });
+    InvalidateKeys(keys);
+    SPDLOG_DEBUG("Invalidated {} keys with tag [{}] in group [{}]", keys.size(), tag, name_);
+    return static_cast<int64_t>(keys.size());
+}
+
+auto KCacheGroup::InvalidatePrefix(const std::string& prefix) -> int64_t {
+    if (is_close_ || prefix.empty()) {
+        return 0;
+    }
+    auto match = [&prefix](const std::string& key) { return key.compare(0, prefix.size(), prefix) == 0; };
+    std::vector<std::string> keys;
+    if (tag_index_->IndexesPrefixes()) {
+        keys = tag_index_->KeysWithPrefix(prefix);
+    } else {
+        // 已过期的 key 在宽限期内仍可能作为旧值返回，同样需要失效
+        for (auto& key : cache_->Keys(0, true)) {
+            if (match(key)) {
+                keys.push_back(std::move(key));
+            }
+        }
+    }
+    RevokeLeases(match);
+    InvalidateKeys(keys);
+    SPDLOG_DEBUG("Invalidated {} keys with prefix [{}] in group [{}]", keys.size(), prefix, name_);
+    return static_cast<int64_t>(keys.size());
+}
+
+auto KCacheGroup::Flush() -> uint64_t {
+    cache_->Flush();
+    if (negative_cache_) {
+        negative_cache_->Flush();
+    }
+    if (stale_cache_) {
+        stale_cache_->Flush();
+    }
+    RevokeLeases([](const std::string&) { return true; });
+    spdlog::info("Cache group [{}] is flushed, generation: {}", name_, cache_->Generation());
+    return cache_->Generation();
+}
+
+bool KCacheGroup::Warm(const std::string& key, ByteView b, int64_t expire_at) {
+    if (is_close_ || key.empty() || (expire_at != 0 && expire_at <= NowNs())) {
+        return false;
+    }
+    ForgetAbsent(key);
+    if (!cache_->SetIfAbsent(key, b, expire_at)) {
+        return false;
+    }
+    if (opts_.tagger || tag_index_->IndexesPrefixes()) {
+        tag_index_->Add(key, opts_.tagger ? opts_.tagger(key) : std::vector<std::string>{});
+    }
+    return true;
+}
+
+auto KCacheGroup::GetOrLease(const std::string& key) -> LeaseResult {
+    LeaseResult result;
+    if (!stale_cache_) {
+        // 未开启租约，退化为普通读取
+        result.value = Get(key);
+        result.hit = result.value.has_value();
+        return result;
+    }
+    if (is_close_ || key.empty()) {
+        return result;
+    }
+
+    auto entry = cache_->Lookup(key);
+    auto now = NowNs();
+    if (entry && !entry->IsExpired(now)) {
+        ++status_.local_hits;
+        result.value = std::move(entry->value_);
+        result.hit = true;
+        return result;
+    }
+    ++status_.local_misses;
+
+    if ((opts_.key_filter && !opts_.key_filter(key)) || IsKnownAbsent(key)) {
+        ++status_.negative_hits;
+        return result;
+    }
+
+    if (auto pending = PendingWrite(key)) {
+        Store(key, *pending);
+        result.value = std::move(pending);
+        result.hit = true;
+        return result;
+    }
+
+    {
+        std::lock_guard lock{lease_mtx_};
+        auto it = leases_.find(key);
+        if (it == leases_.end() || it->second.expire_at <= now) {
+            // 没有租约或持有者超时未填充，发放新租约
+            if (leases_.size() >= kLeaseSweepThreshold) {
+                for (auto lit = leases_.begin(); lit != leases_.end();) {
+                    lit = lit->second.expire_at <= now ? leases_.erase(lit) : std::next(lit);
+                }
+            }
+            result.token = next_lease_token_++;
+            leases_[key] = Lease{result.token, now + std::chrono::nanoseconds(opts_.lease_ttl).count()};
+            ++status_.lease_grants;
+            return result;
+        }
+    }
+
+    // 别人正在回源，返回旧值或者让调用方稍后重试
+    ++status_.lease_waits;
+    result.value = entry ? std::optional<ByteView>{std::move(entry->value_)} : stale_cache_->Get(key);
+    result.stale = result.value.has_value();
+    result.retry_after = std::max(opts_.lease_retry, std::chrono::milliseconds(1));
+    return result;
+}
+
+bool KCacheGroup::Fill(const std::string& key, ByteViewOptional value, uint64_t token) {
+    if (is_close_ || key.empty() || !stale_cache_) {
+        return false;
+    }
+    // 在租约锁内写入，保证与失效操作互斥：失效之后的填充一定会被拒绝
+    std::lock_guard lock{lease_mtx_};
+    auto it = leases_.find(key);
+    if (it == leases_.end() || it->second.token != token) {
+        SPDLOG_DEBUG("Reject fill of key [{}] in group [{}], lease is revoked", key, name_);
+        return false;
+    }
+    leases_.erase(it);
+    stale_cache_->Delete(key);
+    if (!value) {
+        RememberAbsent(key);
+        return true;
+    }
+    ForgetAbsent(key);
+    Store(key, *value);
+    InvalidateL0(key);
+    return true;
+}
+
+auto KCacheGroup::Peek(const std::string& key) -> ByteViewOptional { return cache_->Peek(key); }
+
+auto KCacheGroup::PeekEntry(const std::string& key) -> std::optional<Entry> {
+    auto entry = cache_->PeekEntry(key);
+    if (entry && entry->IsExpired(NowNs())) {
+        return std::nullopt;
+    }
+    return entry;
+}
+
+auto KCacheGroup::HotKeys(size_t limit) -> std::vector<std::string> { return cache_->Keys(limit); }
+
+auto KCacheGroup::IsHotKey(const std::string& key) -> bool {
+    return hot_keys_ && hot_keys_->IsHot(key);
+}
+
+auto KCacheGroup::TopKeys(size_t k) -> std::vector<HotKey> {
+    if (!hot_keys_) {
+        return {};
+    }
+    return hot_keys_->TopK(k);
+}
+
+auto KCacheGroup::Stats() const -> GroupStats {
+    return GroupStats{
+        status_.loads.Load(),
+        status_.local_hits.Load(),
+        status_.local_misses.Load(),
+        status_.peer_hits.Load(),
+        status_.peer_misses.Load(),
+        status_.loader_hits.Load(),
+        status_.loader_errors.Load(),
+        status_.load_duration.Load(),
+        status_.refreshes.Load(),
+        status_.stale_hits.Load(),
+        status_.negative_hits.Load(),
+        status_.lease_grants.Load(),
+        status_.lease_waits.Load(),
+        status_.write_errors.Load(),
+        write_behind_ ? write_behind_->Written() : 0,
+        write_behind_ ? write_behind_->Failed() : 0,
+        write_behind_ ? static_cast<int64_t>(write_behind_->Size()) : 0,
+        status_.l0_hits.Load(),
+        cache_->Bytes(),
+        cache_->Len(),
+        cache_->MaxBytes(),
+        cache_->Evictions(),
+        loader_.Flights(),
+        loader_.Deduplicated(),
+        ghost_->Hits(),
+        status_.hit_latency.Snapshot().Summary(),
+        status_.miss_latency.Snapshot().Summary(),
+        status_.load_latency.Snapshot().Summary(),
+        status_.peer_latency.Snapshot().Summary(),
+    };
+}
+
+auto KCacheGroup::Histograms() const -> std::vector<std::pair<std::string, HistogramSnapshot>> {
+    return {
+        {"hit", status_.hit_latency.Snapshot()},
+        {"miss", status_.miss_latency.Snapshot()},
+        {"load", status_.load_latency.Snapshot()},
+        {"peer", status_.peer_latency.Snapshot()},
+    };
+}
+
+auto KCacheGroup::Occupancy() const -> std::vector<CacheOccupancy> {
+    std::vector<CacheOccupancy> tiers;
+    auto add = [&tiers](const char* tier, const LRUCache& cache) {
+        tiers.push_back(CacheOccupancy{tier, cache.Bytes(), cache.MaxBytes(), cache.Len(), cache.Evictions()});
+    };
+    add("main", *cache_);
+    if (negative_cache_) {
+        add("negative", *negative_cache_);
+    }
+    if (stale_cache_) {
+        add("stale", *stale_cache_);
+    }
+    return tiers;
+}
+
+auto KCacheGroup::Config() const -> std::vector<std::pair<std::string, std::string>> {
+    auto ms = [](std::chrono::milliseconds d) { return std::to_string(d.count()); };
+    auto flag = [](bool b) { return std::string{b ? "true" : "false"}; };
+    return {
+        {"max_bytes", std::to_string(cache_->MaxBytes())},
+        {"eviction_policy", EvictionPolicy()},
+        {"getter", opts_.batch_getter ? "batch" : opts_.async_getter ? "async" : "sync"},
+        {"max_concurrent_loads", std::to_string(opts_.max_concurrent_loads)},
+        {"max_pending_loads", std::to_string(opts_.max_pending_loads)},
+        {"load_timeout_ms", ms(opts_.load_timeout)},
+        {"ttl_ms", ms(opts_.ttl)},
+        {"refresh_ahead_ms", ms(opts_.refresh_ahead)},
+        {"stale_grace_ms", ms(opts_.stale_grace)},
+        {"negative_ttl_ms", ms(opts_.negative_ttl)},
+        {"lease_ttl_ms", ms(opts_.lease_ttl)},
+        {"write_mode", write_behind_ ? "write-behind" : opts_.setter ? "write-through" : "none"},
+        {"prefix_index", flag(opts_.prefix_index)},
+        {"hot_key_capacity", std::to_string(opts_.hot_key_capacity)},
+        {"hot_key_ratio", std::to_string(opts_.hot_key_ratio)},
+        {"l0_ttl_ms", ms(opts_.l0_ttl)},
+        {"mrc_samples", std::to_string(opts_.mrc_samples)},
+        {"mrc_sample_rate", mrc_ ? std::to_string(mrc_->SampleRate()) : "0"},
+        {"access_trace_rate", opts_.access_trace ? std::to_string(opts_.access_trace->SampleRate()) : "0"},
+    };
+}
+
+auto KCacheGroup::HitRatioCurve() -> std::vector<MrcPoint> {
+    if (!mrc_) {
+        return {};
+    }
+    // 容量不限时从 1KB 开始
+    auto max_bytes = cache_->MaxBytes();
+    auto min_bytes = max_bytes > 0 ? std::max<int64_t>(max_bytes / 16, 1) : int64_t{1} << 10;
+    return mrc_->Curve(min_bytes, max_bytes > 0 ? max_bytes * 16 : int64_t{1} << 40);
+}
+
+auto KCacheGroup::SetMaxBytes(int64_t max_bytes) -> int64_t {
+    auto evicted = cache_->SetMaxBytes(max_bytes);
+    spdlog::info("Cache group [{}] is resized to {} bytes, {} entries evicted", name_, max_bytes, evicted);
+    return evicted;
+}
+
+auto KCacheGroup::EvictionPolicy() const -> std::string { return CachePolicyName(cache_->Policy()); }
+
+bool KCacheGroup::SetEvictionPolicy(const std::string& policy) {
+    CachePolicy parsed;
+    if (!ParseCachePolicy(policy, &parsed)) {
+        return false;
+    }
+    cache_->SetPolicy(parsed);
     return true;
 }
 
-auto KCacheGroup::Load(const std::string& key) -> ByteViewOptional {
-    auto ret = loader_.Do(key, [&] { return LoadData(key); });
+auto KCacheGroup::Load(const std::string& key, LoadStatus* status) -> std::shared_ptr<const ByteView> {
+    LoadStatus ignored;
+    if (!status) {
+        status = &ignored;
+    }
+    *status = LoadStatus::kError;
+    // 被淘汰但还没写回的数据以待写入的值为准
+    if (auto pending = PendingWrite(key)) {
+        Store(key, *pending);
+        *status = LoadStatus::kOk;
+        return std::make_shared<ByteView>(std::move(*pending));
+    }
+
+    // 每个等待者各自按 load_timeout 放弃等待，全部放弃后尚未开始的加载会被跳过
+    SingleFlight::SharedResult ret;
+    try {
+        ret = loader_.DoShared(
+            key, [this, &key](const SingleFlight::FlightPtr& flight) { LoadData(key, flight); }, opts_.load_timeout);
+    } catch (const LoadFailed& e) {
+        // 失败次数已经在发起加载的一方统计过
+        LogRateLimited(load_error_log, spdlog::level::err, "Failed to load key [{}] of group [{}]: {}", key, name_,
+                       e.what());
+        return nullptr;
+    } catch (const std::exception& e) {
+        ++status_.loader_errors;
+        spdlog::error("Getter of group [{}] throws: {}", name_, e.what());
+        return nullptr;
+    }
     if (!ret) {
-        spdlog::error("Failed to load data for key: {}", key);
+        ++status_.loader_errors;
+        LogRateLimited(load_error_log, spdlog::level::warn, "Load key [{}] of group [{}] timeout after {}ms", key,
+                       name_, opts_.load_timeout.count());
+        return nullptr;
+    }
+    if (!*ret) {
+        *status = LoadStatus::kAbsent;
+        SPDLOG_DEBUG("Key [{}] of group [{}] does not exist in data source", key, name_);
+        return nullptr;
+    }
+    *status = LoadStatus::kOk;
+    return std::shared_ptr<const ByteView>(ret, &**ret);
+}
+
+void KCacheGroup::LoadData(const std::string& key, const SingleFlight::FlightPtr& flight) {
+    // 每次未命中都会经过这里，只输出编译期开启的调试日志，不在热路径上争抢限速计数器
+    SPDLOG_DEBUG("Try to load key [{}] of group [{}] from data source", key, name_);
+    // 由完成加载的一方写入缓存，等待者只共享结果；加载期间缓存组被 Flush 时结果可能已经过时，不再写入缓存
+    auto generation = cache_->Generation();
+    auto done = [this, key, flight, generation](ByteViewOptional val, LoadStatus status, int64_t cost) {
+        if (status == LoadStatus::kError) {
+            flight->Fail(std::make_exception_ptr(LoadFailed{"loader failed"}));
+            return;
+        }
+        if (cache_->Generation() != generation) {
+            SPDLOG_DEBUG("Group [{}] is flushed while loading key [{}], skip caching", name_, key);
+        } else {
+            if (val) {
+                Store(key, *val, {}, cost);
+            } else {
+                // 只有数据源明确返回不存在时才写入负缓存，失败、超时和拒绝不算
+                RememberAbsent(key);
+            }
+            // 与 Set、Fill 一样使其他线程 L0 中的副本失效，提前刷新和重新加载的结果立即可见
+            InvalidateL0(key);
+        }
+        flight->Complete(std::move(val));
+    };
+
+    if (!batch_loader_ && !opts_.async_getter && !loader_pool_) {
+        // 通过getter从数据源获取，并记录加载耗时；getter 抛出的异常由 SingleFlight 传给所有等待者
+        auto start = NowNs();
+        auto val = getter_(key);
+        auto cost = NowNs() - start;
+        RecordLoad(cost, val.has_value(), Tracer::Current());
+        auto status = val ? LoadStatus::kOk : LoadStatus::kAbsent;
+        done(std::move(val), status, cost);
+        return;
+    }
+
+    if (!StartLoad(key, flight, done)) {
+        ++status_.loader_errors;
+        LogRateLimited(load_error_log, spdlog::level::warn,
+                       "Too many loads in progress for group [{}], reject key [{}]", name_, key);
+        flight->Fail(std::make_exception_ptr(LoadFailed{"too many loads in progress"}));
+    }
+}
+
+bool KCacheGroup::StartLoad(const std::string& key, const SingleFlight::FlightPtr& flight, LoadDone done) {
+    int prev = inflight_loads_.fetch_add(1);
+    if (!batch_loader_ && opts_.async_getter && opts_.max_concurrent_loads > 0 && prev >= opts_.max_concurrent_loads) {
+        FinishLoad();
+        return false;
+    }
+
+    // 保证回调只生效一次，getter 多次回调或抛出异常时不会重复完成
+    auto called = std::make_shared<std::atomic<bool>>(false);
+    LoadDone finish = [this, called, trace = Tracer::Current(), done = std::move(done)](
+                          ByteViewOptional val, LoadStatus status, int64_t cost) {
+        if (called->exchange(true)) {
+            return;
+        }
+        RecordLoad(cost, status == LoadStatus::kOk, trace);
+        done(std::move(val), status, cost);
+        FinishLoad();
+    };
+    // 等待者都已离开时直接放弃，不访问数据源
+    auto abandon = [this, called] {
+        if (!called->exchange(true)) {
+            FinishLoad();
+        }
+    };
+
+    if (batch_loader_) {
+        // 攒批窗口结束时等待者可能都已离开
+        batch_loader_->Submit(key, finish, [flight, abandon] {
+            if (!flight->Cancelled()) {
+                return false;
+            }
+            abandon();
+            return true;
+        });
+        return true;
+    }
+
+    if (opts_.async_getter) {
+        if (flight->Cancelled()) {
+            abandon();
+            return true;
+        }
+        auto start = NowNs();
+        LoadCallback callback{[finish, start, guard = async_guard_](ByteViewOptional val, LoadStatus status) {
+            std::shared_lock lock{guard->mtx};
+            if (!guard->is_alive) {
+                return;  // 缓存组已经析构
+            }
+            finish(std::move(val), status, NowNs() - start);
+        }};
+        try {
+            opts_.async_getter(key, callback);
+        } catch (const std::exception& e) {
+            spdlog::error("Async getter of group [{}] throws: {}", name_, e.what());
+            callback.Fail();
+        }
+        return true;
+    }
+
+    // 代价只计 getter 本身的耗时，不包括在线程池中排队的时间
+    bool ok = loader_pool_->Submit([this, key, flight, finish, abandon] {
+        if (flight->Cancelled()) {
+            abandon();
+            return;
+        }
+        auto start = NowNs();
+        try {
+            auto val = getter_(key);
+            auto status = val ? LoadStatus::kOk : LoadStatus::kAbsent;
+            finish(std::move(val), status, NowNs() - start);
+        } catch (const std::exception& e) {
+            spdlog::error("Getter of group [{}] throws: {}", name_, e.what());
+            finish(std::nullopt, LoadStatus::kError, NowNs() - start);
+        }
+    });
+    if (!ok) {
+        FinishLoad();
+    }
+    return ok;
+}
+
+void KCacheGroup::RecordLoad(int64_t cost, bool ok, uint64_t trace) {
+    if (trace != 0) {
+        Tracer::Record(trace, TraceStage::kLoad, NowNs() - cost, cost);
+    }
+    ++status_.loads;
+    status_.load_duration += cost;
+    status_.load_latency.Record(std::chrono::nanoseconds(cost));
+    if (ok) {
+        ++status_.loader_hits;
+    } else {
+        ++status_.loader_errors;
+    }
+}
+
+void KCacheGroup::RefreshAsync(const std::string& key) {
+    {
+        std::lock_guard lock{refresh_mtx_};
+        if (!refreshing_.insert(key).second) {
+            return;  // 已经在刷新
+        }
+    }
+    bool ok = refresh_pool_->Submit([this, key] {
+        ++status_.refreshes;
+        // 刷新失败时保留旧值，直到真正过期
+        Load(key);
+        std::lock_guard lock{refresh_mtx_};
+        refreshing_.erase(key);
+    });
+    if (!ok) {
+        std::lock_guard lock{refresh_mtx_};
+        refreshing_.erase(key);
+    }
+}
+
+auto KCacheGroup::ExpireAt() const -> int64_t {
+    if (opts_.ttl.count() <= 0) {
+        return 0;
+    }
+    return NowNs() + std::chrono::nanoseconds(opts_.ttl).count();
+}
+
+auto KCacheGroup::Mutate(const std::string& key, const LRUCache::UpdateFunc& fn, bool load_missing)
+    -> std::optional<Entry> {
+    if (is_close_ || key.empty()) {
         return std::nullopt;
     }
-    cache_->Set(key, ret.value());
-    // TODO 记录加载时间
-    return ret;
+    std::lock_guard lock{WriteLock(key)};
+
+    // 缓存中没有有效值时在写锁内回源，回源得到的值只作为这次计算的基准，不依赖它留在缓存中；
+    // 回源失败时直接返回失败，不能从空值开始计算，否则会把数据源中的值重置掉
+    std::optional<Entry> loaded;
+    if (load_missing) {
+        auto current = cache_->PeekEntry(key);
+        bool known_absent = (opts_.key_filter && !opts_.key_filter(key)) || IsKnownAbsent(key);
+        if ((!current || current->IsExpired(NowNs())) && !known_absent) {
+            LoadStatus status;
+            auto value = Load(key, &status);
+            if (status == LoadStatus::kError) {
+                spdlog::warn("Failed to load key [{}] of group [{}] before update", key, name_);
+                return std::nullopt;
+            }
+            if (value) {
+                loaded.emplace(key, *value);
+            }
+        }
+    }
+    auto update = [&fn, &loaded](const Entry* current) {
+        return fn(current ? current : loaded ? &*loaded : nullptr);
+    };
+
+    if (write_behind_ || !opts_.setter) {
+        auto entry = Commit(key, update);
+        if (entry && write_behind_) {
+            write_behind_->Put(key, entry->value_);
+        }
+        return entry;
+    }
+
+    // write-through：先算出新值写入数据源，成功后再写缓存，同一个 key 的写入已经由写锁串行化
+    auto current = cache_->PeekEntry(key);
+    if (current && current->IsExpired(NowNs())) {
+        current.reset();
+    }
+    auto value = update(current ? &*current : nullptr);
+    if (!value || !Persist(key, *value)) {
+        return std::nullopt;
+    }
+    return Commit(key, [&value](const Entry*) { return value; });
+}
+
+auto KCacheGroup::Commit(const std::string& key, const LRUCache::UpdateFunc& fn) -> std::optional<Entry> {
+    std::optional<Entry> entry;
+    if (stale_cache_) {
+        // 在租约锁内写入并撤销租约，与 Fill 互斥，之前发放的租约不会用旧值覆盖这次写入
+        std::lock_guard lease_lock{lease_mtx_};
+        entry = cache_->Update(key, fn, ExpireAt());
+        if (entry) {
+            leases_.erase(key);
+            stale_cache_->Delete(key);
+        }
+    } else {
+        entry = cache_->Update(key, fn, ExpireAt());
+    }
+    if (!entry) {
+        return std::nullopt;
+    }
+    // 写入成功后才清理负缓存、更新索引；写入后立即被淘汰时索引中会残留标签，只会导致多失效，不会漏失效
+    ForgetAbsent(key);
+    if (opts_.tagger || tag_index_->IndexesPrefixes()) {
+        tag_index_->Add(key, opts_.tagger ? opts_.tagger(key) : std::vector<std::string>{});
+    }
+    InvalidateL0(key);
+    return entry;
+}
+
+bool KCacheGroup::Persist(const std::string& key, const ByteView& value) {
+    bool ok = false;
+    try {
+        ok = opts_.setter(key, value);
+    } catch (const std::exception& e) {
+        spdlog::error("Setter of group [{}] throws: {}", name_, e.what());
+    }
+    if (!ok) {
+        // 数据源写入失败时不更新缓存，保持与数据源一致
+        ++status_.write_errors;
+        spdlog::error("Failed to write key [{}] of group [{}] to backing store", key, name_);
+    }
+    return ok;
+}
+
+auto KCacheGroup::WriteLock(const std::string& key) -> std::mutex& {
+    return write_locks_[std::hash<std::string>{}(key) % write_locks_.size()];
+}
+
+void KCacheGroup::Store(const std::string& key, const ByteView& value, const std::vector<std::string>& tags,
+                        int64_t cost) {
+    // 先更新索引再写缓存，写入时立即被淘汰也能通过淘汰回调清理索引；
+    // 没有标签时不更新索引，之前的标签可能残留，只会导致多失效，不会漏失效
+    if (!tags.empty()) {
+        tag_index_->Add(key, tags);
+    } else if (opts_.tagger || tag_index_->IndexesPrefixes()) {
+        tag_index_->Add(key, opts_.tagger ? opts_.tagger(key) : std::vector<std::string>{});
+    }
+    cache_->Set(key, value, ExpireAt(), cost);
 }
 
-auto KCacheGroup::LoadData(const std::string& key) -> ByteViewOptional {
-    spdlog::info("Try to load key [{}] from local", key);
-    // 通过getter从数据源获取
-    auto val = getter_(key);
-    if (!val) {
+void KCacheGroup::InvalidateKeys(const std::vector<std::string>& keys) {
+    for (const auto& key : keys) {
+        RevokeLease(key, true);
+        cache_->Delete(key);
+        InvalidateL0(key);
+    }
+}
+
+auto KCacheGroup::PendingWrite(const std::string& key) -> ByteViewOptional {
+    if (!write_behind_) {
         return std::nullopt;
     }
-    ++status_.local_hits;
-    return val;
+    return write_behind_->Pending(key);
+}
+
+void KCacheGroup::InvalidateL0(const std::string& key) {
+    if (opts_.l0_ttl.count() > 0) {
+        L0Epoch(std::hash<std::string>{}(key)).fetch_add(1, std::memory_order_release);
+    }
+}
+
+auto KCacheGroup::L0Epoch(size_t hash) -> std::atomic<uint64_t>& { return l0_epochs_[hash % kL0Stripes].value; }
+
+void KCacheGroup::RememberAbsent(const std::string& key) {
+    if (negative_cache_) {
+        negative_cache_->Set(key, ByteView{""}, NowNs() + std::chrono::nanoseconds(opts_.negative_ttl).count());
+    }
+}
+
+auto KCacheGroup::IsKnownAbsent(const std::string& key) -> bool {
+    return negative_cache_ && negative_cache_->Get(key).has_value();
+}
+
+void KCacheGroup::ForgetAbsent(const std::string& key) {
+    if (negative_cache_) {
+        negative_cache_->Delete(key);
+    }
+}
+
+void KCacheGroup::RevokeLease(const std::string& key, bool stash_stale) {
+    if (!stale_cache_) {
+        return;
+    }
+    std::lock_guard lock{lease_mtx_};
+    leases_.erase(key);
+    if (!stash_stale) {
+        stale_cache_->Delete(key);
+        return;
+    }
+    if (auto old = cache_->Peek(key)) {
+        stale_cache_->Set(key, *old, NowNs() + std::chrono::nanoseconds(opts_.lease_stale_ttl).count());
+    }
+}
+
+void KCacheGroup::RevokeLeases(const std::function<bool(const std::string& key)>& match) {
+    if (!stale_cache_) {
+        return;
+    }
+    std::lock_guard lock{lease_mtx_};
+    for (auto it = leases_.begin(); it != leases_.end();) {
+        it = match(it->first) ? leases_.erase(it) : std::next(it);
+    }
+}
+
+void KCacheGroup::FinishLoad() {
+    std::lock_guard lock{inflight_mtx_};
+    if (--inflight_loads_ == 0) {
+        inflight_cv_.notify_all();
+    }
+}
+
+void KCacheGroup::RecordAccess(const std::string& key, int64_t bytes, int64_t cost) {
+    if (mrc_) {
+        mrc_->Record(key, bytes);
+    }
+    if (opts_.access_trace) {
+        opts_.access_trace->Record(AccessOp::kGet, key, bytes, cost);
+    }
+}
+
+void KCacheGroup::RecordMiss(const std::string& key, int64_t cost) {
+    if (opts_.access_trace) {
+        opts_.access_trace->Record(AccessOp::kGetMiss, key, 0, cost);
+    }
 }
 
-}  // namespace kcache
\ No newline at end of file
+}  // namespace kcache
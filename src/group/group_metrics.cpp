@@ -0,0 +1,57 @@
+#include <string>
+
+#include "kcache/group.h"
+#include "kcache/metrics.h"
+
+namespace kcache {
+
+void WriteGroupMetrics(PrometheusWriter* writer) {
+    GroupReadGuard guard;
+    for (auto* group : GetCacheGroups()) {
+        auto labels = PrometheusWriter::Label("group", group->Name());
+        auto stats = group->Stats();
+        auto with = [&labels](const char* key, const char* value) {
+            return labels + "," + PrometheusWriter::Label(key, value);
+        };
+
+        writer->Counter("kcache_hits_total", "Cache hits by tier", with("tier", "local"), stats.local_hits);
+        writer->Counter("kcache_hits_total", "Cache hits by tier", with("tier", "l0"), stats.l0_hits);
+        writer->Counter("kcache_hits_total", "Cache hits by tier", with("tier", "stale"), stats.stale_hits);
+        writer->Counter("kcache_hits_total", "Cache hits by tier", with("tier", "negative"), stats.negative_hits);
+        writer->Counter("kcache_misses_total", "Local cache misses", labels, stats.local_misses);
+        writer->Counter("kcache_loads_total", "Loads from the data source by result", with("result", "ok"),
+                        stats.loader_hits);
+        writer->Counter("kcache_loads_total", "Loads from the data source by result", with("result", "error"),
+                        stats.loader_errors);
+        writer->Counter("kcache_peer_fetches_total", "Hot key replica fetches from the owner by result",
+                        with("result", "ok"), stats.peer_hits);
+        writer->Counter("kcache_peer_fetches_total", "Hot key replica fetches from the owner by result",
+                        with("result", "error"), stats.peer_misses);
+        writer->Counter("kcache_evictions_total", "Entries evicted for capacity", labels, stats.evictions);
+        writer->Counter("kcache_singleflight_flights_total", "Loads actually started by SingleFlight", labels,
+                        stats.flights);
+        writer->Counter("kcache_singleflight_deduplicated_total", "Callers that joined an in-flight load", labels,
+                        stats.deduplicated);
+        writer->Counter("kcache_ghost_hits_total", "Misses that a slightly larger cache would have served", labels,
+                        stats.ghost_hits);
+        writer->Counter("kcache_refreshes_total", "Background refresh-ahead reloads", labels, stats.refreshes);
+        writer->Counter("kcache_lease_grants_total", "Leases granted", labels, stats.lease_grants);
+        writer->Counter("kcache_write_errors_total", "Failed write-through writes", labels, stats.write_errors);
+        writer->Gauge("kcache_bytes", "Bytes used by cached entries", labels, stats.cache_bytes);
+        writer->Gauge("kcache_max_bytes", "Cache capacity in bytes", labels, stats.max_bytes);
+        writer->Gauge("kcache_entries", "Number of cached entries", labels, stats.cache_entries);
+        writer->Gauge("kcache_write_behind_pending", "Keys waiting to be written back", labels,
+                      stats.write_behind_pending);
+
+        for (const auto& point : group->HitRatioCurve()) {
+            writer->Gauge("kcache_estimated_hit_ratio", "Estimated hit ratio at a given cache size",
+                          with("cache_bytes", std::to_string(point.cache_bytes).c_str()), point.hit_ratio);
+        }
+        for (const auto& [path, snapshot] : group->Histograms()) {
+            writer->Histogram("kcache_latency_seconds", "Latency by request path", with("path", path.c_str()),
+                              snapshot);
+        }
+    }
+}
+
+}  // namespace kcache
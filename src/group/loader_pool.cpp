@@ -0,0 +1,71 @@
+#include "kcache/loader_pool.h"
+
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace kcache {
+
+LoaderPool::LoaderPool(int threads, int max_pending) : max_pending_(max_pending > 0 ? max_pending : 0) {
+    if (threads <= 0) {
+        threads = 1;
+    }
+    workers_.reserve(threads);
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+LoaderPool::~LoaderPool() {
+    {
+        std::lock_guard lock{mtx_};
+        is_stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+bool LoaderPool::Submit(Task task) {
+    {
+        std::lock_guard lock{mtx_};
+        if (is_stop_ || (max_pending_ > 0 && tasks_.size() >= max_pending_)) {
+            return false;
+        }
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+    return true;
+}
+
+auto LoaderPool::Pending() -> size_t {
+    std::lock_guard lock{mtx_};
+    return tasks_.size();
+}
+
+void LoaderPool::WorkerLoop() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock lock{mtx_};
+            cv_.wait(lock, [this] { return is_stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;  // 已停止且没有剩余任务
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        try {
+            task();
+        } catch (const std::exception& e) {
+            spdlog::error("Loader task throws an exception: {}", e.what());
+        } catch (...) {
+            spdlog::error("Loader task throws an unknown exception");
+        }
+    }
+}
+
+}  // namespace kcache
@@ -0,0 +1,182 @@
+#include "kcache/memory_budget.h"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+namespace kcache {
+
+// 每轮的收益与上一轮平滑后的收益各占一半，避免一次突发访问就把容量来回搬动
+constexpr double kGainDecay = 0.5;
+
+MemoryBudget::MemoryBudget(int64_t total_bytes, int64_t step_bytes, std::chrono::milliseconds interval)
+    : total_bytes_(total_bytes), step_bytes_(step_bytes), interval_(interval), free_bytes_(total_bytes) {
+    if (interval_.count() > 0) {
+        rebalancer_ = std::thread{[this] { RebalanceLoop(); }};
+    }
+}
+
+MemoryBudget::~MemoryBudget() {
+    {
+        std::lock_guard lock{mtx_};
+        is_stop_ = true;
+    }
+    cv_.notify_all();
+    if (rebalancer_.joinable()) {
+        rebalancer_.join();
+    }
+    for (auto& member : members_) {
+        member.group->budget_ = nullptr;
+    }
+}
+
+bool MemoryBudget::Attach(KCacheGroup* group, int64_t min_bytes, int64_t max_bytes) {
+    std::lock_guard lock{mtx_};
+    if (min_bytes > free_bytes_ || (max_bytes != 0 && max_bytes < min_bytes)) {
+        return false;
+    }
+    // 同一个缓存组重复加入会被重复计算容量
+    MemoryBudget* expected = nullptr;
+    if (!group->budget_.compare_exchange_strong(expected, this)) {
+        return false;
+    }
+    auto bytes = std::min(std::max(group->MaxBytes(), min_bytes), free_bytes_);
+    if (max_bytes != 0) {
+        bytes = std::min(bytes, max_bytes);
+    }
+    free_bytes_ -= bytes;
+    group->SetMaxBytes(bytes);
+    group->SetGhostBytes(step_bytes_);
+    members_.push_back(Member{group, min_bytes, max_bytes, bytes, group->GhostHits()});
+    spdlog::info("Cache group [{}] joins the memory budget with {} bytes", group->Name(), bytes);
+    return true;
+}
+
+void MemoryBudget::Detach(KCacheGroup* group) {
+    std::lock_guard lock{mtx_};
+    auto* member = Find(group);
+    if (!member) {
+        return;
+    }
+    Sync(member);
+    free_bytes_ += member->bytes;
+    group->SetGhostBytes(0);
+    group->budget_ = nullptr;
+    members_.erase(members_.begin() + (member - members_.data()));
+}
+
+auto MemoryBudget::Resize(KCacheGroup* group, int64_t bytes) -> std::optional<int64_t> {
+    std::lock_guard lock{mtx_};
+    auto* member = Find(group);
+    if (!member) {
+        return std::nullopt;
+    }
+    Sync(member);
+    if (bytes < member->min_bytes || bytes - member->bytes > Room(*member) ||
+        bytes - member->bytes > free_bytes_) {
+        return std::nullopt;
+    }
+    free_bytes_ -= bytes - member->bytes;
+    member->bytes = bytes;
+    return group->SetMaxBytes(bytes);
+}
+
+bool MemoryBudget::Rebalance() {
+    std::lock_guard lock{mtx_};
+    for (auto& member : members_) {
+        Sync(&member);
+        auto hits = member.group->GhostHits();
+        member.gain = member.gain * kGainDecay + static_cast<double>(hits - member.last_ghost_hits);
+        member.last_ghost_hits = hits;
+    }
+
+    // 收益最大且还能增加容量的缓存组
+    Member* receiver = nullptr;
+    for (auto& member : members_) {
+        if (member.gain > 0 && Room(member) > 0 && (!receiver || member.gain > receiver->gain)) {
+            receiver = &member;
+        }
+    }
+    if (!receiver) {
+        return false;
+    }
+
+    auto bytes = std::min(step_bytes_, Room(*receiver));
+    if (free_bytes_ > 0) {
+        bytes = std::min(bytes, free_bytes_);
+        free_bytes_ -= bytes;
+    } else {
+        // 收益最小且还能让出容量的缓存组
+        Member* donor = nullptr;
+        for (auto& member : members_) {
+            if (&member != receiver && member.bytes > member.min_bytes && (!donor || member.gain < donor->gain)) {
+                donor = &member;
+            }
+        }
+        if (!donor || donor->gain >= receiver->gain) {
+            return false;
+        }
+        bytes = std::min(bytes, donor->bytes - donor->min_bytes);
+        donor->bytes -= bytes;
+        donor->group->SetMaxBytes(donor->bytes);
+        SPDLOG_DEBUG("Move {} bytes from cache group [{}] to [{}]", bytes, donor->group->Name(),
+                     receiver->group->Name());
+    }
+    receiver->bytes += bytes;
+    receiver->group->SetMaxBytes(receiver->bytes);
+    return true;
+}
+
+auto MemoryBudget::Allocations() -> std::vector<std::pair<std::string, int64_t>> {
+    std::lock_guard lock{mtx_};
+    std::vector<std::pair<std::string, int64_t>> allocations;
+    allocations.reserve(members_.size());
+    for (auto& member : members_) {
+        Sync(&member);
+        allocations.emplace_back(member.group->Name(), member.bytes);
+    }
+    return allocations;
+}
+
+auto MemoryBudget::Unallocated() -> int64_t {
+    std::lock_guard lock{mtx_};
+    return free_bytes_;
+}
+
+void MemoryBudget::RebalanceLoop() {
+    std::unique_lock lock{mtx_};
+    while (!cv_.wait_for(lock, interval_, [this] { return is_stop_; })) {
+        lock.unlock();
+        Rebalance();
+        lock.lock();
+    }
+}
+
+auto MemoryBudget::Room(const Member& member) const -> int64_t {
+    auto limit = member.max_bytes != 0 ? member.max_bytes : total_bytes_;
+    return std::max<int64_t>(limit - member.bytes, 0);
+}
+
+void MemoryBudget::Sync(Member* member) {
+    auto actual = member->group->MaxBytes();
+    if (actual == member->bytes) {
+        return;
+    }
+    // 实际容量为 0 表示不限，同样按超出处理
+    auto upper = member->bytes + std::min(free_bytes_, Room(*member));
+    auto bytes = actual > 0 ? std::clamp(actual, member->min_bytes, upper) : upper;
+    free_bytes_ -= bytes - member->bytes;
+    member->bytes = bytes;
+    if (bytes != actual) {
+        spdlog::warn("Cache group [{}] is resized to {} bytes outside the memory budget, reset to {} bytes",
+                     member->group->Name(), actual, bytes);
+        member->group->SetMaxBytes(bytes);
+    }
+}
+
+auto MemoryBudget::Find(KCacheGroup* group) -> Member* {
+    auto it = std::find_if(members_.begin(), members_.end(), [group](const Member& m) { return m.group == group; });
+    return it == members_.end() ? nullptr : &*it;
+}
+
+}  // namespace kcache
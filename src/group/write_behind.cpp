@@ -0,0 +1,154 @@
+#include "kcache/write_behind.h"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+#include <spdlog/spdlog.h>
+
+namespace kcache {
+
+WriteBehindQueue::WriteBehindQueue(BatchDataSetter setter, std::chrono::milliseconds interval, size_t max_batch_size,
+                                   size_t max_pending)
+    : setter_(std::move(setter)),
+      interval_(interval),
+      max_batch_size_(std::max<size_t>(max_batch_size, 1)),
+      max_pending_(std::max<size_t>(max_pending, 1)) {
+    flusher_ = std::thread{[this] { FlushLoop(); }};
+}
+
+WriteBehindQueue::~WriteBehindQueue() {
+    {
+        std::lock_guard lock{mtx_};
+        is_stop_ = true;
+    }
+    cv_.notify_all();
+    if (flusher_.joinable()) {
+        flusher_.join();
+    }
+}
+
+void WriteBehindQueue::Put(const std::string& key, ByteView value) {
+    bool notify = false;
+    {
+        std::unique_lock lock{mtx_};
+        auto it = pending_.find(key);
+        if (it != pending_.end()) {
+            // 合并同一个 key 的写入
+            it->second = std::move(value);
+            return;
+        }
+        space_cv_.wait(lock, [this] { return is_stop_ || order_.size() < max_pending_; });
+        pending_.emplace(key, std::move(value));
+        order_.push_back(key);
+        notify = order_.size() >= max_batch_size_;
+    }
+    if (notify) {
+        cv_.notify_one();
+    }
+}
+
+void WriteBehindQueue::Flush() {
+    std::unique_lock lock{mtx_};
+    if (is_stop_ || (order_.empty() && flushing_.empty())) {
+        return;
+    }
+    flush_requested_ = true;
+    cv_.notify_one();
+    flush_cv_.wait(lock, [this] { return is_stop_ || !flush_requested_; });
+}
+
+auto WriteBehindQueue::Pending(const std::string& key) -> ByteViewOptional {
+    std::lock_guard lock{mtx_};
+    auto it = pending_.find(key);
+    if (it != pending_.end()) {
+        return it->second;
+    }
+    auto fit = flushing_.find(key);
+    if (fit != flushing_.end()) {
+        return fit->second;
+    }
+    return std::nullopt;
+}
+
+auto WriteBehindQueue::Size() -> size_t {
+    std::lock_guard lock{mtx_};
+    return order_.size() + flushing_.size();
+}
+
+void WriteBehindQueue::FlushLoop() {
+    std::unique_lock lock{mtx_};
+    while (true) {
+        // 写回失败后积压的数据仍然攒够一批，不等到 retry_after_ 就会立即重试，对不可用的数据源空转
+        auto ready = [this] {
+            return is_stop_ || flush_requested_ ||
+                   (order_.size() >= max_batch_size_ && std::chrono::steady_clock::now() >= retry_after_);
+        };
+        cv_.wait_for(lock, interval_, ready);
+        if (is_stop_) {
+            break;
+        }
+        // 写回失败时等到下一个间隔再重试
+        while (!order_.empty() && FlushBatch(lock)) {
+        }
+        if (!order_.empty()) {
+            retry_after_ = std::chrono::steady_clock::now() + interval_;
+        }
+        flush_requested_ = false;
+        flush_cv_.notify_all();
+    }
+
+    // 退出前尽量写回剩余数据，仍然失败的只能丢弃
+    while (!order_.empty()) {
+        if (!FlushBatch(lock)) {
+            spdlog::error("Drop {} pending writes since backing store is unavailable", order_.size());
+            order_.clear();
+            pending_.clear();
+        }
+    }
+    flush_cv_.notify_all();
+}
+
+bool WriteBehindQueue::FlushBatch(std::unique_lock<std::mutex>& lock) {
+    std::vector<std::pair<std::string, ByteView>> batch;
+    size_t n = std::min(order_.size(), max_batch_size_);
+    batch.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto key = std::move(order_.front());
+        order_.pop_front();
+        auto it = pending_.find(key);
+        flushing_.emplace(key, it->second);
+        batch.emplace_back(std::move(key), std::move(it->second));
+        pending_.erase(it);
+    }
+    space_cv_.notify_all();
+
+    lock.unlock();
+    bool ok = false;
+    try {
+        ok = setter_(batch);
+    } catch (const std::exception& e) {
+        spdlog::error("Batch setter throws for {} keys: {}", batch.size(), e.what());
+    }
+    lock.lock();
+
+    // 逆序放回队首，保持原来的写入顺序
+    for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+        auto& [key, value] = *it;
+        flushing_.erase(key);
+        // 写回期间又有新的写入时以新值为准
+        if (!ok && pending_.find(key) == pending_.end()) {
+            pending_.emplace(key, std::move(value));
+            order_.push_front(key);
+        }
+    }
+    if (ok) {
+        written_ += static_cast<int64_t>(batch.size());
+    } else {
+        failed_ += static_cast<int64_t>(batch.size());
+        spdlog::warn("Failed to write back {} keys, retry later", batch.size());
+    }
+    return ok;
+}
+
+}  // namespace kcache
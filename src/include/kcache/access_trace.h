@@ -0,0 +1,101 @@
+#ifndef ACCESS_TRACE_H_
+#define ACCESS_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+namespace kcache {
+
+enum class AccessOp : uint8_t {
+    kGet = 0,
+    kSet = 1,
+    kDelete = 2,
+    kGetMiss = 3,  // 没有拿到数据的读取（数据不存在或回源失败），版本 3 起
+};
+
+// 访问轨迹中的一条记录
+struct AccessRecord {
+    int64_t timestamp_us;  // 距轨迹开始的时间（微秒）
+    AccessOp op;
+    int64_t bytes;         // 缓存项的大小（key 加 value），删除和没有拿到数据时为 0
+    int64_t cost_us;       // 这次读取的回源耗时（微秒），命中和写入时为 0
+    std::string key;
+};
+
+// 访问轨迹的文件格式：4 字节魔数 "KCAT"、1 字节版本号、varint 编码的采样阈值，之后是连续的记录；
+// 每条记录为 1 字节操作、varint 编码的与上一条记录的时间差（微秒）、大小、回源耗时（微秒，版本 2 起）、
+// key 长度，最后是 key 本身，一条小 key 的记录通常只有十几个字节
+constexpr char kAccessTraceMagic[4] = {'K', 'C', 'A', 'T'};
+constexpr uint8_t kAccessTraceVersion = 3;
+// 采样阈值的取值范围，采样率 = 阈值 / kAccessTraceModulus
+constexpr uint64_t kAccessTraceModulus = uint64_t{1} << 24;
+
+// 按 key 的哈希做空间采样并写入访问轨迹：被采样的 key 的每一次访问都会记录，重用距离得以保留，
+// 回放时把缓存容量同样乘以采样率就能估计完整访问下的命中率。未被采样的访问只需要计算一次哈希，
+// 被采样的记录先写入内存缓冲，攒满后才写文件
+class AccessTraceWriter {
+public:
+    AccessTraceWriter(const std::string& path, double sample_rate, size_t buffer_bytes = 64 << 10);
+
+    ~AccessTraceWriter();
+
+    AccessTraceWriter(const AccessTraceWriter&) = delete;
+    auto operator=(const AccessTraceWriter&) -> AccessTraceWriter& = delete;
+
+    // 文件是否成功打开
+    auto IsOpen() const -> bool { return is_open_; }
+
+    // cost_ns 为这次访问的回源耗时，没有回源时为 0
+    void Record(AccessOp op, const std::string& key, int64_t bytes, int64_t cost_ns = 0);
+
+    // 把缓冲中的记录写入文件
+    void Flush();
+
+    auto SampleRate() const -> double { return static_cast<double>(threshold_) / kAccessTraceModulus; }
+    // 已写入的记录数
+    auto Records() const -> int64_t { return records_.load(std::memory_order_relaxed); }
+
+private:
+    // 写出缓冲，调用时持有锁
+    void FlushLocked();
+
+    uint64_t threshold_;
+    size_t buffer_bytes_;
+    bool is_open_;
+    int64_t start_ns_;
+    int64_t last_us_{0};
+    std::string buffer_;
+    std::ofstream out_;
+    std::atomic<int64_t> records_{0};
+    std::mutex mtx_;
+};
+
+// 顺序读取访问轨迹
+class AccessTraceReader {
+public:
+    explicit AccessTraceReader(const std::string& path);
+
+    // 文件存在且文件头合法，兼容不带回源耗时的版本 1 和没有未命中记录的版本 2
+    auto IsValid() const -> bool { return is_valid_; }
+
+    // 读取下一条记录，文件结束或记录不完整时返回 false
+    bool Next(AccessRecord* record);
+
+    auto SampleRate() const -> double { return static_cast<double>(threshold_) / kAccessTraceModulus; }
+
+private:
+    auto ReadVarint(uint64_t* value) -> bool;
+
+    std::ifstream in_;
+    bool is_valid_{false};
+    uint8_t version_{0};
+    uint64_t threshold_{0};
+    int64_t timestamp_us_{0};
+};
+
+}  // namespace kcache
+
+#endif /* ACCESS_TRACE_H_ */
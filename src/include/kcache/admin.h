@@ -0,0 +1,62 @@
+#ifndef ADMIN_H_
+#define ADMIN_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <grpcpp/grpcpp.h>
+
+#include "kcache.grpc.pb.h"
+#include "kcache.pb.h"
+#include "kcache/registry.h"
+
+namespace kcache {
+
+// 管理服务：查看缓存组的统计、各层缓存占用、热点 key、哈希环和配置，运行时调整容量和淘汰策略
+class KCacheAdmin final : public pb::KCacheAdmin::Service {
+public:
+    // registry 用于查询哈希环成员，需要比本服务活得更久
+    KCacheAdmin(EtcdRegistry* registry, std::string svc_name) : registry_(registry), svc_name_(std::move(svc_name)) {}
+
+    auto Describe(grpc::ServerContext* context, const pb::AdminGroupRequest* request, pb::DescribeResponse* response)
+        -> grpc::Status override;
+
+    auto TopKeys(grpc::ServerContext* context, const pb::TopKeysRequest* request, pb::TopKeysResponse* response)
+        -> grpc::Status override;
+
+    auto Ring(grpc::ServerContext* context, const pb::RingRequest* request, pb::RingResponse* response)
+        -> grpc::Status override;
+
+    auto SetMaxBytes(grpc::ServerContext* context, const pb::SetMaxBytesRequest* request,
+                     pb::SetMaxBytesResponse* response) -> grpc::Status override;
+
+    auto SetPolicy(grpc::ServerContext* context, const pb::SetPolicyRequest* request, pb::SetPolicyResponse* response)
+        -> grpc::Status override;
+
+    auto SetTracing(grpc::ServerContext* context, const pb::SetTracingRequest* request,
+                    pb::SetTracingResponse* response) -> grpc::Status override;
+
+    auto DumpTraces(grpc::ServerContext* context, const pb::DumpTracesRequest* request,
+                    pb::DumpTracesResponse* response) -> grpc::Status override;
+
+private:
+    // 根据上一次查询时的淘汰数计算淘汰速率
+    auto EvictionRate(const std::string& group, int64_t evictions) -> double;
+
+    struct EvictionSample {
+        int64_t evictions;
+        std::chrono::steady_clock::time_point at;
+    };
+
+    EtcdRegistry* registry_;
+    std::string svc_name_;
+    std::unordered_map<std::string, EvictionSample> eviction_samples_;
+    std::mutex mtx_;
+};
+
+}  // namespace kcache
+
+#endif /* ADMIN_H_ */
@@ -0,0 +1,84 @@
+#ifndef BATCH_LOADER_H_
+#define BATCH_LOADER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "kcache/cache.h"
+#include "kcache/loader_pool.h"
+
+namespace kcache {
+
+// 一次加载的结果：kAbsent 表示数据源确认 key 不存在，可以写入负缓存；kError 表示加载失败（getter 抛出异常、
+// 被拒绝等），不能当作不存在
+enum class LoadStatus : uint8_t {
+    kOk,
+    kAbsent,
+    kError,
+};
+
+// 批量 getter：一次加载多个 key，适合 `WHERE id IN (...)` 一类的查询。返回每个 key 的结果，值为空表示数据源中
+// 不存在；结果中缺少的 key 和 getter 抛出异常时整批都视为加载失败
+using BatchDataGetter =
+    std::function<std::unordered_map<std::string, ByteViewOptional>(const std::vector<std::string>& keys)>;
+
+// 将不同 key 的并发未命中在一个很短的窗口内攒成一批，只调用一次批量 getter，
+// 再把结果分发给各个 key 的等待者
+class BatchLoader {
+    // cost 为这个 key 分摊到的批量 getter 耗时（纳秒），不包括攒批等待的时间
+    using Callback = std::function<void(ByteViewOptional, LoadStatus, int64_t cost)>;
+    // 发起批量加载前调用，返回 true 表示放弃这个 key（如等待者都已离开），之后不会再调用 callback
+    using Abandon = std::function<bool()>;
+
+public:
+    // window：第一个 key 到达后最多等待多久；max_batch_size：攒够多少个 key 立即发起加载；
+    // concurrency：同时进行的批量加载数
+    BatchLoader(BatchDataGetter getter, std::chrono::microseconds window, size_t max_batch_size, int concurrency);
+
+    // 加载完已提交的 key 后退出
+    ~BatchLoader();
+
+    BatchLoader(const BatchLoader&) = delete;
+    auto operator=(const BatchLoader&) -> BatchLoader& = delete;
+
+    // 提交一个 key，加载完成后调用 callback；abandon 可选
+    void Submit(const std::string& key, Callback callback, Abandon abandon = nullptr);
+
+private:
+    struct Pending {
+        std::string key;
+        Callback callback;
+        Abandon abandon;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    void CollectLoop();
+    void Flush(const std::vector<Pending>& pendings);
+
+private:
+    BatchDataGetter getter_;
+    std::chrono::microseconds window_;
+    size_t max_batch_size_;
+
+    bool is_stop_{false};
+    std::deque<Pending> queue_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+
+    std::unique_ptr<LoaderPool> pool_;  // 执行批量加载
+    std::thread collector_;             // 攒批线程
+};
+
+}  // namespace kcache
+
+#endif /* BATCH_LOADER_H_ */
@@ -1,13 +1,18 @@
 #ifndef LRU_H_
 #define LRU_H_
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <list>
 #include <mutex>
 #include <optional>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace kcache {
 
@@ -26,37 +31,137 @@ struct ByteView {
 
 using ByteViewOptional = std::optional<ByteView>;
 
+// 单调时钟的当前时间（纳秒），用于缓存过期判断
+inline auto NowNs() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 struct Entry {
     std::string key_;
     ByteView value_;
+    int64_t expire_at_;     // 过期时间点（NowNs），0 表示永不过期
+    uint64_t generation_;   // 写入时缓存的代数，小于当前代数的缓存项已被 Flush 清空
+    uint64_t version_;      // 每次写入递增的版本号，用于条件写入
+    int64_t cost_{0};       // 重新加载的代价（纳秒），0 表示未知
+    int64_t frequency_{1};  // 写入以来的访问次数
+    double priority_{0};    // GDSF 策略下的优先级，越小越先淘汰
+
+    Entry(std::string k, const ByteView& v, int64_t expire_at = 0, uint64_t generation = 0, uint64_t version = 0)
+        : key_(std::move(k)), value_(v), expire_at_(expire_at), generation_(generation), version_(version) {}
 
-    Entry(std::string k, const ByteView& v) : key_(std::move(k)), value_(v) {}
+    auto IsExpired(int64_t now) const -> bool { return expire_at_ != 0 && now >= expire_at_; }
 
     auto operator==(const Entry& entry) const -> bool {
         return key_ == entry.key_ && value_.ToString() == entry.value_.ToString();
     }
 };
 
+enum class CachePolicy : uint8_t {
+    kLru,   // 淘汰最久未使用的缓存项
+    kGdsf,  // GreedyDual-Size-Frequency：淘汰 访问次数 × 加载代价 / 大小 最小的缓存项
+};
+
+auto CachePolicyName(CachePolicy policy) -> std::string;
+// 按名称（"lru"、"gdsf"）解析淘汰策略，未知名称返回 false
+bool ParseCachePolicy(const std::string& name, CachePolicy* policy);
+
+// 默认按 LRU 淘汰，也可以切换为 GDSF：重新加载越慢、访问越多、占用越小的缓存项越晚被淘汰，
+// 每淘汰一项就把基准优先级抬高到它的优先级，长期不被访问的缓存项会被新写入的缓存项超过，不会一直占着容量。
+// GDSF 下每次命中都要在缓存锁内对优先级集合重新排序（O(log n)），而 LRU 只是 O(1) 的链表移动，
+// 锁竞争激烈、各个 key 回源代价相近时应使用 LRU
 class LRUCache {
     using EvictedFunc = std::function<void(std::string, ByteView)>;
     using ListElementIter = std::list<Entry>::iterator;
 
 public:
-    LRUCache(int max_bytes, const EvictedFunc& evicted_func = nullptr)
-        : max_bytes_(max_bytes), evicted_func_(evicted_func) {}
+    // 根据当前值（不存在或已过期时为 nullptr）计算新值，返回空表示放弃写入
+    using UpdateFunc = std::function<ByteViewOptional(const Entry* current)>;
 
+    // evicted_func 在每个缓存项被移除时调用；overflow_func 只在因容量不足淘汰时、移除之前调用
+    LRUCache(int max_bytes, const EvictedFunc& evicted_func = nullptr, const EvictedFunc& overflow_func = nullptr);
+
+    // 获取未过期的值
     auto Get(const std::string& key) -> ByteViewOptional;
-    void Set(const std::string& key, const ByteView&);
+    // 获取完整的缓存项（包括已过期但尚未淘汰的），由调用方决定如何处理过期数据
+    auto Lookup(const std::string& key) -> std::optional<Entry>;
+    // 写入并返回新的版本号，cost 为重新加载的代价（纳秒），0 表示沿用已有缓存项的代价，新缓存项按平均代价估计
+    auto Set(const std::string& key, const ByteView&, int64_t expire_at = 0, int64_t cost = 0) -> uint64_t;
     void Delete(const std::string& key);
     void RemoveOldest();
 
+    // 仅当 key 不存在时写入，返回是否写入成功
+    bool SetIfAbsent(const std::string& key, const ByteView& value, int64_t expire_at = 0, int64_t cost = 0);
+    // 查询但不调整淘汰顺序，用于数据迁移、统计等非业务访问
+    auto Peek(const std::string& key) -> ByteViewOptional;
+    // 同 Peek，返回包含版本号的完整缓存项
+    auto PeekEntry(const std::string& key) -> std::optional<Entry>;
+    // 缓存中 key 的有效值与 value 相同时返回它的版本号，否则返回 0；不复制值，也不影响淘汰顺序
+    auto PeekVersion(const std::string& key, const ByteView& value) -> uint64_t;
+
+    // 在锁内原子地读-改-写，返回写入后的缓存项，fn 放弃写入时返回空
+    auto Update(const std::string& key, const UpdateFunc& fn, int64_t expire_at = 0) -> std::optional<Entry>;
+    // 把缓存之外的命中（如线程本地 L0 缓存的命中）计入访问次数，不调整 LRU 顺序
+    void AddFrequency(const std::string& key, int64_t hits);
+    // 按最近使用顺序返回最多 limit 个未过期的 key（limit 为 0 表示全部），include_expired 为 true 时也包括已过期的 key
+    auto Keys(size_t limit = 0, bool include_expired = false) -> std::vector<std::string>;
+
+    // O(1) 清空：代数加一后旧代数的缓存项立即不可见，内存在访问和淘汰时逐步回收，不会长时间持有锁
+    void Flush() { generation_.fetch_add(1, std::memory_order_acq_rel); }
+    auto Generation() const -> uint64_t { return generation_.load(std::memory_order_acquire); }
+
+    // 以下统计不加锁读取，供监控使用，可能略微滞后
+    auto Bytes() const -> int64_t { return used_bytes_.load(std::memory_order_relaxed); }
+    auto Len() const -> int64_t { return entries_.load(std::memory_order_relaxed); }
+    // 因容量不足被淘汰的缓存项数
+    auto Evictions() const -> int64_t { return evictions_.load(std::memory_order_relaxed); }
+    auto MaxBytes() const -> int64_t { return max_bytes_.load(std::memory_order_relaxed); }
+
+    // 运行时调整容量，缩小时立即淘汰超出的部分，返回淘汰的缓存项数
+    auto SetMaxBytes(int64_t max_bytes) -> int64_t;
+
+    // 运行时切换淘汰策略，切换到 GDSF 时按已记录的访问次数和代价重新计算所有缓存项的优先级
+    void SetPolicy(CachePolicy policy);
+    auto Policy() const -> CachePolicy { return policy_.load(std::memory_order_relaxed); }
+
 private:
+    // 移除缓存项并调用淘汰回调，调用时持有锁
+    void Remove(ListElementIter it);
+    // 因容量不足按淘汰策略淘汰一个缓存项，调用时持有锁
+    void Evict();
+    // GDSF 优先级：基准优先级 + 访问次数 × 代价 / 大小
+    auto Priority(const Entry& entry) const -> double;
+    // 访问次数或代价变化后重新计算优先级，调用时持有锁
+    void Reprioritize(Entry& entry);
+    // 从链表尾部回收至多 n 个旧代数的缓存项，调用时持有锁
+    void ReclaimStale(int n);
+    // 写入并按容量淘汰，返回新的版本号，调用时持有锁
+    auto Insert(const std::string& key, const ByteView& value, int64_t expire_at, int64_t cost) -> uint64_t;
+    // 缓存项存在、未过期且未被 Flush 时返回它，调用时持有锁
+    auto FindLive(const std::string& key) -> ListElementIter;
+    // 更新不加锁读取的统计，调用时持有锁
+    void Publish() {
+        used_bytes_.store(bytes_, std::memory_order_relaxed);
+        entries_.store(static_cast<int64_t>(cache_.size()), std::memory_order_relaxed);
+    }
+
     int64_t bytes_ = 0;
-    int64_t max_bytes_;
+    std::atomic<int64_t> max_bytes_;
+    std::atomic<uint64_t> generation_{0};
+    uint64_t next_version_;  // 以创建时的时间为起点，节点重启后版本号也不会回退
     EvictedFunc evicted_func_;
+    EvictedFunc overflow_func_;
+    std::atomic<int64_t> used_bytes_{0};
+    std::atomic<int64_t> entries_{0};
+    std::atomic<int64_t> evictions_{0};
+    std::atomic<CachePolicy> policy_{CachePolicy::kLru};
+    double inflation_{0};      // GDSF 的基准优先级，即最近一次淘汰的缓存项的优先级
+    int64_t cost_total_{0};    // 写入时给出的代价之和，用于估计没有代价的新缓存项
+    int64_t cost_samples_{0};
 
     std::unordered_map<std::string, ListElementIter> cache_;
     std::list<Entry> list_;
+    std::set<std::pair<double, const Entry*>> priorities_;  // 只在 GDSF 策略下维护
     std::mutex mtx_;
 };
 
@@ -29,6 +29,10 @@ struct HashConfig {
     std::function<uint32_t(const std::string&)> hash_func;
     // 负载均衡阈值，超过此值触发虚拟节点调整
     double load_balance_threshold;
+    // 每轮调整最多变动的虚拟节点占哈希环的比例，限制一次再平衡迁移的 key 数量
+    double max_move_ratio = 0.1;
+    // 是否启动后台负载均衡器，仅用于计算归属的临时哈希环可以关闭
+    bool auto_rebalance = true;
 };
 
 // DefaultConfig 默认配置
@@ -37,6 +41,9 @@ const HashConfig kDefaultConfig = {
     0.25,  // 25% 的负载不均衡度触发调整
 };
 
+// 没有完整的上报负载时，本实例路由的请求数达到该值才按请求数再平衡
+constexpr long long kMinRebalanceSamples = 1000;
+
 // Map 一致性哈希实现
 class ConsistentHashMap {
 public:
@@ -60,6 +67,13 @@ public:
     // GetStats 获取负载统计信息
     auto GetStats() -> std::unordered_map<std::string, double>;
 
+    // GetReplicas 获取各节点当前的虚拟节点数量
+    auto GetReplicas() -> std::unordered_map<std::string, int>;
+
+    // UpdateLoads 更新由各节点上报的集群负载（如 CPU 占用），
+    // 所有节点都有上报时，再平衡以上报负载为准，而不是本实例路由的请求数
+    void UpdateLoads(const std::unordered_map<std::string, double>& loads);
+
 private:
     // addNode 添加节点的虚拟节点
     void AddNode(const std::string& node, int replicas);
@@ -67,9 +81,16 @@ private:
     // checkAndRebalance 检查并重新平衡虚拟节点
     void CheckAndRebalance();
 
+    // collectLoads 收集各节点负载，优先使用上报负载，调用方需持有锁；
+    // enough 返回样本是否足以做再平衡：使用上报负载，或本实例路由的请求数不少于 kMinRebalanceSamples
+    auto CollectLoads(bool* enough) -> std::unordered_map<std::string, double>;
+
     // rebalanceNodes 重新平衡节点
     void RebalanceNodes();
 
+    // removeNode 移除节点的虚拟节点，调用方需持有写锁
+    void RemoveNode(const std::string& node);
+
     // startBalancer 启动负载均衡器线程
     void StartBalancer();
 
@@ -89,6 +110,8 @@ private:
     std::unordered_map<std::string, std::atomic<long long>> node_counts_;
     // 总请求数
     std::atomic<long long> total_requests_;
+    // 节点上报的负载
+    std::unordered_map<std::string, double> reported_loads_;
 
     std::thread balancer_thread_;         // 负载均衡器线程
     std::atomic<bool> is_balancer_stop_;  // 控制负载均衡器线程停止的标志
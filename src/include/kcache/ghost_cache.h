@@ -0,0 +1,46 @@
+#ifndef GHOST_CACHE_H_
+#define GHOST_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace kcache {
+
+// 幽灵缓存：按 LRU 顺序只记录最近因容量不足被淘汰的 key 的哈希和大小，不保存数据。
+// 未命中的 key 还在幽灵缓存中，说明缓存再大 MaxBytes 就能命中，用来估计增加容量的边际收益
+class GhostCache {
+public:
+    explicit GhostCache(int64_t max_bytes = 0) : max_bytes_(max_bytes) {}
+
+    // 记录一个被淘汰的 key，容量为 0 时什么也不做
+    void Add(const std::string& key, int64_t bytes);
+
+    // 未命中时调用：key 在幽灵缓存中时移除它并计一次命中
+    bool Hit(const std::string& key);
+
+    // 调整容量，0 表示关闭并清空
+    void SetMaxBytes(int64_t max_bytes);
+
+    auto MaxBytes() const -> int64_t { return max_bytes_.load(std::memory_order_relaxed); }
+    auto Hits() const -> int64_t { return hits_.load(std::memory_order_relaxed); }
+
+private:
+    // 超出容量时从尾部移除，调用时持有锁
+    void Trim(int64_t max_bytes);
+
+    std::atomic<int64_t> max_bytes_;
+    std::atomic<int64_t> hits_{0};
+    int64_t bytes_{0};
+    std::list<std::pair<uint64_t, int64_t>> list_;  // (key 的哈希, 大小)，最近淘汰的在前
+    std::unordered_map<uint64_t, std::list<std::pair<uint64_t, int64_t>>::iterator> index_;
+    std::mutex mtx_;
+};
+
+}  // namespace kcache
+
+#endif /* GHOST_CACHE_H_ */
@@ -1,29 +1,328 @@
 #ifndef CACHE_H_
 #define CACHE_H_
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
+#include "kcache/access_trace.h"
+#include "kcache/batch_loader.h"
 #include "kcache/cache.h"
+#include "kcache/ghost_cache.h"
+#include "kcache/hot_keys.h"
+#include "kcache/l0_cache.h"
+#include "kcache/loader_pool.h"
+#include "kcache/metrics.h"
+#include "kcache/mrc.h"
 #include "kcache/singleflight.h"
+#include "kcache/tag_index.h"
+#include "kcache/trace.h"
+#include "kcache/write_behind.h"
 
 namespace kcache {
 
+class MemoryBudget;
+
 using DataGetter = std::function<ByteViewOptional(const std::string& key)>;
 
+// 加载完成回调，可以在任意线程调用：传入值表示加载成功，传入空值表示数据源中确实不存在（会写入负缓存）；
+// 加载失败时调用 Fail，等待者返回失败，但 key 不会被当作不存在
+class LoadCallback {
+public:
+    using Complete = std::function<void(ByteViewOptional, LoadStatus)>;
+
+    LoadCallback() = default;
+    explicit LoadCallback(Complete complete) : complete_(std::move(complete)) {}
+
+    void operator()(ByteViewOptional value) const {
+        auto status = value ? LoadStatus::kOk : LoadStatus::kAbsent;
+        complete_(std::move(value), status);
+    }
+
+    void Fail() const { complete_(std::nullopt, LoadStatus::kError); }
+
+private:
+    Complete complete_;
+};
+
+// 异步 getter：发起加载后立即返回，加载完成时调用 callback，适配异步数据库客户端
+using AsyncDataGetter = std::function<void(const std::string& key, LoadCallback callback)>;
+// 写回数据源，返回 false 表示写入失败
+using DataSetter = std::function<bool(const std::string& key, const ByteView& value)>;
+// 根据 key 生成标签（如从 "user:42:profile" 中取出 "user:42"），从任何途径写入缓存的数据都会打上标签
+using KeyTagger = std::function<std::vector<std::string>(const std::string& key)>;
+// 已知 key 的过滤器（如应用提供的布隆过滤器），返回 false 表示 key 一定不存在
+using KeyFilter = std::function<bool(const std::string& key)>;
+
+struct GroupOptions {
+    BatchDataGetter batch_getter;                     // 设置后并发未命中会攒批加载，优先于其他 getter 使用
+    std::chrono::microseconds batch_window;           // 攒批窗口
+    int max_batch_size;                               // 单批最多的 key 数
+    AsyncDataGetter async_getter;                     // 设置后优先于同步 getter 使用
+    int max_concurrent_loads;                         // 最大并发加载数，同步 getter 时即加载线程数，0 表示在请求线程上直接加载
+    int max_pending_loads;                            // 同步 getter 排队等待加载的最大数量，超过后直接失败
+    std::chrono::milliseconds load_timeout;           // 每个等待者的加载超时，0 表示不超时，同步 getter 需配合加载线程池
+    std::chrono::milliseconds ttl;                    // 缓存有效期，0 表示永不过期
+    std::chrono::milliseconds refresh_ahead;          // 距离过期不足该时间时访问会触发后台刷新并继续返回旧值，0 表示关闭
+    std::chrono::milliseconds stale_grace;            // 过期后回源失败时仍可返回旧值的宽限时间，0 表示关闭
+    std::chrono::milliseconds negative_ttl;           // 不存在的 key 的缓存时间，0 表示不缓存
+    int64_t negative_cache_bytes;                     // 负缓存的内存上限
+    KeyFilter key_filter;                             // 可选，回源前先过滤一定不存在的 key
+    std::chrono::milliseconds lease_ttl;              // 租约有效期，持有者在此期间负责回源并填充，0 表示关闭租约
+    std::chrono::milliseconds lease_retry;            // 未拿到租约的请求方建议的重试间隔
+    std::chrono::milliseconds lease_stale_ttl;        // 失效后旧值可以作为过期数据返回的时间
+    int64_t lease_stale_bytes;                        // 失效旧值的内存上限
+    DataSetter setter;                                // 设置后 Set 先同步写回数据源（write-through），成功后才更新缓存
+    BatchDataSetter write_behind_setter;              // 设置后 Set 只更新缓存，由后台合并后批量写回（write-behind）
+    std::chrono::milliseconds write_behind_interval;  // 延迟写回的间隔
+    int write_behind_batch_size;                      // 单批写回的最大 key 数
+    int write_behind_max_pending;                     // 最多积压的待写回 key 数，超过后 Set 阻塞等待写回
+    KeyTagger tagger;                                 // 可选，为写入的数据自动生成标签
+    bool prefix_index;                                // 维护有序 key 索引，按前缀失效时不需要扫描整个缓存
+    int hot_key_capacity;                             // 热点统计跟踪的 key 数，0 表示关闭热点探测
+    int hot_key_sample_rate;                          // 每多少次访问采样一次
+    double hot_key_ratio;                             // 访问占比不低于该值的 key 为热点
+    std::chrono::milliseconds hot_replica_ttl;        // 非 owner 节点上热点副本的有效期
+    std::chrono::milliseconds l0_ttl;                 // 线程本地 L0 缓存中数据的最长有效期，0 表示关闭 L0 缓存
+    int mrc_samples;                                  // 缺失率曲线估计最多跟踪的 key 数，0 表示关闭
+    double mrc_sample_rate;                           // 缺失率曲线估计的初始采样率
+    std::shared_ptr<AccessTraceWriter> access_trace;  // 可选，记录采样的访问轨迹，供离线模拟回放
+    CachePolicy eviction_policy;                      // 主缓存的淘汰策略，可通过管理服务在运行时切换
+
+    GroupOptions()
+        : batch_window(std::chrono::milliseconds(2)),
+          max_batch_size(64),
+          max_concurrent_loads(0),
+          max_pending_loads(1024),
+          load_timeout(0),
+          ttl(0),
+          refresh_ahead(0),
+          stale_grace(0),
+          negative_ttl(0),
+          negative_cache_bytes(64 << 10),
+          lease_ttl(0),
+          lease_retry(std::chrono::milliseconds(20)),
+          lease_stale_ttl(std::chrono::seconds(10)),
+          lease_stale_bytes(1 << 20),
+          write_behind_interval(std::chrono::milliseconds(100)),
+          write_behind_batch_size(128),
+          write_behind_max_pending(10000),
+          prefix_index(false),
+          hot_key_capacity(0),
+          hot_key_sample_rate(16),
+          hot_key_ratio(0.01),
+          hot_replica_ttl(std::chrono::seconds(1)),
+          l0_ttl(0),
+          mrc_samples(0),
+          mrc_sample_rate(0.01),
+          eviction_policy(CachePolicy::kLru) {}
+};
+
+using GroupOption = std::function<void(GroupOptions*)>;
+
+inline auto WithBatchGetter(BatchDataGetter getter, std::chrono::microseconds window, int max_batch_size)
+    -> GroupOption {
+    return [getter, window, max_batch_size](GroupOptions* o) {
+        o->batch_getter = getter;
+        o->batch_window = window;
+        o->max_batch_size = max_batch_size;
+    };
+}
+
+inline auto WithAsyncGetter(AsyncDataGetter getter) -> GroupOption {
+    return [getter](GroupOptions* o) { o->async_getter = getter; };
+}
+
+inline auto WithLoaderPool(int max_concurrent_loads, int max_pending_loads) -> GroupOption {
+    return [max_concurrent_loads, max_pending_loads](GroupOptions* o) {
+        o->max_concurrent_loads = max_concurrent_loads;
+        o->max_pending_loads = max_pending_loads;
+    };
+}
+
+inline auto WithLoadTimeout(std::chrono::milliseconds timeout) -> GroupOption {
+    return [timeout](GroupOptions* o) { o->load_timeout = timeout; };
+}
+
+inline auto WithTTL(std::chrono::milliseconds ttl) -> GroupOption {
+    return [ttl](GroupOptions* o) { o->ttl = ttl; };
+}
+
+inline auto WithRefreshAhead(std::chrono::milliseconds window) -> GroupOption {
+    return [window](GroupOptions* o) { o->refresh_ahead = window; };
+}
+
+inline auto WithNegativeCache(std::chrono::milliseconds ttl, int64_t max_bytes) -> GroupOption {
+    return [ttl, max_bytes](GroupOptions* o) {
+        o->negative_ttl = ttl;
+        o->negative_cache_bytes = max_bytes;
+    };
+}
+
+inline auto WithKeyFilter(KeyFilter filter) -> GroupOption {
+    return [filter](GroupOptions* o) { o->key_filter = filter; };
+}
+
+inline auto WithStaleGrace(std::chrono::milliseconds grace) -> GroupOption {
+    return [grace](GroupOptions* o) { o->stale_grace = grace; };
+}
+
+inline auto WithLease(std::chrono::milliseconds ttl, std::chrono::milliseconds retry,
+                      std::chrono::milliseconds stale_ttl) -> GroupOption {
+    return [ttl, retry, stale_ttl](GroupOptions* o) {
+        o->lease_ttl = ttl;
+        o->lease_retry = retry;
+        o->lease_stale_ttl = stale_ttl;
+    };
+}
+
+inline auto WithWriteThrough(DataSetter setter) -> GroupOption {
+    return [setter](GroupOptions* o) { o->setter = setter; };
+}
+
+inline auto WithWriteBehind(BatchDataSetter setter, std::chrono::milliseconds interval, int batch_size,
+                            int max_pending) -> GroupOption {
+    return [setter, interval, batch_size, max_pending](GroupOptions* o) {
+        o->write_behind_setter = setter;
+        o->write_behind_interval = interval;
+        o->write_behind_batch_size = batch_size;
+        o->write_behind_max_pending = max_pending;
+    };
+}
+
+inline auto WithTagger(KeyTagger tagger) -> GroupOption {
+    return [tagger](GroupOptions* o) { o->tagger = tagger; };
+}
+
+inline auto WithPrefixIndex(bool enable) -> GroupOption {
+    return [enable](GroupOptions* o) { o->prefix_index = enable; };
+}
+
+inline auto WithHotKeyDetection(int capacity, double ratio, std::chrono::milliseconds replica_ttl) -> GroupOption {
+    return [capacity, ratio, replica_ttl](GroupOptions* o) {
+        o->hot_key_capacity = capacity;
+        o->hot_key_ratio = ratio;
+        o->hot_replica_ttl = replica_ttl;
+    };
+}
+
+inline auto WithL0Cache(std::chrono::milliseconds ttl) -> GroupOption {
+    return [ttl](GroupOptions* o) { o->l0_ttl = ttl; };
+}
+
+// 在线估计不同容量下的命中率，samples 越大估计越准，每个跟踪的 key 约占几十字节
+inline auto WithMissRatioCurve(int samples, double sample_rate = 0.01) -> GroupOption {
+    return [samples, sample_rate](GroupOptions* o) {
+        o->mrc_samples = samples;
+        o->mrc_sample_rate = sample_rate;
+    };
+}
+
+// GDSF 策略按每个缓存项实测的加载耗时淘汰，适合不同 key 回源代价差别很大的场景
+inline auto WithEvictionPolicy(CachePolicy policy) -> GroupOption {
+    return [policy](GroupOptions* o) { o->eviction_policy = policy; };
+}
+
+// 多个缓存组可以共享同一个 writer
+inline auto WithAccessTrace(std::shared_ptr<AccessTraceWriter> writer) -> GroupOption {
+    return [writer](GroupOptions* o) { o->access_trace = writer; };
+}
+
+// 请求线程频繁更新的统计，按线程分片，避免多核之间争抢缓存行
 struct GroupStatus {
-    std::atomic_int64_t loads;          // 加载次数
-    std::atomic_int64_t local_hits;     // 本地缓存命中次数
-    std::atomic_int64_t local_misses;   // 本地缓存未命中次数
-    std::atomic_int64_t peer_hits;      // 从对等节点获取成功次数
-    std::atomic_int64_t peer_misses;    // 从对等节点获取失败次数
-    std::atomic_int64_t loader_hits;    // 从加载器获取成功次数
-    std::atomic_int64_t loader_errors;  // 从加载器获取失败次数
-    std::atomic_int64_t load_duration;  // 加载总耗时（纳秒）};
+    ShardedCounter loads;           // 加载次数
+    ShardedCounter local_hits;      // 本地缓存命中次数
+    ShardedCounter local_misses;    // 本地缓存未命中次数
+    ShardedCounter l0_hits;         // 线程本地 L0 缓存命中次数
+    ShardedCounter peer_hits;       // 从对等节点获取成功次数
+    ShardedCounter peer_misses;     // 从对等节点获取失败次数
+    ShardedCounter loader_hits;     // 从加载器获取成功次数
+    ShardedCounter loader_errors;   // 从加载器获取失败次数
+    ShardedCounter load_duration;   // 加载总耗时（纳秒）
+    ShardedCounter refreshes;       // 提前刷新次数
+    ShardedCounter stale_hits;      // 回源失败时返回过期数据的次数
+    ShardedCounter negative_hits;   // 命中负缓存或被过滤器拦截的次数
+    ShardedCounter lease_grants;    // 发放的租约数
+    ShardedCounter lease_waits;     // 未拿到租约、需要等待或使用旧值的次数
+    ShardedCounter write_errors;    // 同步写回数据源失败的次数
+    LatencyHistogram hit_latency;   // 本地缓存命中的延迟
+    LatencyHistogram miss_latency;  // 未命中时包括回源在内的延迟
+    LatencyHistogram load_latency;  // 单次回源的耗时
+    LatencyHistogram peer_latency;  // 热点副本从 owner 拉取的耗时
+};
+
+// GroupStatus 的快照，供统计上报使用
+struct GroupStats {
+    int64_t loads;
+    int64_t local_hits;
+    int64_t local_misses;
+    int64_t peer_hits;
+    int64_t peer_misses;
+    int64_t loader_hits;
+    int64_t loader_errors;
+    int64_t load_duration;
+    int64_t refreshes;
+    int64_t stale_hits;
+    int64_t negative_hits;
+    int64_t lease_grants;
+    int64_t lease_waits;
+    int64_t write_errors;
+    int64_t write_behind_written;  // 延迟写回成功的条目数
+    int64_t write_behind_failed;   // 延迟写回失败（会重试）的条目数
+    int64_t write_behind_pending;  // 尚未写回的 key 数
+    int64_t l0_hits;
+    int64_t cache_bytes;           // 缓存占用的字节数
+    int64_t cache_entries;         // 缓存项数
+    int64_t max_bytes;
+    int64_t evictions;             // 因容量不足淘汰的缓存项数
+    int64_t flights;               // SingleFlight 实际发起的加载数
+    int64_t deduplicated;          // SingleFlight 合并掉的重复加载数
+    int64_t ghost_hits;            // 容量再大一些就能命中的未命中数，见 SetGhostBytes
+    LatencySummary hit_latency;
+    LatencySummary miss_latency;
+    LatencySummary load_latency;
+    LatencySummary peer_latency;
+};
+
+// 一层缓存（主缓存、负缓存、失效旧值）的占用情况
+struct CacheOccupancy {
+    std::string tier;
+    int64_t bytes;
+    int64_t max_bytes;
+    int64_t entries;
+    int64_t evictions;
+};
+
+// 带版本号的值，版本号为 0 表示值没有进入缓存；value 可能与 L0 缓存共享，L0 命中时不需要复制
+struct VersionedValue {
+    std::shared_ptr<const ByteView> value;
+    uint64_t version;
+};
+
+// 条件写入的结果：成功时 version 为新版本号，失败时为当前版本号（不存在时为 0）
+struct CasResult {
+    bool ok;
+    uint64_t version;
+};
+
+// GetOrLease 的结果
+struct LeaseResult {
+    ByteViewOptional value;                    // 最新值，或者失效前的旧值（stale 为 true）
+    bool hit{false};                           // value 为最新值
+    bool stale{false};                         // value 为旧值，可以在填充完成前先使用
+    uint64_t token{0};                         // 非 0 表示拿到了租约，调用方负责回源并通过 Fill 写入
+    std::chrono::milliseconds retry_after{0};  // 没有拿到租约时建议的重试间隔
 };
 
 enum class SyncFlag {
@@ -36,50 +335,263 @@ class KCacheGroup {
 public:
     KCacheGroup() = default;
 
-    KCacheGroup(std::string name, int64_t bytes, DataGetter getter)
-        : cache_(std::make_unique<LRUCache>(bytes)), name_(name), getter_(getter) {}
+    KCacheGroup(std::string name, int64_t bytes, DataGetter getter, GroupOptions opts = GroupOptions{});
+
+    // 等待进行中的加载结束，加载回调中会访问本对象；异步 getter 的回调最多等待 load_timeout（未设置时 10 秒），
+    // 之后到达的回调会被丢弃
+    ~KCacheGroup();
 
     KCacheGroup(const KCacheGroup&) = delete;
 
     auto operator=(const KCacheGroup& other) -> KCacheGroup& = delete;
 
-    KCacheGroup(KCacheGroup&& other) {
-        cache_ = std::move(other.cache_);
-        name_ = std::move(other.name_);
-        getter_ = std::move(other.getter_);
-    }
+    // 加载回调、线程池任务、L0 缓存、内存预算和缓存组注册表都持有本对象的地址，缓存组创建后不能移动，
+    // 需要转移所有权时使用 std::unique_ptr
+    KCacheGroup(KCacheGroup&&) = delete;
 
-    auto operator=(KCacheGroup&& other) -> KCacheGroup& {
-        cache_ = std::move(other.cache_);
-        name_ = std::move(other.name_);
-        getter_ = std::move(other.getter_);
-        return *this;
-    }
+    auto operator=(KCacheGroup&&) -> KCacheGroup& = delete;
+
+    // 停止服务：之后的读写都被拒绝，延迟写回队列中积压的数据立即写回；线程池等资源在析构时释放
+    void Close();
 
     auto Get(const std::string& key) -> ByteViewOptional;
 
-    bool Set(const std::string& key, ByteView b);
+    // 同 Get，同时返回版本号，用于之后的条件写入
+    auto GetVersioned(const std::string& key) -> std::optional<VersionedValue>;
+
+    // tags 为空时使用 tagger 生成的标签
+    bool Set(const std::string& key, ByteView b, const std::vector<std::string>& tags = {});
 
     bool Delete(const std::string& key);
 
+    // 作为热点副本读取：客户端把热点 key 的读请求分散到非 owner 节点，未命中时通过 fetch 从 owner 拉取，
+    // 以较短的有效期缓存在本节点，owner 上的失效通知无法送达时也只会在短时间内读到旧值
+    auto GetReplica(const std::string& key, const DataGetter& fetch) -> ByteViewOptional;
+
+    // 条件写入：当前版本号等于 expected_version 时才写入，expected_version 为 0 表示仅在不存在时写入
+    auto CompareAndSet(const std::string& key, ByteView b, uint64_t expected_version) -> CasResult;
+
+    // 把值当作十进制整数原子地加上 delta，缓存和数据源中都不存在时从 0 开始，返回新值和版本号；
+    // 值不是整数、溢出或回源失败时返回空
+    auto Incr(const std::string& key, int64_t delta) -> std::optional<std::pair<int64_t, uint64_t>>;
+
+    // 原子地在值末尾追加数据，缓存和数据源中都不存在时直接写入，返回新的版本号，失败（包括回源失败）时返回 0
+    auto Append(const std::string& key, ByteView suffix) -> uint64_t;
+
     // 处理来自其他节点的失效请求
     bool InvalidateFromPeer(const std::string& key);
 
+    // 失效带有该标签的所有 key，返回失效的 key 数
+    auto InvalidateTag(const std::string& tag) -> int64_t;
+
+    // 失效以 prefix 开头的所有 key，返回失效的 key 数；未开启前缀索引时扫描整个缓存
+    auto InvalidatePrefix(const std::string& prefix) -> int64_t;
+
+    // 带租约的读取：命中时返回最新值；未命中时只有第一个请求方拿到租约去回源，
+    // 其他请求方在租约有效期内拿到旧值或重试间隔，整个集群每次失效只回源一次
+    auto GetOrLease(const std::string& key) -> LeaseResult;
+
+    // 租约持有者回源后写入，value 为空表示数据不存在；租约已被失效或被他人取代时返回 false
+    bool Fill(const std::string& key, ByteViewOptional value, uint64_t token);
+
+    // O(1) 清空缓存组：旧数据立即不可见，内存在后续访问和淘汰时逐步回收，返回新的代数
+    auto Flush() -> uint64_t;
+
+    // 写入从其他节点迁移来的数据，本地已有的 key 不会被覆盖；expire_at 为原缓存项的过期时间点（NowNs），
+    // 0 表示永不过期，迁移不会延长数据的有效期，已过期的数据直接丢弃
+    bool Warm(const std::string& key, ByteView b, int64_t expire_at);
+
+    // 查询本地缓存，不回源也不影响淘汰顺序
+    auto Peek(const std::string& key) -> ByteViewOptional;
+
+    // 同 Peek，返回包含过期时间的完整缓存项，已过期的视为不存在
+    auto PeekEntry(const std::string& key) -> std::optional<Entry>;
+
+    // 按热度（最近使用顺序）返回最多 limit 个未过期的 key，limit 为 0 表示全部
+    auto HotKeys(size_t limit = 0) -> std::vector<std::string>;
+
+    // 是否为访问占比超过阈值的热点 key，未开启热点探测时总是 false
+    auto IsHotKey(const std::string& key) -> bool;
+
+    // 按访问次数返回最多 k 个热点 key
+    auto TopKeys(size_t k) -> std::vector<HotKey>;
+
+    auto Name() const -> const std::string& { return name_; }
+
+    // 在全局注册表中的编号，不同节点上同名缓存组的编号可能不同；未注册时为 0
+    auto Id() const -> uint32_t { return id_; }
+
+    // 获取统计信息快照，只读取原子变量，不会加缓存锁
+    auto Stats() const -> GroupStats;
+
+    // 各条路径的完整延迟分布：hit、miss、load、peer
+    auto Histograms() const -> std::vector<std::pair<std::string, HistogramSnapshot>>;
+
+    // 各层缓存的占用情况
+    auto Occupancy() const -> std::vector<CacheOccupancy>;
+
+    // 当前配置，供管理接口展示
+    auto Config() const -> std::vector<std::pair<std::string, std::string>>;
+
+    // 运行时调整主缓存的容量，不需要重启也不会丢失数据，缩小时立即淘汰超出的部分，返回淘汰的缓存项数。
+    // 加入内存预算的缓存组应通过 MemoryBudget::Resize 调整
+    auto SetMaxBytes(int64_t max_bytes) -> int64_t;
+    auto MaxBytes() const -> int64_t { return cache_->MaxBytes(); }
+    // 加入的内存预算，没有时为空
+    auto Budget() const -> MemoryBudget* { return budget_.load(); }
+
+    // 幽灵缓存的容量，0 表示关闭；幽灵缓存命中数即容量再大这么多时能多命中的次数
+    void SetGhostBytes(int64_t bytes) { ghost_->SetMaxBytes(bytes); }
+    auto GhostHits() const -> int64_t { return ghost_->Hits(); }
+
+    // 估计的不同容量下的命中率，容量从当前容量的 1/16 到 16 倍按 2 倍递增；未开启估计时为空
+    auto HitRatioCurve() -> std::vector<MrcPoint>;
+
+    // 淘汰策略，支持 "lru" 和 "gdsf"
+    auto EvictionPolicy() const -> std::string;
+    bool SetEvictionPolicy(const std::string& policy);
+
 private:
-    auto Load(const std::string& key) -> ByteViewOptional;
-    auto LoadData(const std::string& key) -> ByteViewOptional;
+    // 加载完成时的内部回调，带上加载结果和这次加载的耗时（纳秒）
+    using LoadDone = std::function<void(ByteViewOptional, LoadStatus, int64_t cost)>;
+
+    friend auto MakeCacheGroup(const std::string& name, int64_t bytes, DataGetter getter, GroupOptions opts)
+        -> KCacheGroup&;
+    friend class MemoryBudget;
+
+    // 所有等待者共享同一份结果，不逐个复制；status 可选，返回加载结果，用于区分数据不存在和加载失败
+    auto Load(const std::string& key, LoadStatus* status = nullptr) -> std::shared_ptr<const ByteView>;
+    // 发起一次加载，完成时写入缓存并唤醒 SingleFlight 上的所有等待者
+    void LoadData(const std::string& key, const SingleFlight::FlightPtr& flight);
+
+    // 在批量加载器、加载线程池或异步 getter 上发起一次加载，并发数或排队数超限时返回 false
+    bool StartLoad(const std::string& key, const SingleFlight::FlightPtr& flight, LoadDone done);
+    // cost 为 getter 本身的耗时（纳秒），不包括排队和攒批等待；
+    // trace 为发起加载的请求的追踪编号，加载可能在其他线程上完成
+    void RecordLoad(int64_t cost, bool ok, uint64_t trace);
+    void FinishLoad();
+    // 记录一次拿到数据的读取，供缺失率曲线估计和访问轨迹使用，cost 为这次读取的回源耗时，命中时为 0
+    void RecordAccess(const std::string& key, int64_t bytes, int64_t cost = 0);
+    // 记录一次没有拿到数据的读取，只写入访问轨迹，回放时计入读取总数，避免高估命中率
+    void RecordMiss(const std::string& key, int64_t cost = 0);
+
+    // 在后台通过 SingleFlight 重新加载即将过期的 key，期间继续返回旧值
+    void RefreshAsync(const std::string& key);
+    // 按 ttl 计算新写入数据的过期时间点
+    auto ExpireAt() const -> int64_t;
+
+    // 读-改-写操作的公共部分：在 key 的写锁和缓存锁内计算新值并写入，按配置写回数据源；
+    // load_missing 为 true 时缓存中没有有效值会先回源，回源失败时返回空
+    auto Mutate(const std::string& key, const LRUCache::UpdateFunc& fn, bool load_missing = false)
+        -> std::optional<Entry>;
+    // 写入新值，成功后撤销租约、清理负缓存、更新索引并使 L0 缓存失效
+    auto Commit(const std::string& key, const LRUCache::UpdateFunc& fn) -> std::optional<Entry>;
+    // write-through 模式下同步写回数据源
+    bool Persist(const std::string& key, const ByteView& value);
+    auto WriteLock(const std::string& key) -> std::mutex&;
+
+    // 写入缓存并更新标签索引，cost 为加载耗时（纳秒），0 表示没有实测耗时，由缓存按平均代价估计
+    void Store(const std::string& key, const ByteView& value, const std::vector<std::string>& tags = {},
+               int64_t cost = 0);
+    // 批量失效：撤销租约并删除缓存
+    void InvalidateKeys(const std::vector<std::string>& keys);
+
+    // 尚未写回数据源的值，回源前先检查，避免读到数据源中的旧值
+    auto PendingWrite(const std::string& key) -> ByteViewOptional;
+
+    // 写入或删除 key 之后调用，使所有线程 L0 缓存中同一分段的数据失效
+    void InvalidateL0(const std::string& key);
+    auto L0Epoch(size_t hash) -> std::atomic<uint64_t>&;
+
+    // 负缓存：记录、查询和清除已知不存在的 key
+    void RememberAbsent(const std::string& key);
+    auto IsKnownAbsent(const std::string& key) -> bool;
+    void ForgetAbsent(const std::string& key);
+
+    // 失效时撤销进行中的租约，避免旧数据被填回，stash_stale 为 true 时保留旧值供等待者使用
+    void RevokeLease(const std::string& key, bool stash_stale);
+    // 撤销所有满足条件的租约
+    void RevokeLeases(const std::function<bool(const std::string& key)>& match);
 
 private:
+    static constexpr size_t kL0Stripes = 64;
+
+    // 独占缓存行，写入一个分段不会让读其他分段的线程缓存失效
+    struct alignas(64) PaddedEpoch {
+        std::atomic<uint64_t> value{0};
+    };
+
+    uint64_t uid_{0};  // 进程内唯一的缓存组 id，用于区分 L0 缓存中不同缓存组的数据
+    uint32_t id_{0};   // 由 MakeCacheGroup 分配
     std::unique_ptr<LRUCache> cache_;
+    std::unique_ptr<LRUCache> negative_cache_;  // 已知不存在的 key，有独立的内存上限和过期时间
+    std::unique_ptr<LRUCache> stale_cache_;     // 开启租约时保存失效前的旧值
+    std::unique_ptr<TagIndex> tag_index_;       // 由缓存的淘汰回调维护
+    std::unique_ptr<GhostCache> ghost_;         // 由缓存的容量淘汰回调维护
     std::string name_;
     std::atomic<bool> is_close_{false};
+    std::atomic<MemoryBudget*> budget_{nullptr};  // 由 MemoryBudget 在加入和移出时设置
     DataGetter getter_;
     SingleFlight loader_;
     GroupStatus status_;
+
+    GroupOptions opts_;
+    std::unique_ptr<LoaderPool> loader_pool_;
+    std::unique_ptr<BatchLoader> batch_loader_;
+
+    std::unique_ptr<WriteBehindQueue> write_behind_;
+    std::unique_ptr<HotKeySketch> hot_keys_;
+    std::unique_ptr<MissRatioCurve> mrc_;
+    std::array<PaddedEpoch, kL0Stripes> l0_epochs_;  // 按 key 分段的失效计数，L0 缓存中的数据记录写入时的值
+    std::array<std::mutex, 64> write_locks_;  // 按 key 分段加锁，保证同一个 key 写数据源和写缓存的顺序一致
+
+    std::unique_ptr<LoaderPool> refresh_pool_;  // 提前刷新使用独立线程，避免占用加载线程导致死锁
+    std::unordered_set<std::string> refreshing_;
+    std::mutex refresh_mtx_;
+    std::atomic<int> inflight_loads_{0};  // 已发起但尚未完成的加载数
+    std::mutex inflight_mtx_;
+    std::condition_variable inflight_cv_;
+
+    // 异步 getter 的回调持有它，缓存组析构后到达的回调据此直接返回，不再访问本对象
+    struct AsyncLoadGuard {
+        std::shared_mutex mtx;
+        bool is_alive{true};
+    };
+    std::shared_ptr<AsyncLoadGuard> async_guard_{std::make_shared<AsyncLoadGuard>()};
+
+    struct Lease {
+        uint64_t token;
+        int64_t expire_at;
+    };
+    std::unordered_map<std::string, Lease> leases_;
+    std::mutex lease_mtx_;
+    std::atomic<uint64_t> next_lease_token_{1};
 };
 
-auto MakeCacheGroup(const std::string& name, int64_t bytes, DataGetter getter) -> KCacheGroup&;
+// 持有期间通过 GetCacheGroup、GetCacheGroups 取得的缓存组指针保持有效。可以嵌套，只在创建它的线程内使用
+class GroupReadGuard {
+public:
+    GroupReadGuard();
+
+    ~GroupReadGuard();
+
+    GroupReadGuard(const GroupReadGuard&) = delete;
+    auto operator=(const GroupReadGuard&) -> GroupReadGuard& = delete;
+};
+
+// 创建并注册缓存组；同名缓存组已存在时替换它并沿用原来的编号。被替换的缓存组立即关闭，
+// 等替换前开始的 GroupReadGuard 都结束后才释放，此后原来的引用失效
+auto MakeCacheGroup(const std::string& name, int64_t bytes, DataGetter getter, GroupOptions opts = GroupOptions{})
+    -> KCacheGroup&;
+// 查找不加锁，读取注册表的当前快照；缓存组可能被替换时，返回的指针只在 GroupReadGuard 期间使用
 auto GetCacheGroup(const std::string& name) -> KCacheGroup*;
+// 按编号查找，只是一次数组下标访问
+auto GetCacheGroup(uint32_t id) -> KCacheGroup*;
+// 按编号顺序返回所有缓存组
+auto GetCacheGroups() -> std::vector<KCacheGroup*>;
+
+// 输出所有缓存组的监控指标
+void WriteGroupMetrics(PrometheusWriter* writer);
 
 }  // namespace kcache
 
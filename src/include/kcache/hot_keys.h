@@ -0,0 +1,74 @@
+#ifndef HOT_KEYS_H_
+#define HOT_KEYS_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kcache {
+
+struct HotKey {
+    std::string key;
+    int64_t count;  // 估计的访问次数（采样后）
+    int64_t error;  // 估计值可能偏大的上限
+};
+
+// 基于 Space-Saving 算法的热点 key 统计：只跟踪固定数量的 key，内存与访问的 key 数无关；
+// 访问按比例采样，采样数达到窗口大小后所有计数减半，过气的热点会逐渐被淘汰。
+// 热点判定在每个请求上都会执行，因此不读统计本身，而是读定期发布的热点集合快照，不加锁
+class HotKeySketch {
+public:
+    // 保守估计的访问次数（count - error）占全部采样的比例不低于 ratio 时为热点
+    HotKeySketch(size_t capacity, int sample_rate, int64_t window, double ratio);
+
+    // 记录一次访问
+    void Record(const std::string& key);
+
+    // 是否在最近一次发布的热点集合中
+    auto IsHot(const std::string& key) const -> bool;
+
+    // 按访问次数从高到低返回最多 k 个 key
+    auto TopK(size_t k) -> std::vector<HotKey>;
+
+    // 热点集合最多包含的 key 数，ratio 不低于 1/kMaxHotKeys 时不会截断
+    static constexpr size_t kMaxHotKeys = 64;
+
+private:
+    void Decay();
+    // 重新计算热点集合并发布，调用时持有锁
+    void Publish();
+
+    struct Counter {
+        int64_t count;
+        int64_t error;
+    };
+
+    // 热点 key 的哈希；两份轮流发布，写入的总是读取方当前没有在用的那一份
+    struct HotSet {
+        std::array<std::atomic<size_t>, kMaxHotKeys> hashes{};
+        std::atomic<size_t> size{0};
+    };
+
+    size_t capacity_;
+    int sample_rate_;
+    int64_t window_;
+    double ratio_;
+    int64_t total_{0};
+    int64_t since_publish_{0};
+    std::unordered_map<std::string, Counter> counters_;
+    std::set<std::pair<int64_t, std::string>> order_;  // 按 (count, key) 排序，计数最小的在最前面
+    std::mutex mtx_;
+
+    std::array<HotSet, 2> hot_sets_;
+    std::atomic<int> current_{0};
+};
+
+}  // namespace kcache
+
+#endif /* HOT_KEYS_H_ */
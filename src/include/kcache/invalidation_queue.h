@@ -0,0 +1,64 @@
+#ifndef INVALIDATION_QUEUE_H_
+#define INVALIDATION_QUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace kcache {
+
+// 把一批 (group, key) 的失效通知发给节点，返回 false 表示发送失败，稍后整批重试
+using InvalidationSender = std::function<bool(const std::vector<std::pair<std::string, std::string>>& batch)>;
+
+// 客户端到单个节点的失效队列：同一个 key 在发送之前的多次失效只发送一次，
+// 后台线程按入队顺序批量发送，失败的批次放回队首，间隔 retry_interval 后重试
+class InvalidationQueue {
+public:
+    InvalidationQueue(std::string addr, InvalidationSender sender, size_t max_batch_size,
+                      std::chrono::milliseconds retry_interval);
+
+    // 等同于 Stop
+    ~InvalidationQueue();
+
+    InvalidationQueue(const InvalidationQueue&) = delete;
+    auto operator=(const InvalidationQueue&) -> InvalidationQueue& = delete;
+
+    // 记录一次失效，停止后忽略
+    void Push(const std::string& group, const std::string& key);
+
+    // 尚未送达的失效通知数（包括正在发送的）
+    auto Pending() -> size_t;
+
+    // 停止队列：继续发送积压的失效通知，直到队列为空或某次发送失败（此时丢弃剩余的通知），
+    // 返回时后台线程已退出，可以重复调用
+    void Stop();
+
+private:
+    void SendLoop();
+
+private:
+    std::string addr_;
+    InvalidationSender sender_;
+    size_t max_batch_size_;
+    std::chrono::milliseconds retry_interval_;
+
+    bool is_stop_{false};
+    std::deque<std::pair<std::string, std::string>> queue_;  // 待发送的 (group, key)
+    std::unordered_set<std::string> queued_;                 // 已在队列中的 group + '\0' + key，用于合并
+    size_t inflight_{0};                                     // 正在发送的 key 数
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::thread worker_;
+};
+
+}  // namespace kcache
+
+#endif /* INVALIDATION_QUEUE_H_ */
@@ -0,0 +1,50 @@
+#ifndef L0_CACHE_H_
+#define L0_CACHE_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "kcache/cache.h"
+
+namespace kcache {
+
+// L0 缓存中的一项，值是引用计数的不可变数据，同一个值可以被多个线程的 L0 缓存共享
+struct L0Entry {
+    uint64_t owner{0};  // 所属缓存组的 id，0 表示空槽
+    size_t hash{0};
+    std::string key;
+    std::shared_ptr<const ByteView> value;
+    uint64_t version{0};
+    uint64_t generation{0};  // 写入时缓存组的代数
+    uint64_t epoch{0};       // 写入时 key 所在分段的失效计数
+    int64_t expire_at{0};
+    int64_t hits{0};  // 尚未计入缓存组访问次数的命中数
+};
+
+// 每个线程私有的直接映射小缓存，放在缓存组前面；命中时只读写线程私有的内存，不加锁也不写共享数据。
+// 所有缓存组共用一张表，按 (缓存组 id, key) 区分
+class L0Cache {
+public:
+    static constexpr size_t kSlots = 256;
+
+    // 当前线程的 L0 缓存
+    static auto Local() -> L0Cache&;
+
+    // 查找 key 所在的槽，不存在时返回 nullptr，有效性由调用方检查
+    auto Find(uint64_t owner, size_t hash, const std::string& key) -> L0Entry*;
+
+    // 同一个 key 第二次写入同一个槽时才真正写入，避免只访问一次的 key 挤掉热点
+    void Put(L0Entry entry);
+
+private:
+    static auto Index(uint64_t owner, size_t hash) -> size_t;
+
+    std::array<L0Entry, kSlots> slots_;
+    std::array<size_t, kSlots> candidates_{};  // 每个槽上一次被拒绝写入的 key 的 hash ^ owner
+};
+
+}  // namespace kcache
+
+#endif /* L0_CACHE_H_ */
@@ -0,0 +1,48 @@
+#ifndef LOADER_POOL_H_
+#define LOADER_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kcache {
+
+// 缓存组专用的有界加载线程池：线程数即最大并发加载数，排队任务数有上限，
+// 慢查询只会占满本组的加载线程，不会阻塞 gRPC 请求线程
+class LoaderPool {
+    using Task = std::function<void()>;
+
+public:
+    LoaderPool(int threads, int max_pending);
+
+    // 停止接收新任务，执行完已排队的任务后退出
+    ~LoaderPool();
+
+    LoaderPool(const LoaderPool&) = delete;
+    auto operator=(const LoaderPool&) -> LoaderPool& = delete;
+
+    // 提交任务，队列已满或线程池已停止时返回 false
+    bool Submit(Task task);
+
+    // 排队中（尚未开始执行）的任务数
+    auto Pending() -> size_t;
+
+private:
+    void WorkerLoop();
+
+private:
+    size_t max_pending_;
+    bool is_stop_{false};
+    std::deque<Task> tasks_;
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace kcache
+
+#endif /* LOADER_POOL_H_ */
@@ -0,0 +1,75 @@
+// 日志工具：热路径上的调试日志使用 SPDLOG_DEBUG/SPDLOG_TRACE 宏，低于编译期级别 SPDLOG_ACTIVE_LEVEL
+// （CMake 选项 KCACHE_LOG_LEVEL）的调用连同参数求值一起被去掉；频繁触发的日志通过 LogRateLimited 限速
+
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include "kcache/cache.h"
+
+namespace kcache {
+
+// 日志中最多输出 value 的前多少个字节
+constexpr size_t kLogValuePreview = 64;
+
+// 每秒最多放行 per_second 条日志，超出的只计数，下一次放行时一并报告
+class LogRateLimiter {
+public:
+    explicit LogRateLimiter(int per_second) : per_second_(per_second) {}
+
+    // 放行时返回 true，并取走此前被丢弃的条数
+    auto Allow(int64_t* suppressed) -> bool;
+
+private:
+    int per_second_;
+    std::atomic<int64_t> window_{0};  // 当前计数所属的秒
+    std::atomic<int> count_{0};
+    std::atomic<int64_t> suppressed_{0};
+};
+
+// 级别未开启时只判断一次级别，不会格式化参数
+template <typename... Args>
+void LogRateLimited(LogRateLimiter& limiter, spdlog::level::level_enum level, spdlog::format_string_t<Args...> fmt,
+                    Args&&... args) {
+    if (!spdlog::should_log(level)) {
+        return;
+    }
+    int64_t suppressed = 0;
+    if (!limiter.Allow(&suppressed)) {
+        return;
+    }
+    if (suppressed > 0) {
+        spdlog::log(level, "{} similar log messages were suppressed", suppressed);
+    }
+    spdlog::log(level, fmt, std::forward<Args>(args)...);
+}
+
+// 设置默认 logger：level 取值同 spdlog（trace、debug、info、warn、error、critical、off），
+// async 为 true 时由后台线程写日志，队列满时丢弃最旧的日志，请求线程不会被阻塞
+void InitLogging(const std::string& name, const std::string& level, bool async);
+
+}  // namespace kcache
+
+// 按需格式化 ByteView，不会先拷贝成 std::string；过长的值只输出前 kLogValuePreview 个字节
+template <>
+struct fmt::formatter<kcache::ByteView> : fmt::formatter<std::string_view> {
+    auto format(const kcache::ByteView& value, format_context& ctx) const -> decltype(ctx.out()) {
+        auto len = std::min(value.data_.size(), kcache::kLogValuePreview);
+        auto out = fmt::formatter<std::string_view>::format(std::string_view(value.data_.data(), len), ctx);
+        if (len < value.data_.size()) {
+            out = fmt::format_to(out, "...({} bytes)", value.data_.size());
+        }
+        return out;
+    }
+};
+
+#endif /* LOG_H_ */
@@ -0,0 +1,82 @@
+#ifndef MEMORY_BUDGET_H_
+#define MEMORY_BUDGET_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "kcache/group.h"
+
+namespace kcache {
+
+// 节点级内存预算：所有加入的缓存组共享 total_bytes 的主缓存容量，定期按边际收益在缓存组之间移动容量。
+// 每个缓存组开启 step_bytes 大小的幽灵缓存，一轮中幽灵缓存命中最多的缓存组多给 step_bytes 就能多命中最多，
+// 命中最少的缓存组让出 step_bytes 损失最小（假设命中率曲线是凹的），于是从后者移给前者，直到收益持平
+class MemoryBudget {
+public:
+    // interval 为 0 时不启动后台线程，由调用方自己调用 Rebalance
+    MemoryBudget(int64_t total_bytes, int64_t step_bytes, std::chrono::milliseconds interval);
+
+    ~MemoryBudget();
+
+    MemoryBudget(const MemoryBudget&) = delete;
+    auto operator=(const MemoryBudget&) -> MemoryBudget& = delete;
+
+    // 把缓存组纳入预算，容量保持在 [min_bytes, max_bytes] 内（max_bytes 为 0 表示只受总预算限制）。
+    // 初始容量取缓存组当前容量，超出剩余预算时缩小到剩余预算；剩余预算不足 min_bytes
+    // 或缓存组已经加入了某个预算时返回 false
+    bool Attach(KCacheGroup* group, int64_t min_bytes, int64_t max_bytes = 0);
+
+    // 移出预算，容量归还给未分配的部分，缓存组保持当前容量
+    void Detach(KCacheGroup* group);
+
+    // 手动调整缓存组分到的容量（如管理接口），需要在 [min_bytes, max_bytes] 内且增加的部分不超过剩余预算；
+    // 返回淘汰的缓存项数，不满足条件或缓存组不在预算中时返回空
+    auto Resize(KCacheGroup* group, int64_t bytes) -> std::optional<int64_t>;
+
+    // 按这一轮的幽灵缓存命中数移动一次容量，返回是否有调整
+    bool Rebalance();
+
+    // 各缓存组当前分到的容量
+    auto Allocations() -> std::vector<std::pair<std::string, int64_t>>;
+    // 还没有分给任何缓存组的容量
+    auto Unallocated() -> int64_t;
+
+private:
+    struct Member {
+        KCacheGroup* group;
+        int64_t min_bytes;
+        int64_t max_bytes;
+        int64_t bytes;
+        int64_t last_ghost_hits;
+        double gain{0};  // 平滑后的每轮幽灵缓存命中数
+    };
+
+    void RebalanceLoop();
+    // 还能增加的容量，调用时持有锁
+    auto Room(const Member& member) const -> int64_t;
+    // 容量被绕过预算修改时以缓存的实际容量为准，超出预算的部分收回，调用时持有锁
+    void Sync(Member* member);
+    // 调用时持有锁
+    auto Find(KCacheGroup* group) -> Member*;
+
+    int64_t total_bytes_;
+    int64_t step_bytes_;
+    std::chrono::milliseconds interval_;
+    int64_t free_bytes_;
+    std::vector<Member> members_;
+    bool is_stop_{false};
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::thread rebalancer_;
+};
+
+}  // namespace kcache
+
+#endif /* MEMORY_BUDGET_H_ */
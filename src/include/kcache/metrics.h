@@ -0,0 +1,142 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace kcache {
+
+// 计数器和直方图的分片数，每个线程固定使用其中一个分片
+constexpr size_t kMetricShards = 16;
+
+// 当前线程使用的分片，线程创建后按顺序分配，不同核心上的线程大多落在不同分片
+auto MetricShard() -> size_t;
+
+// 按线程分片的计数器：每个分片独占一个缓存行，累加时不会在核心之间争抢缓存行，读取时汇总所有分片
+class ShardedCounter {
+public:
+    void Add(int64_t n) { shards_[MetricShard()].value.fetch_add(n, std::memory_order_relaxed); }
+
+    auto operator++() -> ShardedCounter& {
+        Add(1);
+        return *this;
+    }
+
+    auto operator+=(int64_t n) -> ShardedCounter& {
+        Add(n);
+        return *this;
+    }
+
+    auto Load() const -> int64_t;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<int64_t> value{0};
+    };
+
+    std::array<Shard, kMetricShards> shards_;
+};
+
+// 延迟分布的摘要（纳秒）
+struct LatencySummary {
+    int64_t count{0};
+    int64_t p50{0};
+    int64_t p99{0};
+    int64_t p999{0};
+    int64_t max{0};
+};
+
+// 直方图的快照，counts 与 LatencyHistogram 的桶一一对应
+struct HistogramSnapshot {
+    std::vector<int64_t> counts;
+    int64_t count{0};
+    int64_t sum{0};  // 所有记录值的和（纳秒）
+
+    // 第 p（0~1）分位的值，返回所在桶的上界，误差不超过 1/16
+    auto Percentile(double p) const -> int64_t;
+    auto Summary() const -> LatencySummary;
+};
+
+// HDR 风格的延迟直方图：小于 32ns 的值精确记录，更大的值每个 2 的幂区间再线性分为 16 个桶，
+// 相对误差不超过 6.25%；按线程分片，记录一次只是一次无竞争的原子加
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr int kMaxBits = 40;  // 最大可记录约 36 分钟，更大的值计入最后一个桶
+    static constexpr size_t kLinearBuckets = size_t{1} << (kSubBucketBits + 1);
+    static constexpr size_t kBuckets = kLinearBuckets + (kMaxBits - kSubBucketBits) * (size_t{1} << kSubBucketBits);
+
+    LatencyHistogram();
+
+    void Record(int64_t ns) {
+        auto& shard = shards_[MetricShard()];
+        shard.counts[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+        shard.sum.fetch_add(ns > 0 ? ns : 0, std::memory_order_relaxed);
+    }
+
+    void Record(std::chrono::nanoseconds duration) { Record(duration.count()); }
+
+    auto Snapshot() const -> HistogramSnapshot;
+
+    static auto BucketIndex(int64_t ns) -> size_t {
+        if (ns < static_cast<int64_t>(kLinearBuckets)) {
+            return ns > 0 ? static_cast<size_t>(ns) : 0;
+        }
+        int msb = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+        if (msb > kMaxBits) {
+            return kBuckets - 1;
+        }
+        // 取最高的 kSubBucketBits + 1 位，去掉最高位后就是区间内的线性桶号
+        auto sub = (static_cast<uint64_t>(ns) >> (msb - kSubBucketBits)) - (uint64_t{1} << kSubBucketBits);
+        return kLinearBuckets + (msb - kSubBucketBits - 1) * (size_t{1} << kSubBucketBits) + sub;
+    }
+
+    // 桶中最大的值
+    static auto BucketUpperBound(size_t index) -> int64_t;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<int64_t>, kBuckets> counts{};
+        std::atomic<int64_t> sum{0};
+    };
+
+    std::unique_ptr<Shard[]> shards_;  // 较大，放在堆上
+};
+
+// 按 Prometheus 文本格式输出指标，同名指标的样本集中在一起，HELP/TYPE 只输出一次
+class PrometheusWriter {
+public:
+    // 生成 key="value" 形式的标签，转义值中的特殊字符
+    static auto Label(const std::string& key, const std::string& value) -> std::string;
+
+    void Counter(const std::string& name, const std::string& help, const std::string& labels, double value);
+    void Gauge(const std::string& name, const std::string& help, const std::string& labels, double value);
+    // 以秒为单位输出，桶边界为 1us 到 17s 之间 4 的幂次纳秒
+    void Histogram(const std::string& name, const std::string& help, const std::string& labels,
+                   const HistogramSnapshot& snapshot);
+
+    auto Render() const -> std::string;
+
+private:
+    struct Family {
+        std::string name;
+        std::string help;
+        std::string type;
+        std::string samples;
+    };
+
+    auto GetFamily(const std::string& name, const std::string& help, const std::string& type) -> Family&;
+    static void AppendSample(std::string* out, const std::string& name, const std::string& labels, double value);
+
+    std::vector<Family> families_;
+};
+
+}  // namespace kcache
+
+#endif /* METRICS_H_ */
@@ -0,0 +1,81 @@
+#ifndef MRC_H_
+#define MRC_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace kcache {
+
+// 缺失率曲线上的一个点
+struct MrcPoint {
+    int64_t cache_bytes;
+    double hit_ratio;
+};
+
+// 在线估计缺失率曲线（SHARDS 固定样本数版本）：按 key 的哈希做空间采样，只有哈希落在阈值以下的 key 才被跟踪，
+// 对它们计算以字节计的重用距离（两次访问之间访问过的不同 key 的总大小），再按采样率放大。
+// 容量为 C 的 LRU 缓存命中一次访问，当且仅当它的重用距离不超过 C，因此距离的分布就是各容量下的命中率。
+// 跟踪的 key 超过 max_samples 时降低阈值，丢弃哈希最大的 key，内存与访问的 key 数无关；
+// 未被采样的访问只需要计算一次哈希
+class MissRatioCurve {
+public:
+    explicit MissRatioCurve(size_t max_samples, double initial_rate = 0.01);
+
+    // 记录一次访问，bytes 为缓存项的大小
+    void Record(const std::string& key, int64_t bytes);
+
+    // 估计的容量为 cache_bytes 时的命中率，冷启动未命中也计入分母
+    auto HitRatio(int64_t cache_bytes) -> double;
+
+    // 从 min_bytes 开始每次翻倍，直到覆盖观察到的最大重用距离（最多到 max_bytes）
+    auto Curve(int64_t min_bytes, int64_t max_bytes) -> std::vector<MrcPoint>;
+
+    auto SampleRate() -> double;
+
+private:
+    // 采样值取哈希的高位，取值范围 [0, kModulus)
+    static constexpr uint64_t kModulus = uint64_t{1} << 24;
+    // 重用距离直方图：第 i 个桶覆盖 [2^(i/2), 2^((i+1)/2)) 字节，相邻桶相差约 41%
+    static constexpr size_t kBuckets = 96;
+    // 采样访问数达到该值后直方图减半，让曲线跟随访问模式的变化
+    static constexpr int64_t kWindow = int64_t{1} << 20;
+
+    struct Sample {
+        uint64_t time;  // 最后一次访问的逻辑时间
+        int64_t bytes;
+    };
+
+    static auto BucketIndex(int64_t distance) -> size_t;
+    static auto BucketUpperBound(size_t index) -> int64_t;
+
+    // 树状数组：位置为逻辑时间，值为该时间最后一次访问的 key 的大小
+    void TreeAdd(uint64_t time, int64_t delta);
+    auto TreeSum(uint64_t time) const -> int64_t;
+    // 逻辑时间用尽时按最后访问时间重新编号，调用时持有锁
+    void Compact();
+    // 丢弃采样值最大的 key 并降低阈值，调用时持有锁
+    void Shrink();
+    void Decay();
+
+    size_t max_samples_;
+    std::atomic<uint32_t> threshold_;                 // 采样值小于阈值的 key 被跟踪，只会降低
+    uint64_t now_{0};
+    std::vector<int64_t> tree_;                       // 下标从 1 开始
+    std::unordered_map<uint64_t, Sample> samples_;    // key 的哈希 -> 采样信息
+    std::set<std::pair<uint32_t, uint64_t>> levels_;  // (采样值, key 的哈希)，用于找到采样值最大的 key
+    std::array<double, kBuckets> histogram_{};        // 按 1/采样率 加权，降低采样率前后的计数可以直接相加
+    double cold_{0};                                  // 第一次访问（无穷大的重用距离）
+    int64_t recorded_{0};                             // 上一次减半之后采样的访问数
+    std::mutex mtx_;
+};
+
+}  // namespace kcache
+
+#endif /* MRC_H_ */
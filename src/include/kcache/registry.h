@@ -4,7 +4,9 @@
 #include <atomic>
 #include <etcd/Client.hpp>
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace kcache {
 
@@ -22,6 +24,12 @@ public:
     // 撤销租约并删除服务信息，确保节点下线时不会被其他服务继续发现。
     void Unregister();
 
+    // 列出当前注册在 etcd 中的所有服务地址（包括自身）
+    auto ListServices(const std::string& svc_name) -> std::vector<std::string>;
+
+    // 注册到 etcd 的本节点地址
+    auto Addr() const -> const std::string& { return addr_; }
+
 private:
     auto GetLocalIP() -> std::string;
 
@@ -30,6 +38,7 @@ private:
     int64_t lease_id_{0};
     std::unique_ptr<etcd::Client> etcd_client_;
     std::string key_;
+    std::string addr_;
     std::thread keepalive_thread_;
     std::atomic<bool> is_stop_{false};
 };
@@ -1,9 +1,16 @@
 #ifndef GRPC_SERVER_H_
 #define GRPC_SERVER_H_
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <grpcpp/grpcpp.h>
@@ -11,8 +18,14 @@
 
 #include "kcache.grpc.pb.h"
 #include "kcache.pb.h"
+#include "kcache/admin.h"
+#include "kcache/group.h"
 #include "kcache/registry.h"
 
+namespace httplib {
+class Server;
+}  // namespace httplib
+
 namespace kcache {
 
 struct ServerOptions {
@@ -22,13 +35,23 @@ struct ServerOptions {
     bool tls;
     std::string cert_file;
     std::string key_file;
+    int handoff_batch_size;                      // 数据迁移时每批的条目数
+    int handoff_rate;                            // 数据迁移限速（条目/秒），0 表示不限速
+    int handoff_max_entries;                     // 上下线迁移时每个缓存组最多检查的热点条目数，0 表示不限
+    std::chrono::milliseconds handoff_timeout;  // 单次迁移的超时时间
+    int metrics_port;                           // 以 Prometheus 文本格式提供 /metrics 的 HTTP 端口，0 表示关闭
 
     // Default constructor to set default values
     ServerOptions()
         : etcd_endpoints({"http://127.0.0.1:2379"}),
           dial_timeout(std::chrono::seconds(5)),
           max_msg_size(4 << 20),  // 4MB
-          tls(false) {}
+          tls(false),
+          handoff_batch_size(128),
+          handoff_rate(10000),
+          handoff_max_entries(10000),
+          handoff_timeout(std::chrono::seconds(30)),
+          metrics_port(0) {}
 };
 
 // Function type for options
@@ -51,10 +74,22 @@ inline auto WithTLS(const std::string& certFile, const std::string& keyFile) ->
     };
 }
 
+inline auto WithHandoff(int batch_size, int rate, int max_entries) -> ServerOption {
+    return [batch_size, rate, max_entries](ServerOptions* o) {
+        o->handoff_batch_size = batch_size;
+        o->handoff_rate = rate;
+        o->handoff_max_entries = max_entries;
+    };
+}
+
+inline auto WithMetricsPort(int port) -> ServerOption {
+    return [port](ServerOptions* o) { o->metrics_port = port; };
+}
+
 class KCacheServer final : public pb::KCache::Service {
 public:
     KCacheServer(const std::string& addr, const std::string& svc_name, ServerOptions opts = ServerOptions{});
-    ~KCacheServer() = default;
+    ~KCacheServer();
 
     auto Get(grpc::ServerContext* context, const pb::Request* request, pb::GetResponse* response)
         -> grpc::Status override;
@@ -68,25 +103,122 @@ public:
     auto Invalidate(grpc::ServerContext* context, const pb::Request* request, pb::InvalidateResponse* response)
         -> grpc::Status override;
 
+    // 批量处理来自客户端失效队列的失效通知
+    auto BatchInvalidate(grpc::ServerContext* context, const pb::BatchInvalidateRequest* request,
+                         pb::BatchInvalidateResponse* response) -> grpc::Status override;
+
+    // 按标签批量失效本节点的缓存
+    auto InvalidateTag(grpc::ServerContext* context, const pb::InvalidateTagRequest* request,
+                       pb::BulkInvalidateResponse* response) -> grpc::Status override;
+
+    // 按前缀批量失效本节点的缓存
+    auto InvalidatePrefix(grpc::ServerContext* context, const pb::InvalidatePrefixRequest* request,
+                          pb::BulkInvalidateResponse* response) -> grpc::Status override;
+
+    // 清空本节点上的缓存组
+    auto Flush(grpc::ServerContext* context, const pb::FlushRequest* request, pb::FlushResponse* response)
+        -> grpc::Status override;
+
+    // 条件写入，在 owner 节点上原子执行
+    auto CompareAndSet(grpc::ServerContext* context, const pb::CasRequest* request, pb::CasResponse* response)
+        -> grpc::Status override;
+
+    // 原子加减计数器
+    auto Incr(grpc::ServerContext* context, const pb::IncrRequest* request, pb::IncrResponse* response)
+        -> grpc::Status override;
+
+    // 原子追加
+    auto Append(grpc::ServerContext* context, const pb::Request* request, pb::AppendResponse* response)
+        -> grpc::Status override;
+
+    // 上报本节点的真实负载，供客户端做集群视角的负载均衡
+    auto Stats(grpc::ServerContext* context, const pb::StatsRequest* request, pb::StatsResponse* response)
+        -> grpc::Status override;
+
+    // 向原 owner 提供现在归属于拉取方的数据
+    auto Pull(grpc::ServerContext* context, const pb::PullRequest* request,
+              grpc::ServerWriter<pb::TransferBatch>* writer) -> grpc::Status override;
+
+    // 接收下线节点推送过来的热点数据
+    auto Push(grpc::ServerContext* context, grpc::ServerReader<pb::TransferBatch>* reader,
+              pb::PushResponse* response) -> grpc::Status override;
+
+    // 带租约的读取，防止 key 失效后整个集群同时回源
+    auto Lease(grpc::ServerContext* context, const pb::Request* request, pb::LeaseResponse* response)
+        -> grpc::Status override;
+
+    // 租约持有者回源后写入数据
+    auto Fill(grpc::ServerContext* context, const pb::FillRequest* request, pb::FillResponse* response)
+        -> grpc::Status override;
+
     void Start();
 
+    // 节点加入后预热：从其他节点拉取哈希环上现在归属于本节点的数据，需在缓存组创建之后调用
+    void WarmUp();
+
     void Stop();
 
+    // 本节点所有缓存组和 gRPC 服务的监控指标，只读取原子变量，不会加缓存锁
+    auto RenderMetrics() -> std::string;
+
 private:
+    // 统计请求数和正在处理的请求数，后者即 gRPC 线程池的排队深度
+    class RequestScope {
+    public:
+        explicit RequestScope(KCacheServer* server) : server_(server) {
+            ++server_->requests_;
+            ++server_->inflight_;
+        }
+        ~RequestScope() { --server_->inflight_; }
+
+    private:
+        KCacheServer* server_;
+        GroupReadGuard groups_;  // 请求期间取得的缓存组指针保持有效
+    };
+
+    void StartMetricsServer();
+
     // Helper for loading TLS credentials
     auto LoadTLSCredentials(const std::string& cert_file, const std::string& key_file)
         -> std::shared_ptr<grpc::ServerCredentials>;
 
+    // 下线前把热点数据推送给哈希环上的后继节点
+    void Drain();
+
+    // 到集群中其他节点的连接，按注册地址复用；addr 不是最近一次看到的集群成员时返回空，
+    // 请求方因此无法让本节点连接任意地址
+    auto PeerStub(const std::string& addr) -> std::shared_ptr<pb::KCache::Stub>;
+
+    // 从 etcd 刷新集群成员并关闭已下线节点的连接，返回当前成员（包括本节点）
+    auto RefreshPeers() -> std::vector<std::string>;
+
+    // 定期刷新集群成员，直到服务停止
+    void PeerRefreshLoop();
+
 private:
     std::string addr_;
     std::string svc_name_;
 
     std::unique_ptr<grpc::Server> grpc_server_;
     std::unique_ptr<EtcdRegistry> etcd_register_;
+    std::unique_ptr<KCacheAdmin> admin_;  // 使用 etcd_register_，需要在它之前停止
 
     std::atomic<bool> is_stop_;
 
+    std::atomic<int64_t> requests_{0};      // 处理的请求数
+    std::atomic<int64_t> bytes_served_{0};  // 返回的字节数
+    std::atomic<int64_t> inflight_{0};      // 正在处理的请求数
+
     ServerOptions opts_;
+
+    std::unordered_set<std::string> peers_;                                           // 最近一次读到的集群成员
+    std::unordered_map<std::string, std::shared_ptr<pb::KCache::Stub>> peer_stubs_;  // 只包含当前成员
+    std::mutex peer_mtx_;
+    std::condition_variable peer_cv_;
+    std::thread peer_thread_;
+
+    std::unique_ptr<httplib::Server> metrics_server_;
+    std::thread metrics_thread_;
 };
 
 }  // namespace kcache
@@ -3,8 +3,12 @@
 #ifndef SINGLEFLIGHT_H_
 #define SINGLEFLIGHT_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <functional>
-#include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
@@ -12,51 +16,162 @@
 #include <unordered_map>
 
 #include "kcache/cache.h"
+#include "kcache/metrics.h"
+#include "kcache/trace.h"
 
 namespace kcache {
 
 class SingleFlight {
-    using Result = std::optional<ByteView>;
-    using Func = std::function<Result()>;
+    struct Shard;
 
 public:
-    Result Do(const std::string& key, Func func) {
-        std::unique_lock<std::mutex> glock(mtx_);
+    using Result = std::optional<ByteView>;
+    // 所有等待者共享同一份不可变结果，不需要逐个拷贝
+    using SharedResult = std::shared_ptr<const Result>;
+    using Func = std::function<Result()>;
 
-        // 检查是否有进行中的调用
-        if (map_.find(key) != map_.end()) {
-            auto existing_call = map_[key];
-            glock.unlock();  // 释放组锁，避免阻塞其他键的处理
+    // 一次进行中的调用，发起方在加载完成时调用 Complete 或 Fail（可以在其他线程）
+    class Flight {
+    public:
+        Flight(Shard* shard, std::string key) : shard_(shard), key_(std::move(key)) {}
+
+        // 所有等待者都已超时离开，尚未开始的加载可以直接放弃
+        auto Cancelled() const -> bool { return cancelled_.load(std::memory_order_acquire); }
+
+        // 结果对象本身不是 const，最后一个持有者可以把值移走而不是复制
+        void Complete(Result result) { Finish(std::make_shared<Result>(std::move(result)), nullptr); }
+
+        void Fail(std::exception_ptr error) { Finish(nullptr, error); }
+
+    private:
+        friend class SingleFlight;
+
+        void Finish(SharedResult result, std::exception_ptr error) {
+            {
+                std::lock_guard lock{mtx_};
+                if (done_) {
+                    return;
+                }
+                done_ = true;
+                result_ = std::move(result);
+                error_ = error;
+            }
+            cv_.notify_all();
+            Detach();
+        }
 
-            // 直接等待 future 的结果
-            auto result = existing_call->fut.get();
-            return result;
+        // 从分片中移除，之后的调用会发起新的加载
+        void Detach() {
+            std::lock_guard lock{shard_->mtx};
+            auto it = shard_->calls.find(key_);
+            if (it != shard_->calls.end() && it->second.get() == this) {
+                shard_->calls.erase(it);
+            }
         }
 
-        // 创建新的调用对象
-        auto new_call = std::make_shared<Call>();
-        map_[key] = new_call;
-        glock.unlock();
+        Shard* shard_;
+        std::string key_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        bool done_{false};
+        int waiters_{0};
+        SharedResult result_;
+        std::exception_ptr error_;
+        std::atomic<bool> cancelled_{false};
+    };
+
+    using FlightPtr = std::shared_ptr<Flight>;
+    // 发起一次加载，可以同步完成，也可以交给其他线程稍后完成
+    using Launch = std::function<void(const FlightPtr&)>;
+
+    // 第一个调用方在当前线程执行 func，其余调用方等待并复用结果；func 抛出的异常会传递给所有调用方
+    Result Do(const std::string& key, Func func) {
+        auto result = DoShared(key, [&func](const FlightPtr& flight) { flight->Complete(func()); });
+        return *result;
+    }
 
-        // 执行用户函数并设置 promise
-        Result val = func();
-        new_call->prom.set_value(val);
+    // 第一个调用方通过 launch 发起加载，所有调用方（包括发起方）各自最多等待 timeout（0 表示一直等待），
+    // 超时返回 nullptr；全部等待者都超时离开后，这次调用被标记为取消并移除，之后的请求会重新发起加载
+    auto DoShared(const std::string& key, const Launch& launch,
+                  std::chrono::nanoseconds timeout = std::chrono::nanoseconds::zero()) -> SharedResult {
+        auto& shard = shards_[std::hash<std::string>{}(key) % kShards];
+
+        FlightPtr flight;
+        bool is_leader = false;
+        {
+            std::lock_guard lock{shard.mtx};
+            auto [it, inserted] = shard.calls.try_emplace(key);
+            if (!inserted) {
+                std::lock_guard flight_lock{it->second->mtx_};
+                // 已取消但还没来得及移除的调用不再复用
+                if (!it->second->Cancelled()) {
+                    flight = it->second;
+                    ++flight->waiters_;
+                }
+            }
+            if (!flight) {
+                it->second = std::make_shared<Flight>(&shard, key);
+                flight = it->second;
+                flight->waiters_ = 1;
+                is_leader = true;
+            }
+        }
 
-        // 确保从映射中删除条目
-        std::lock_guard<std::mutex> lock(mtx_);
-        map_.erase(key);
+        if (is_leader) {
+            ++flights_;
+            try {
+                launch(flight);
+            } catch (...) {
+                flight->Fail(std::current_exception());
+            }
+        } else {
+            ++deduplicated_;
+        }
 
-        return val;
+        TraceSpan wait{TraceStage::kSingleFlight};
+        std::unique_lock lock{flight->mtx_};
+        auto is_done = [&flight] { return flight->done_; };
+        if (timeout.count() > 0) {
+            if (!flight->cv_.wait_for(lock, timeout, is_done)) {
+                // 最后一个等待者离开时取消这次调用
+                bool last = --flight->waiters_ == 0;
+                if (last) {
+                    flight->cancelled_.store(true, std::memory_order_release);
+                }
+                lock.unlock();
+                if (last) {
+                    flight->Detach();
+                }
+                return nullptr;
+            }
+        } else {
+            flight->cv_.wait(lock, is_done);
+        }
+        --flight->waiters_;
+
+        if (flight->error_) {
+            std::rethrow_exception(flight->error_);
+        }
+        return flight->result_;
     }
 
+    // 实际发起的调用数
+    auto Flights() const -> int64_t { return flights_.Load(); }
+    // 复用进行中调用的次数，即被合并掉的重复加载
+    auto Deduplicated() const -> int64_t { return deduplicated_.Load(); }
+
 private:
-    struct Call {
-        std::promise<Result> prom;
-        std::shared_future<Result> fut = prom.get_future().share();
+    static constexpr size_t kShards = 32;
+
+    // 按 key 分片，不同 key 的未命中不会竞争同一把锁
+    struct Shard {
+        std::mutex mtx;
+        std::unordered_map<std::string, FlightPtr> calls;
     };
 
-    std::mutex mtx_;
-    std::unordered_map<std::string, std::shared_ptr<Call>> map_;
+    std::array<Shard, kShards> shards_;
+    ShardedCounter flights_;
+    ShardedCounter deduplicated_;
 };
 
 }  // namespace kcache
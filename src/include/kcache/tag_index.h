@@ -0,0 +1,42 @@
+#ifndef TAG_INDEX_H_
+#define TAG_INDEX_H_
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace kcache {
+
+// 缓存项的标签索引：tag -> keys，用于按标签（如用户、租户）批量失效；
+// 开启前缀索引时还会维护有序的 key 集合，按前缀批量失效时不需要扫描整个缓存
+class TagIndex {
+public:
+    explicit TagIndex(bool index_prefixes = false) : index_prefixes_(index_prefixes) {}
+
+    // 记录 key 的标签，覆盖之前的标签
+    void Add(const std::string& key, const std::vector<std::string>& tags);
+
+    // key 被淘汰或删除时移除
+    void Remove(const std::string& key);
+
+    auto KeysWithTag(const std::string& tag) -> std::vector<std::string>;
+
+    // 未开启前缀索引时返回空
+    auto KeysWithPrefix(const std::string& prefix) -> std::vector<std::string>;
+
+    auto IndexesPrefixes() const -> bool { return index_prefixes_; }
+
+private:
+    bool index_prefixes_;
+    std::unordered_map<std::string, std::unordered_set<std::string>> tag_keys_;
+    std::unordered_map<std::string, std::vector<std::string>> key_tags_;
+    std::set<std::string> keys_;  // 开启前缀索引时的全部 key
+    std::mutex mtx_;
+};
+
+}  // namespace kcache
+
+#endif /* TAG_INDEX_H_ */
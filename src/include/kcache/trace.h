@@ -0,0 +1,159 @@
+// 采样的请求追踪：被采样的请求在各阶段记录起止时间，写入每个线程自己的环形缓冲区，通过管理服务按需导出
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace kcache {
+
+// 请求经过的阶段
+enum class TraceStage : uint8_t {
+    kServerGet,     // gRPC Get 处理全程
+    kGroupLookup,   // 在全局注册表中查找缓存组
+    kGroupGet,      // KCacheGroup::Get 全程
+    kCacheLock,     // 等待 LRU 锁
+    kCacheLookup,   // 持锁查找 LRU
+    kCacheInsert,   // 持锁写入 LRU
+    kSingleFlight,  // 在 SingleFlight 上等待加载结果
+    kLoad,          // getter 回源
+};
+
+auto TraceStageName(TraceStage stage) -> const char*;
+
+struct TraceEvent {
+    uint64_t trace_id;
+    TraceStage stage;
+    uint32_t thread;      // 记录该事件的线程编号
+    int64_t start_ns;     // 开始时间（NowNs）
+    int64_t duration_ns;
+};
+
+// 一次被采样请求的全部事件，按开始时间排序
+struct TraceRecord {
+    uint64_t id;
+    std::vector<TraceEvent> events;
+};
+
+// 单个线程的环形缓冲区：只有所属线程写入，导出时其他线程可以并发读取，写满后覆盖最旧的事件。
+// 每个槽位带序号，读取方前后两次读到相同的偶数序号才认为读到了完整的事件
+class TraceRing {
+public:
+    static constexpr size_t kCapacity = 4096;
+
+    explicit TraceRing(uint32_t thread) : thread_(thread) {}
+
+    void Push(uint64_t trace_id, TraceStage stage, int64_t start_ns, int64_t duration_ns);
+
+    // 把当前还在缓冲区中的完整事件追加到 out
+    void Collect(std::vector<TraceEvent>* out) const;
+
+    auto Thread() const -> uint32_t { return thread_; }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};  // 写入第 n 个事件期间为 2n+1，写完后为 2n+2
+        std::atomic<uint64_t> trace_id{0};
+        std::atomic<int64_t> start_ns{0};
+        std::atomic<int64_t> duration_ns{0};
+        std::atomic<uint8_t> stage{0};
+    };
+
+    uint32_t thread_;
+    std::atomic<uint64_t> head_{0};
+    std::array<Slot, kCapacity> slots_;
+};
+
+class Tracer {
+public:
+    // 每 n 个请求采样一个，0 表示关闭；每个线程各自计数
+    static void SetSampleEvery(uint32_t n) { sample_every_.store(n, std::memory_order_relaxed); }
+    static auto SampleEvery() -> uint32_t { return sample_every_.load(std::memory_order_relaxed); }
+
+    // 当前线程正在追踪的请求，0 表示没有
+    static auto Current() -> uint64_t { return current_; }
+
+    static void Record(uint64_t trace_id, TraceStage stage, int64_t start_ns, int64_t duration_ns);
+
+    // 导出最近的 max_traces 个请求，新的在前；0 表示全部
+    static auto Dump(size_t max_traces) -> std::vector<TraceRecord>;
+
+private:
+    friend class TraceRoot;
+
+    static inline std::atomic<uint32_t> sample_every_{0};
+    static inline thread_local uint64_t current_{0};
+    static inline thread_local uint32_t countdown_{0};
+};
+
+// 记录一个阶段的耗时，当前线程没有在追踪请求时什么也不做
+class TraceSpan {
+public:
+    explicit TraceSpan(TraceStage stage) : trace_id_(Tracer::Current()), stage_(stage) {
+        if (trace_id_ != 0) {
+            start_ = Now();
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    auto operator=(const TraceSpan&) -> TraceSpan& = delete;
+
+    ~TraceSpan() { End(); }
+
+    // 提前结束，之后再调用或析构不会重复记录
+    void End() {
+        if (trace_id_ != 0) {
+            Tracer::Record(trace_id_, stage_, start_, Now() - start_);
+            trace_id_ = 0;
+        }
+    }
+
+private:
+    static auto Now() -> int64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    uint64_t trace_id_;
+    TraceStage stage_;
+    int64_t start_{0};
+};
+
+// 请求入口：按采样率决定是否开始追踪，关闭时只多一次分支；外层已经在追踪时只记录本阶段，追踪仍归外层所有
+class TraceRoot {
+public:
+    explicit TraceRoot(TraceStage stage) : stage_(stage) {
+        auto every = Tracer::SampleEvery();
+        if (every != 0) {
+            Begin(every);
+        }
+    }
+
+    TraceRoot(const TraceRoot&) = delete;
+    auto operator=(const TraceRoot&) -> TraceRoot& = delete;
+
+    ~TraceRoot() {
+        if (trace_id_ != 0) {
+            Finish();
+        }
+    }
+
+private:
+    // 外层已在追踪时沿用外层的编号，否则每个线程每 every 个请求开始一次新的追踪
+    void Begin(uint32_t every);
+    void Finish();
+
+    TraceStage stage_;
+    uint64_t trace_id_{0};
+    bool owner_{false};
+    int64_t start_{0};
+};
+
+}  // namespace kcache
+
+#endif /* TRACE_H_ */
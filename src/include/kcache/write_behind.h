@@ -0,0 +1,84 @@
+#ifndef WRITE_BEHIND_H_
+#define WRITE_BEHIND_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "kcache/cache.h"
+
+namespace kcache {
+
+// 批量写回数据源，返回 false 表示这一批写入失败，稍后整批重试，因此写入需要是幂等的
+using BatchDataSetter = std::function<bool(const std::vector<std::pair<std::string, ByteView>>& entries)>;
+
+// 延迟写回队列：同一个 key 在写回之前的多次写入只保留最后一次，
+// 后台线程按固定间隔（或攒够一批时）把待写入的数据批量写回数据源，热点计数器的写库次数因此大幅下降
+class WriteBehindQueue {
+public:
+    // interval：写回间隔；max_batch_size：单批最多的 key 数，攒够后立即写回；
+    // max_pending：最多积压的 key 数，超过后写入方阻塞等待写回
+    WriteBehindQueue(BatchDataSetter setter, std::chrono::milliseconds interval, size_t max_batch_size,
+                     size_t max_pending);
+
+    // 写回全部积压数据后退出
+    ~WriteBehindQueue();
+
+    WriteBehindQueue(const WriteBehindQueue&) = delete;
+    auto operator=(const WriteBehindQueue&) -> WriteBehindQueue& = delete;
+
+    // 记录一次写入
+    void Put(const std::string& key, ByteView value);
+
+    // 立即写回当前积压的全部数据，等到写回完成（或这一轮写回失败）后返回
+    void Flush();
+
+    // 查询尚未写回数据源的值（包括正在写回的），回源前需要先检查，避免读到数据源中的旧值
+    auto Pending(const std::string& key) -> ByteViewOptional;
+
+    // 尚未写回的 key 数
+    auto Size() -> size_t;
+
+    // 累计写回成功的条目数，以及写回失败（之后会重试）的条目数
+    auto Written() const -> int64_t { return written_.load(); }
+    auto Failed() const -> int64_t { return failed_.load(); }
+
+private:
+    void FlushLoop();
+    // 写回一批数据，失败时把没有被更新的 key 放回队列，调用时持有 lock
+    bool FlushBatch(std::unique_lock<std::mutex>& lock);
+
+private:
+    BatchDataSetter setter_;
+    std::chrono::milliseconds interval_;
+    size_t max_batch_size_;
+    size_t max_pending_;
+
+    bool is_stop_{false};
+    bool flush_requested_{false};  // Flush 等待写回线程写完当前积压的数据
+    std::chrono::steady_clock::time_point retry_after_;  // 写回失败后，在此之前积压再多也不写回
+    std::unordered_map<std::string, ByteView> pending_;   // 等待写回的最新值
+    std::deque<std::string> order_;                       // 等待写回的 key，按首次写入顺序，每个 key 只出现一次
+    std::unordered_map<std::string, ByteView> flushing_;  // 正在写回的值
+    std::mutex mtx_;
+    std::condition_variable cv_;        // 唤醒写回线程
+    std::condition_variable space_cv_;  // 积压减少时唤醒写入方
+    std::condition_variable flush_cv_;  // 一轮写回结束时唤醒 Flush
+
+    std::atomic<int64_t> written_{0};
+    std::atomic<int64_t> failed_{0};
+    std::thread flusher_;
+};
+
+}  // namespace kcache
+
+#endif /* WRITE_BEHIND_H_ */
@@ -0,0 +1,52 @@
+#include "kcache/log.h"
+
+#include <memory>
+
+#include <spdlog/async.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+namespace kcache {
+
+// 异步日志的队列长度和后台线程数
+constexpr size_t kAsyncLogQueueSize = 8192;
+constexpr size_t kAsyncLogThreads = 1;
+
+auto LogRateLimiter::Allow(int64_t* suppressed) -> bool {
+    auto second = NowNs() / 1000000000;
+    auto window = window_.load(std::memory_order_relaxed);
+    if (window != second && window_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+        count_.store(0, std::memory_order_relaxed);
+    }
+    if (count_.fetch_add(1, std::memory_order_relaxed) >= per_second_) {
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+void InitLogging(const std::string& name, const std::string& level, bool async) {
+    std::shared_ptr<spdlog::logger> logger;
+    if (async) {
+        spdlog::init_thread_pool(kAsyncLogQueueSize, kAsyncLogThreads);
+        logger = spdlog::create_async_nb<spdlog::sinks::stdout_color_sink_mt>(name);
+    } else {
+        logger = spdlog::stdout_color_mt(name);
+    }
+    spdlog::set_default_logger(logger);
+
+    auto lvl = spdlog::level::from_str(level);
+    if (lvl == spdlog::level::off && level != "off") {
+        spdlog::warn("Unknown log level [{}], use info", level);
+        lvl = spdlog::level::info;
+    }
+    spdlog::set_level(lvl);
+    // 出错时立即刷出，进程异常退出时不丢关键日志
+    spdlog::flush_on(spdlog::level::err);
+    if (lvl < SPDLOG_ACTIVE_LEVEL) {
+        spdlog::warn("Log level [{}] is below the compile-time level, hot-path logs below [{}] are compiled out",
+                     level, spdlog::level::to_string_view(static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL)));
+    }
+}
+
+}  // namespace kcache
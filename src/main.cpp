@@ -1,3 +1,4 @@
+#include <atomic>
 #include <chrono>
 #include <csignal>
 #include <exception>
@@ -12,9 +13,13 @@
 #include <gflags/gflags_declare.h>
 #include <spdlog/spdlog.h>
 
+#include "kcache/access_trace.h"
 #include "kcache/cache.h"
 #include "kcache/group.h"
+#include "kcache/log.h"
+#include "kcache/memory_budget.h"
 #include "kcache/server.h"
+#include "kcache/trace.h"
 
 using namespace kcache;
 
@@ -22,21 +27,54 @@ DEFINE_int32(port, 8001, "节点端口");
 DEFINE_string(node, "A", "节点标识符");
 DEFINE_string(group, "default", "缓存组名称");
 DEFINE_string(log_level, "info", "日志级别， 可选值：trace, debug, info, warn, error, critical");
+DEFINE_bool(async_log, true, "由后台线程写日志，请求线程不等待输出");
 DEFINE_string(etcd_endpoints, "http://127.0.0.1:2379", "etcd地址");
+DEFINE_int32(max_concurrent_loads, 0, "缓存组最大并发回源数，0 表示在请求线程上直接回源");
+DEFINE_int32(load_timeout_ms, 0, "回源超时时间（毫秒），0 表示不超时，需要同时设置 max_concurrent_loads");
+DEFINE_int32(ttl_ms, 0, "缓存有效期（毫秒），0 表示永不过期");
+DEFINE_int32(refresh_ahead_ms, 0, "距离过期不足该时间时后台提前刷新（毫秒），0 表示关闭");
+DEFINE_int32(stale_grace_ms, 0, "回源失败时可返回过期数据的宽限时间（毫秒），0 表示关闭");
+DEFINE_int32(negative_ttl_ms, 0, "不存在的 key 的缓存时间（毫秒），0 表示不缓存");
+DEFINE_int32(lease_ttl_ms, 0, "租约有效期（毫秒），0 表示关闭租约");
+DEFINE_int32(lease_retry_ms, 20, "未拿到租约时建议客户端重试的间隔（毫秒）");
+DEFINE_int32(metrics_port, 0, "Prometheus 指标的 HTTP 端口，0 表示关闭");
+DEFINE_int32(hot_keys, 0, "热点探测跟踪的 key 数，0 表示关闭");
+DEFINE_double(hot_key_ratio, 0.01, "访问占比不低于该值的 key 为热点");
+DEFINE_int32(mrc_samples, 0, "缺失率曲线估计跟踪的 key 数，0 表示关闭");
+DEFINE_string(eviction_policy, "lru", "淘汰策略，可选值：lru, gdsf（按加载耗时、访问次数和大小淘汰）");
+DEFINE_int32(memory_budget_mb, 0, "所有缓存组共享的内存预算（MB），按边际收益在缓存组之间调整容量，0 表示各自固定容量");
+DEFINE_string(access_trace, "", "访问轨迹的输出文件，供 cache_sim 离线回放，为空表示关闭");
+DEFINE_double(access_trace_rate, 0.01, "访问轨迹按 key 采样的比例");
+DEFINE_uint32(trace_sample, 0, "每个线程每 n 个请求追踪一个，0 表示关闭，可通过管理服务动态调整");
 
 // 模拟数据库
 std::unordered_map<std::string, std::string> db = {
     {"Tom", "400"},     {"Kerolt", "370"}, {"Jack", "296"}, {"Alice", "320"}, {"Bob", "280"},
     {"Charlie", "410"}, {"Diana", "390"},  {"Eve", "310"},  {"abcde", "789"}, {"hello", "879"}};
 
-std::function<void(int)> handler_wrapper;
-void HandleCtrlC(int signum) { handler_wrapper(signum); }
+// 信号处理函数中只能做异步信号安全的操作，这里只设置标志，由主线程负责关闭服务
+std::atomic<bool> stop_requested{false};
+void HandleCtrlC(int) { stop_requested.store(true); }
 
 int main(int argc, char** argv) {
     gflags::ParseCommandLineFlags(&argc, &argv, true);
 
-    spdlog::set_level(spdlog::level::debug);
+    InitLogging("knode", FLAGS_log_level, FLAGS_async_log);
     spdlog::set_pattern("[knode][%^%l%$] %v");
+    Tracer::SetSampleEvery(FLAGS_trace_sample);
+    CachePolicy policy;
+    if (!ParseCachePolicy(FLAGS_eviction_policy, &policy)) {
+        spdlog::error("[node{}] unsupported eviction policy: {}", FLAGS_node, FLAGS_eviction_policy);
+        spdlog::shutdown();
+        return 1;
+    }
+
+    // 回源超时只在等待加载时生效，在请求线程上直接回源时发起方无法放弃，必须配合加载线程池使用
+    if (FLAGS_load_timeout_ms > 0 && FLAGS_max_concurrent_loads <= 0) {
+        spdlog::error("[node{}] --load_timeout_ms requires --max_concurrent_loads > 0", FLAGS_node);
+        spdlog::shutdown();
+        return 1;
+    }
 
     std::string addr = "localhost:" + std::to_string(FLAGS_port);
     std::string service_name = "kcache";
@@ -46,6 +84,7 @@ int main(int argc, char** argv) {
         // 创建节点，同时注册到etcd
         ServerOptions opts;
         opts.etcd_endpoints = {FLAGS_etcd_endpoints};
+        opts.metrics_port = FLAGS_metrics_port;
         auto node = std::make_unique<KCacheServer>(addr, service_name, opts);
         spdlog::info("[node{}] server created successfully", FLAGS_node);
 
@@ -61,41 +100,79 @@ int main(int argc, char** argv) {
         }};
 
         // 注册 Ctrl+C 信号处理器用来优雅关闭服务
-        handler_wrapper = [&](int signal) {
-            if (signal == SIGINT) {
-                spdlog::info("[node{}] received Ctrl+C signal, shutting down service...", FLAGS_node);
-                if (node) {
-                    node->Stop();
-                }
-                spdlog::info("[node{}] service stopped", FLAGS_node);
-                // 不直接 exit，而是要等其他工作线程完成清理工作
-            }
-        };
         signal(SIGINT, HandleCtrlC);
 
         std::this_thread::sleep_for(std::chrono::seconds(5));  // 等待服务器启动
 
         // 创建缓存组
-        auto& group = MakeCacheGroup(FLAGS_group, 2 << 20, [&](const std::string& key) -> ByteViewOptional {
-            if (db.find(key) != db.end()) {
-                spdlog::info(">_< search [{}] from db\n", key);
-                return ByteView{db[key]};
+        GroupOptions group_opts;
+        WithLoaderPool(FLAGS_max_concurrent_loads, 1024)(&group_opts);
+        WithLoadTimeout(std::chrono::milliseconds(FLAGS_load_timeout_ms))(&group_opts);
+        WithTTL(std::chrono::milliseconds(FLAGS_ttl_ms))(&group_opts);
+        WithRefreshAhead(std::chrono::milliseconds(FLAGS_refresh_ahead_ms))(&group_opts);
+        WithStaleGrace(std::chrono::milliseconds(FLAGS_stale_grace_ms))(&group_opts);
+        WithNegativeCache(std::chrono::milliseconds(FLAGS_negative_ttl_ms), 64 << 10)(&group_opts);
+        WithLease(std::chrono::milliseconds(FLAGS_lease_ttl_ms), std::chrono::milliseconds(FLAGS_lease_retry_ms),
+                  std::chrono::seconds(10))(&group_opts);
+        WithHotKeyDetection(FLAGS_hot_keys, FLAGS_hot_key_ratio, std::chrono::seconds(1))(&group_opts);
+        WithMissRatioCurve(FLAGS_mrc_samples)(&group_opts);
+        WithEvictionPolicy(policy)(&group_opts);
+        std::shared_ptr<AccessTraceWriter> access_trace;
+        if (!FLAGS_access_trace.empty()) {
+            access_trace = std::make_shared<AccessTraceWriter>(FLAGS_access_trace, FLAGS_access_trace_rate);
+            if (!access_trace->IsOpen()) {
+                spdlog::error("[node{}] failed to open access trace file {}", FLAGS_node, FLAGS_access_trace);
+                access_trace.reset();
             }
-            spdlog::info(">_< Uh oh, there is not found [{}]\n", key);
-            return std::nullopt;
-        });
+            WithAccessTrace(access_trace)(&group_opts);
+        }
+        auto& group = MakeCacheGroup(
+            FLAGS_group, 2 << 20,
+            [&](const std::string& key) -> ByteViewOptional {
+                if (db.find(key) != db.end()) {
+                    spdlog::info(">_< search [{}] from db\n", key);
+                    return ByteView{db[key]};
+                }
+                spdlog::info(">_< Uh oh, there is not found [{}]\n", key);
+                return std::nullopt;
+            },
+            group_opts);
+
+        // 开启内存预算时缓存组的容量由预算统一调整，每秒最多移动预算的 1/64，每个缓存组至少保留 1/16
+        std::unique_ptr<MemoryBudget> budget;
+        if (FLAGS_memory_budget_mb > 0) {
+            int64_t total = int64_t{FLAGS_memory_budget_mb} << 20;
+            budget = std::make_unique<MemoryBudget>(total, total / 64, std::chrono::seconds(1));
+            budget->Attach(&group, total / 16);
+        }
+
+        // 从其他节点拉取现在归属于本节点的数据
+        node->WarmUp();
 
         spdlog::info("[node{}] service running, press Ctrl+C to exit...", FLAGS_node);
 
+        // 在主线程上关闭服务：下线前的数据交接会阻塞较长时间，不能放在信号处理函数中
+        while (!stop_requested.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        spdlog::info("[node{}] received Ctrl+C signal, shutting down service...", FLAGS_node);
+        node->Stop();
+        spdlog::info("[node{}] service stopped", FLAGS_node);
+
         // 等待服务器线程
         if (server_thread.joinable()) {
             server_thread.join();
         }
+        if (access_trace) {
+            access_trace->Flush();
+        }
 
     } catch (const std::exception& e) {
         spdlog::error("[node{}] exception occurred: {}", FLAGS_node, e.what());
+        spdlog::shutdown();
         std::exit(1);
     }
 
+    spdlog::shutdown();  // 刷出异步队列中剩余的日志
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "kcache/access_trace.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "kcache/cache.h"
+
+namespace kcache {
+
+namespace {
+
+void PutVarint(std::string* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+}  // namespace
+
+AccessTraceWriter::AccessTraceWriter(const std::string& path, double sample_rate, size_t buffer_bytes)
+    : threshold_(static_cast<uint64_t>(std::clamp(sample_rate, 0.0, 1.0) * kAccessTraceModulus)),
+      buffer_bytes_(buffer_bytes),
+      start_ns_(NowNs()),
+      out_(path, std::ios::binary | std::ios::trunc) {
+    is_open_ = out_.is_open();
+    buffer_.append(kAccessTraceMagic, sizeof(kAccessTraceMagic));
+    buffer_.push_back(static_cast<char>(kAccessTraceVersion));
+    PutVarint(&buffer_, threshold_);
+}
+
+AccessTraceWriter::~AccessTraceWriter() { Flush(); }
+
+void AccessTraceWriter::Record(AccessOp op, const std::string& key, int64_t bytes, int64_t cost_ns) {
+    // 与缺失率曲线相同，取哈希的高位作为采样值
+    if ((std::hash<std::string>{}(key) >> 40) >= threshold_ || !is_open_) {
+        return;
+    }
+    auto now_us = (NowNs() - start_ns_) / 1000;
+    std::lock_guard lock{mtx_};
+    // 并发记录时拿到锁的顺序可能与取时间的顺序不同，时间差不能为负
+    auto delta = std::max<int64_t>(now_us - last_us_, 0);
+    last_us_ += delta;
+    buffer_.push_back(static_cast<char>(op));
+    PutVarint(&buffer_, delta);
+    PutVarint(&buffer_, std::max<int64_t>(bytes, 0));
+    PutVarint(&buffer_, std::max<int64_t>(cost_ns / 1000, 0));
+    PutVarint(&buffer_, key.size());
+    buffer_.append(key);
+    records_.fetch_add(1, std::memory_order_relaxed);
+    if (buffer_.size() >= buffer_bytes_) {
+        FlushLocked();
+    }
+}
+
+void AccessTraceWriter::Flush() {
+    std::lock_guard lock{mtx_};
+    FlushLocked();
+    out_.flush();
+}
+
+void AccessTraceWriter::FlushLocked() {
+    if (is_open_ && !buffer_.empty()) {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    }
+    buffer_.clear();
+}
+
+AccessTraceReader::AccessTraceReader(const std::string& path) : in_(path, std::ios::binary) {
+    char magic[sizeof(kAccessTraceMagic)];
+    if (!in_.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kAccessTraceMagic)) {
+        return;
+    }
+    char version = 0;
+    if (!in_.get(version) || version < 1 || static_cast<uint8_t>(version) > kAccessTraceVersion) {
+        return;
+    }
+    version_ = static_cast<uint8_t>(version);
+    is_valid_ = ReadVarint(&threshold_);
+}
+
+bool AccessTraceReader::Next(AccessRecord* record) {
+    char op = 0;
+    if (!is_valid_ || !in_.get(op)) {
+        return false;
+    }
+    uint64_t delta = 0;
+    uint64_t bytes = 0;
+    uint64_t cost_us = 0;
+    uint64_t key_len = 0;
+    if (static_cast<uint8_t>(op) > static_cast<uint8_t>(AccessOp::kGetMiss) || !ReadVarint(&delta) ||
+        !ReadVarint(&bytes) || (version_ >= 2 && !ReadVarint(&cost_us)) || !ReadVarint(&key_len)) {
+        return false;
+    }
+    record->key.resize(key_len);
+    if (!in_.read(record->key.data(), static_cast<std::streamsize>(key_len))) {
+        return false;
+    }
+    timestamp_us_ += static_cast<int64_t>(delta);
+    record->timestamp_us = timestamp_us_;
+    record->op = static_cast<AccessOp>(op);
+    record->bytes = static_cast<int64_t>(bytes);
+    record->cost_us = static_cast<int64_t>(cost_us);
+    return true;
+}
+
+auto AccessTraceReader::ReadVarint(uint64_t* value) -> bool {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        char byte = 0;
+        if (!in_.get(byte)) {
+            return false;
+        }
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace kcache
@@ -0,0 +1,155 @@
+#include "kcache/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+
+namespace kcache {
+
+auto MetricShard() -> size_t {
+    static std::atomic<size_t> next_shard{0};
+    thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+auto ShardedCounter::Load() const -> int64_t {
+    int64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+LatencyHistogram::LatencyHistogram() : shards_(std::make_unique<Shard[]>(kMetricShards)) {}
+
+auto LatencyHistogram::Snapshot() const -> HistogramSnapshot {
+    HistogramSnapshot snapshot;
+    snapshot.counts.assign(kBuckets, 0);
+    for (size_t s = 0; s < kMetricShards; ++s) {
+        const auto& shard = shards_[s];
+        for (size_t i = 0; i < kBuckets; ++i) {
+            snapshot.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (auto count : snapshot.counts) {
+        snapshot.count += count;
+    }
+    return snapshot;
+}
+
+auto LatencyHistogram::BucketUpperBound(size_t index) -> int64_t {
+    if (index < kLinearBuckets) {
+        return static_cast<int64_t>(index);
+    }
+    auto offset = index - kLinearBuckets;
+    int msb = static_cast<int>(offset >> kSubBucketBits) + kSubBucketBits + 1;
+    auto sub = offset & ((size_t{1} << kSubBucketBits) - 1);
+    auto width = int64_t{1} << (msb - kSubBucketBits);
+    auto lower = static_cast<int64_t>((size_t{1} << kSubBucketBits) + sub) << (msb - kSubBucketBits);
+    return lower + width - 1;
+}
+
+auto HistogramSnapshot::Percentile(double p) const -> int64_t {
+    if (count == 0) {
+        return 0;
+    }
+    auto rank = static_cast<int64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * static_cast<double>(count)));
+    rank = std::max<int64_t>(rank, 1);
+    int64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return LatencyHistogram::BucketUpperBound(i);
+        }
+    }
+    return LatencyHistogram::BucketUpperBound(counts.size() - 1);
+}
+
+auto HistogramSnapshot::Summary() const -> LatencySummary {
+    LatencySummary summary;
+    summary.count = count;
+    summary.p50 = Percentile(0.5);
+    summary.p99 = Percentile(0.99);
+    summary.p999 = Percentile(0.999);
+    summary.max = Percentile(1.0);
+    return summary;
+}
+
+auto PrometheusWriter::Label(const std::string& key, const std::string& value) -> std::string {
+    std::string label = key + "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            label += '\\';
+            label += c;
+        } else if (c == '\n') {
+            label += "\\n";
+        } else {
+            label += c;
+        }
+    }
+    label += '"';
+    return label;
+}
+
+void PrometheusWriter::Counter(const std::string& name, const std::string& help, const std::string& labels,
+                               double value) {
+    AppendSample(&GetFamily(name, help, "counter").samples, name, labels, value);
+}
+
+void PrometheusWriter::Gauge(const std::string& name, const std::string& help, const std::string& labels,
+                             double value) {
+    AppendSample(&GetFamily(name, help, "gauge").samples, name, labels, value);
+}
+
+void PrometheusWriter::Histogram(const std::string& name, const std::string& help, const std::string& labels,
+                                 const HistogramSnapshot& snapshot) {
+    auto& samples = GetFamily(name, help, "histogram").samples;
+    auto sep = labels.empty() ? "" : ",";
+    // 桶在 2 的幂处对齐，小于 2^k 的值恰好是 BucketIndex(2^k) 之前所有桶的和
+    int64_t cumulative = 0;
+    size_t next = 0;
+    for (int bits = 10; bits <= 34; bits += 2) {
+        auto end = LatencyHistogram::BucketIndex(int64_t{1} << bits);
+        for (; next < end && next < snapshot.counts.size(); ++next) {
+            cumulative += snapshot.counts[next];
+        }
+        auto le = fmt::format("le=\"{}\"", static_cast<double>(int64_t{1} << bits) / 1e9);
+        AppendSample(&samples, name + "_bucket", labels + sep + le, static_cast<double>(cumulative));
+    }
+    AppendSample(&samples, name + "_bucket", labels + sep + "le=\"+Inf\"", static_cast<double>(snapshot.count));
+    AppendSample(&samples, name + "_sum", labels, static_cast<double>(snapshot.sum) / 1e9);
+    AppendSample(&samples, name + "_count", labels, static_cast<double>(snapshot.count));
+}
+
+auto PrometheusWriter::Render() const -> std::string {
+    std::string out;
+    for (const auto& family : families_) {
+        out += fmt::format("# HELP {} {}\n# TYPE {} {}\n", family.name, family.help, family.name, family.type);
+        out += family.samples;
+    }
+    return out;
+}
+
+auto PrometheusWriter::GetFamily(const std::string& name, const std::string& help, const std::string& type)
+    -> Family& {
+    for (auto& family : families_) {
+        if (family.name == name) {
+            return family;
+        }
+    }
+    families_.push_back(Family{name, help, type, ""});
+    return families_.back();
+}
+
+void PrometheusWriter::AppendSample(std::string* out, const std::string& name, const std::string& labels,
+                                    double value) {
+    if (labels.empty()) {
+        *out += fmt::format("{} {}\n", name, value);
+    } else {
+        *out += fmt::format("{}{{{}}} {}\n", name, labels, value);
+    }
+}
+
+}  // namespace kcache
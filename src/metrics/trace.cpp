@@ -0,0 +1,159 @@
+#include "kcache/trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "kcache/cache.h"
+
+namespace kcache {
+
+namespace {
+
+std::atomic<uint64_t> next_trace_id{1};
+
+// 所有线程的环形缓冲区；线程退出后缓冲区留给新线程复用，导出时仍能看到退出线程留下的事件
+std::mutex rings_mtx;
+std::vector<std::shared_ptr<TraceRing>> rings;
+std::vector<std::shared_ptr<TraceRing>> free_rings;
+
+struct LocalRing {
+    std::shared_ptr<TraceRing> ring;
+
+    ~LocalRing() {
+        if (ring) {
+            std::lock_guard lock{rings_mtx};
+            free_rings.push_back(std::move(ring));
+        }
+    }
+};
+
+// 当前线程的缓冲区，第一次记录事件时才分配
+auto Ring() -> TraceRing& {
+    thread_local LocalRing local;
+    if (!local.ring) {
+        std::lock_guard lock{rings_mtx};
+        if (!free_rings.empty()) {
+            local.ring = std::move(free_rings.back());
+            free_rings.pop_back();
+        } else {
+            local.ring = std::make_shared<TraceRing>(static_cast<uint32_t>(rings.size()));
+            rings.push_back(local.ring);
+        }
+    }
+    return *local.ring;
+}
+
+}  // namespace
+
+auto TraceStageName(TraceStage stage) -> const char* {
+    switch (stage) {
+        case TraceStage::kServerGet:
+            return "server_get";
+        case TraceStage::kGroupLookup:
+            return "group_lookup";
+        case TraceStage::kGroupGet:
+            return "group_get";
+        case TraceStage::kCacheLock:
+            return "cache_lock";
+        case TraceStage::kCacheLookup:
+            return "cache_lookup";
+        case TraceStage::kCacheInsert:
+            return "cache_insert";
+        case TraceStage::kSingleFlight:
+            return "singleflight";
+        case TraceStage::kLoad:
+            return "load";
+    }
+    return "unknown";
+}
+
+void TraceRing::Push(uint64_t trace_id, TraceStage stage, int64_t start_ns, int64_t duration_ns) {
+    auto pos = head_.load(std::memory_order_relaxed);
+    auto& slot = slots_[pos % kCapacity];
+    slot.seq.store(2 * pos + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.trace_id.store(trace_id, std::memory_order_relaxed);
+    slot.start_ns.store(start_ns, std::memory_order_relaxed);
+    slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    slot.stage.store(static_cast<uint8_t>(stage), std::memory_order_relaxed);
+    slot.seq.store(2 * pos + 2, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_release);
+}
+
+void TraceRing::Collect(std::vector<TraceEvent>* out) const {
+    auto head = head_.load(std::memory_order_acquire);
+    auto begin = head > kCapacity ? head - kCapacity : 0;
+    for (auto pos = begin; pos < head; ++pos) {
+        const auto& slot = slots_[pos % kCapacity];
+        auto seq = slot.seq.load(std::memory_order_acquire);
+        if (seq != 2 * pos + 2) {
+            continue;  // 正在被覆盖或已经被更新的事件覆盖
+        }
+        TraceEvent event{slot.trace_id.load(std::memory_order_relaxed),
+                         static_cast<TraceStage>(slot.stage.load(std::memory_order_relaxed)), thread_,
+                         slot.start_ns.load(std::memory_order_relaxed),
+                         slot.duration_ns.load(std::memory_order_relaxed)};
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) != seq) {
+            continue;
+        }
+        out->push_back(event);
+    }
+}
+
+void Tracer::Record(uint64_t trace_id, TraceStage stage, int64_t start_ns, int64_t duration_ns) {
+    Ring().Push(trace_id, stage, start_ns, duration_ns);
+}
+
+auto Tracer::Dump(size_t max_traces) -> std::vector<TraceRecord> {
+    std::vector<std::shared_ptr<TraceRing>> snapshot;
+    {
+        std::lock_guard lock{rings_mtx};
+        snapshot = rings;
+    }
+    std::vector<TraceEvent> events;
+    for (const auto& ring : snapshot) {
+        ring->Collect(&events);
+    }
+
+    std::unordered_map<uint64_t, std::vector<TraceEvent>> by_trace;
+    for (const auto& event : events) {
+        by_trace[event.trace_id].push_back(event);
+    }
+    std::vector<TraceRecord> traces;
+    traces.reserve(by_trace.size());
+    for (auto& [id, trace_events] : by_trace) {
+        std::sort(trace_events.begin(), trace_events.end(),
+                  [](const TraceEvent& a, const TraceEvent& b) { return a.start_ns < b.start_ns; });
+        traces.push_back(TraceRecord{id, std::move(trace_events)});
+    }
+    std::sort(traces.begin(), traces.end(), [](const TraceRecord& a, const TraceRecord& b) { return a.id > b.id; });
+    if (max_traces != 0 && traces.size() > max_traces) {
+        traces.resize(max_traces);
+    }
+    return traces;
+}
+
+void TraceRoot::Begin(uint32_t every) {
+    if (Tracer::current_ == 0) {
+        if (++Tracer::countdown_ < every) {
+            return;
+        }
+        Tracer::countdown_ = 0;
+        Tracer::current_ = next_trace_id.fetch_add(1, std::memory_order_relaxed);
+        owner_ = true;
+    }
+    trace_id_ = Tracer::current_;
+    start_ = NowNs();
+}
+
+void TraceRoot::Finish() {
+    Tracer::Record(trace_id_, stage_, start_, NowNs() - start_);
+    if (owner_) {
+        Tracer::current_ = 0;
+    }
+}
+
+}  // namespace kcache
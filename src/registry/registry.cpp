@@ -24,6 +24,7 @@ bool EtcdRegistry::Register(const std::string& svc_name, std::string addr) {
         addr = local_ip + addr;
     }
     key_ = "/services/" + svc_name + "/" + addr;
+    addr_ = addr;
 
     // 创建租约
     auto lease_resp = etcd_client_->leasegrant(10).get();
@@ -62,6 +63,22 @@ void EtcdRegistry::Unregister() {
     spdlog::info("Service unregistered: {}", key_);
 }
 
+auto EtcdRegistry::ListServices(const std::string& svc_name) -> std::vector<std::string> {
+    std::string prefix = "/services/" + svc_name + "/";
+    auto resp = etcd_client_->ls(prefix).get();
+    if (!resp.is_ok()) {
+        spdlog::error("Failed to list services from etcd: {}", resp.error_message());
+        return {};
+    }
+    std::vector<std::string> addrs;
+    for (const auto& key : resp.keys()) {
+        if (key.rfind(prefix, 0) == 0) {
+            addrs.push_back(key.substr(prefix.length()));
+        }
+    }
+    return addrs;
+}
+
 auto EtcdRegistry::GetLocalIP() -> std::string {
     struct ifaddrs* ifaddr;
     if (getifaddrs(&ifaddr) == -1) {
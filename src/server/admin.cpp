@@ -0,0 +1,216 @@
+#include "kcache/admin.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "kcache/consistent_hash.h"
+#include "kcache/group.h"
+#include "kcache/memory_budget.h"
+#include "kcache/trace.h"
+
+namespace kcache {
+
+namespace {
+
+void FillLatency(const LatencySummary& summary, pb::LatencySummary* out) {
+    out->set_count(summary.count);
+    out->set_p50_ns(summary.p50);
+    out->set_p99_ns(summary.p99);
+    out->set_p999_ns(summary.p999);
+    out->set_max_ns(summary.max);
+}
+
+void FillCounters(const GroupStats& stats, google::protobuf::Map<std::string, int64_t>* counters) {
+    (*counters)["loads"] = stats.loads;
+    (*counters)["local_hits"] = stats.local_hits;
+    (*counters)["local_misses"] = stats.local_misses;
+    (*counters)["l0_hits"] = stats.l0_hits;
+    (*counters)["peer_hits"] = stats.peer_hits;
+    (*counters)["peer_misses"] = stats.peer_misses;
+    (*counters)["loader_hits"] = stats.loader_hits;
+    (*counters)["loader_errors"] = stats.loader_errors;
+    (*counters)["load_duration_ns"] = stats.load_duration;
+    (*counters)["refreshes"] = stats.refreshes;
+    (*counters)["stale_hits"] = stats.stale_hits;
+    (*counters)["negative_hits"] = stats.negative_hits;
+    (*counters)["lease_grants"] = stats.lease_grants;
+    (*counters)["lease_waits"] = stats.lease_waits;
+    (*counters)["write_errors"] = stats.write_errors;
+    (*counters)["write_behind_written"] = stats.write_behind_written;
+    (*counters)["write_behind_failed"] = stats.write_behind_failed;
+    (*counters)["write_behind_pending"] = stats.write_behind_pending;
+    (*counters)["evictions"] = stats.evictions;
+    (*counters)["singleflight_flights"] = stats.flights;
+    (*counters)["singleflight_deduplicated"] = stats.deduplicated;
+    (*counters)["ghost_hits"] = stats.ghost_hits;
+}
+
+}  // namespace
+
+auto KCacheAdmin::Describe(grpc::ServerContext* context, const pb::AdminGroupRequest* request,
+                           pb::DescribeResponse* response) -> grpc::Status {
+    GroupReadGuard guard;
+    std::vector<KCacheGroup*> groups;
+    if (request->group().empty()) {
+        groups = GetCacheGroups();
+    } else if (auto group = GetCacheGroup(request->group())) {
+        groups.push_back(group);
+    } else {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+
+    for (auto* group : groups) {
+        auto* info = response->add_groups();
+        auto stats = group->Stats();
+        info->set_name(group->Name());
+        FillCounters(stats, info->mutable_counters());
+        for (const auto& occupancy : group->Occupancy()) {
+            auto* tier = info->add_tiers();
+            tier->set_name(occupancy.tier);
+            tier->set_bytes(occupancy.bytes);
+            tier->set_max_bytes(occupancy.max_bytes);
+            tier->set_entries(occupancy.entries);
+            tier->set_evictions(occupancy.evictions);
+        }
+        auto& latency = *info->mutable_latency();
+        FillLatency(stats.hit_latency, &latency["hit"]);
+        FillLatency(stats.miss_latency, &latency["miss"]);
+        FillLatency(stats.load_latency, &latency["load"]);
+        FillLatency(stats.peer_latency, &latency["peer"]);
+        for (const auto& [key, value] : group->Config()) {
+            (*info->mutable_config())[key] = value;
+        }
+        info->set_eviction_rate(EvictionRate(group->Name(), stats.evictions));
+        for (const auto& point : group->HitRatioCurve()) {
+            auto* out = info->add_hit_ratio_curve();
+            out->set_cache_bytes(point.cache_bytes);
+            out->set_hit_ratio(point.hit_ratio);
+        }
+    }
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::TopKeys(grpc::ServerContext* context, const pb::TopKeysRequest* request,
+                          pb::TopKeysResponse* response) -> grpc::Status {
+    GroupReadGuard guard;
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    auto k = request->k() > 0 ? static_cast<size_t>(request->k()) : 10;
+    for (const auto& hot : group->TopKeys(k)) {
+        auto* key = response->add_keys();
+        key->set_key(hot.key);
+        key->set_count(hot.count);
+        key->set_error(hot.error);
+    }
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::Ring(grpc::ServerContext* context, const pb::RingRequest* request, pb::RingResponse* response)
+    -> grpc::Status {
+    if (!registry_) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Registry not available");
+    }
+    auto members = registry_->ListServices(svc_name_);
+    response->set_self(registry_->Addr());
+
+    HashConfig cfg = kDefaultConfig;
+    cfg.auto_rebalance = false;
+    ConsistentHashMap ring{cfg};
+    ring.Add(members);
+    auto replicas = ring.GetReplicas();
+
+    std::sort(members.begin(), members.end());
+    for (const auto& member : members) {
+        auto* node = response->add_nodes();
+        node->set_addr(member);
+        node->set_vnodes(replicas[member]);
+    }
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::SetMaxBytes(grpc::ServerContext* context, const pb::SetMaxBytesRequest* request,
+                              pb::SetMaxBytesResponse* response) -> grpc::Status {
+    GroupReadGuard guard;
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    // 容量 0 表示不限，误传 0 会让缓存无限增长，必须显式指定 unlimited
+    if (!request->unlimited() && request->max_bytes() <= 0) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "max_bytes must be positive, or set unlimited");
+    }
+    auto max_bytes = request->unlimited() ? 0 : request->max_bytes();
+    // 加入内存预算的缓存组由预算统一分配容量，直接修改会让各缓存组的容量之和超出预算
+    if (auto* budget = group->Budget()) {
+        auto evicted = max_bytes > 0 ? budget->Resize(group, max_bytes) : std::nullopt;
+        if (!evicted) {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION,
+                                "max_bytes is out of the range allowed by the memory budget");
+        }
+        response->set_evicted(*evicted);
+    } else {
+        response->set_evicted(group->SetMaxBytes(max_bytes));
+    }
+    response->set_max_bytes(max_bytes);
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::SetPolicy(grpc::ServerContext* context, const pb::SetPolicyRequest* request,
+                            pb::SetPolicyResponse* response) -> grpc::Status {
+    GroupReadGuard guard;
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    if (!group->SetEvictionPolicy(request->policy())) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Unsupported eviction policy: " + request->policy());
+    }
+    spdlog::info("Eviction policy of group [{}] is set to {}", request->group(), request->policy());
+    response->set_policy(group->EvictionPolicy());
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::SetTracing(grpc::ServerContext* context, const pb::SetTracingRequest* request,
+                             pb::SetTracingResponse* response) -> grpc::Status {
+    Tracer::SetSampleEvery(request->sample_every());
+    spdlog::info("Request tracing is set to sample 1 of every {} requests", request->sample_every());
+    response->set_sample_every(Tracer::SampleEvery());
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::DumpTraces(grpc::ServerContext* context, const pb::DumpTracesRequest* request,
+                             pb::DumpTracesResponse* response) -> grpc::Status {
+    auto limit = request->limit() > 0 ? static_cast<size_t>(request->limit()) : 0;
+    for (const auto& record : Tracer::Dump(limit)) {
+        auto* trace = response->add_traces();
+        trace->set_id(record.id);
+        auto begin = record.events.front().start_ns;
+        for (const auto& event : record.events) {
+            auto* span = trace->add_spans();
+            span->set_stage(TraceStageName(event.stage));
+            span->set_thread(event.thread);
+            span->set_offset_ns(event.start_ns - begin);
+            span->set_duration_ns(event.duration_ns);
+        }
+    }
+    return grpc::Status::OK;
+}
+
+auto KCacheAdmin::EvictionRate(const std::string& group, int64_t evictions) -> double {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard lock{mtx_};
+    auto [it, inserted] = eviction_samples_.try_emplace(group, EvictionSample{evictions, now});
+    if (inserted) {
+        return 0;
+    }
+    auto elapsed = std::chrono::duration<double>(now - it->second.at).count();
+    double rate = elapsed > 0 ? static_cast<double>(evictions - it->second.evictions) / elapsed : 0;
+    it->second = EvictionSample{evictions, now};
+    return rate;
+}
+
+}  // namespace kcache
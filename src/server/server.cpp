@@ -4,15 +4,115 @@
 #include <grpcpp/health_check_service_interface.h>
 #include <grpcpp/security/server_credentials.h>
 #include <grpcpp/server_builder.h>
+#include <httplib.h>
 #include <spdlog/spdlog.h>
 
+#include <time.h>
+
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <unordered_map>
 
 #include "kcache.pb.h"
+#include "kcache/consistent_hash.h"
 #include "kcache/group.h"
+#include "kcache/metrics.h"
+#include "kcache/trace.h"
 
 namespace kcache {
 
+namespace {
+
+// 热点副本从 owner 拉取数据的超时时间
+constexpr auto kReplicaFetchTimeout = std::chrono::milliseconds(500);
+// 从 etcd 刷新集群成员的间隔，新加入的节点最多这么久之后才能作为热点副本的 owner
+constexpr auto kPeerRefreshInterval = std::chrono::seconds(5);
+
+// 按批次申请配额的限速器，避免数据迁移打满网络和对端 CPU
+class RateLimiter {
+public:
+    explicit RateLimiter(int rate) : rate_(rate), next_(std::chrono::steady_clock::now()) {}
+
+    void Acquire(int n) {
+        if (rate_ <= 0) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (next_ < now) {
+            next_ = now;
+        }
+        std::this_thread::sleep_until(next_);
+        next_ += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(static_cast<double>(n) / rate_));
+    }
+
+private:
+    int rate_;
+    std::chrono::steady_clock::time_point next_;
+};
+
+// 用于计算 key 归属的哈希环，不需要后台负载均衡
+auto MakeRing(const std::vector<std::string>& members) -> std::unique_ptr<ConsistentHashMap> {
+    HashConfig cfg = kDefaultConfig;
+    cfg.auto_rebalance = false;
+    auto ring = std::make_unique<ConsistentHashMap>(cfg);
+    ring->Add(members);
+    return ring;
+}
+
+// 请求带了缓存组编号时按编号直接取；编号由本节点分配，名称对不上说明客户端拿到的编号已过时，退回按名称查找
+auto ResolveGroup(const pb::Request& request) -> KCacheGroup* {
+    if (request.group_id() != 0) {
+        auto* group = GetCacheGroup(request.group_id());
+        if (group && group->Name() == request.group()) {
+            return group;
+        }
+    }
+    return GetCacheGroup(request.group());
+}
+
+// 墙上时钟的当前时间（Unix 毫秒），迁移数据的过期时间按它在节点间传递
+auto WallMs() -> int64_t {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+// 把缓存项加入迁移批次，过期时间换算为墙上时钟；缓存项已被淘汰或已过期时返回 false
+auto AddTransferEntry(pb::TransferBatch* batch, KCacheGroup* group, const std::string& key) -> bool {
+    auto cached = group->PeekEntry(key);
+    if (!cached) {
+        return false;
+    }
+    auto entry = batch->add_entries();
+    entry->set_group(group->Name());
+    entry->set_key(key);
+    entry->set_value(cached->value_.ToString());
+    if (cached->expire_at_ != 0) {
+        auto remaining_ms = (cached->expire_at_ - NowNs()) / 1'000'000;
+        entry->set_expire_at_ms(WallMs() + std::max<int64_t>(remaining_ms, 1));
+    }
+    return true;
+}
+
+// 写入迁移来的数据，返回写入的条目数；传输途中过期的数据由 Warm 丢弃
+auto WarmEntries(const pb::TransferBatch& batch) -> int64_t {
+    GroupReadGuard guard;
+    int64_t accepted = 0;
+    auto now_ms = WallMs();
+    auto now_ns = NowNs();
+    for (const auto& entry : batch.entries()) {
+        auto expire_at = entry.expire_at_ms() != 0 ? now_ns + (entry.expire_at_ms() - now_ms) * 1'000'000 : 0;
+        auto group = GetCacheGroup(entry.group());
+        if (group && group->Warm(entry.key(), entry.value(), expire_at)) {
+            ++accepted;
+        }
+    }
+    return accepted;
+}
+
+}  // namespace
+
 KCacheServer::KCacheServer(const std::string& addr, const std::string& svc_name, ServerOptions opts)
     : addr_(addr), svc_name_(svc_name), opts_(opts) {
     // 创建etcd注册器
@@ -20,36 +120,100 @@ KCacheServer::KCacheServer(const std::string& addr, const std::string& svc_name,
     if (!etcd_register_->Register(svc_name_, addr_)) {
         throw std::runtime_error("[kcache] Failed to register service with etcd");
     }
+    admin_ = std::make_unique<KCacheAdmin>(etcd_register_.get(), svc_name_);
+}
+
+KCacheServer::~KCacheServer() {
+    {
+        std::lock_guard lock{peer_mtx_};
+        is_stop_ = true;
+    }
+    peer_cv_.notify_all();
+    if (peer_thread_.joinable()) {
+        peer_thread_.join();
+    }
+    if (metrics_server_) {
+        metrics_server_->stop();
+    }
+    if (metrics_thread_.joinable()) {
+        metrics_thread_.join();
+    }
 }
 
 auto KCacheServer::Get(grpc::ServerContext* context, const pb::Request* request, pb::GetResponse* response)
     -> grpc::Status {
-    auto group = GetCacheGroup(request->group());
+    RequestScope scope{this};
+    TraceRoot trace{TraceStage::kServerGet};
+    TraceSpan lookup{TraceStage::kGroupLookup};
+    auto group = ResolveGroup(*request);
+    lookup.End();
     if (!group) {
         return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
     }
-    auto value = group->Get(request->key());
+    if (!request->owner().empty() && request->owner() != addr_) {
+        // 客户端分散过来的热点读请求，作为副本服务，未命中时从 owner 拉取而不是回源；
+        // owner 由请求方指定，只接受集群成员，客户端收到错误后直接访问 owner
+        auto owner = PeerStub(request->owner());
+        if (!owner) {
+            return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Owner is not a cluster member");
+        }
+        auto value = group->GetReplica(request->key(), [&owner, request](const std::string& key) -> ByteViewOptional {
+            pb::Request fetch;
+            fetch.set_group(request->group());
+            fetch.set_key(key);
+            pb::GetResponse resp;
+            grpc::ClientContext ctx;
+            ctx.set_deadline(std::chrono::system_clock::now() + kReplicaFetchTimeout);
+            auto status = owner->Get(&ctx, fetch, &resp);
+            if (!status.ok()) {
+                if (status.error_code() != grpc::StatusCode::NOT_FOUND) {
+                    spdlog::warn("Failed to fetch key [{}] from owner {}: {}", key, request->owner(),
+                                 status.error_message());
+                }
+                return std::nullopt;
+            }
+            return ByteView{resp.value()};
+        });
+        if (!value) {
+            return grpc::Status(grpc::StatusCode::NOT_FOUND, "Key not found");
+        }
+        response->set_value(value->ToString());
+        response->set_hot(group->IsHotKey(request->key()));
+        response->set_group_id(group->Id());
+        bytes_served_ += value->Len();
+        return grpc::Status::OK;
+    }
+
+    auto value = group->GetVersioned(request->key());
     if (!value) {
         return grpc::Status(grpc::StatusCode::NOT_FOUND, "Key not found");
     }
-    response->set_value(value->ToString());
+    const auto& data = value->value->data_;
+    response->set_value(data.data(), data.size());
+    response->set_version(value->version);
+    response->set_hot(group->IsHotKey(request->key()));
+    response->set_group_id(group->Id());
+    bytes_served_ += value->value->Len();
     return grpc::Status::OK;
 }
 
 auto KCacheServer::Set(grpc::ServerContext* context, const pb::Request* request, pb::SetResponse* response)
     -> grpc::Status {
-    auto group = GetCacheGroup(request->group());
+    RequestScope scope{this};
+    auto group = ResolveGroup(*request);
     if (!group) {
         return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
     }
-    bool is_set = group->Set(request->key(), request->value());
+    std::vector<std::string> tags(request->tags().begin(), request->tags().end());
+    bool is_set = group->Set(request->key(), request->value(), tags);
     response->set_value(is_set);
     return grpc::Status::OK;
 }
 
 auto KCacheServer::Delete(grpc::ServerContext* context, const pb::Request* request, pb::DeleteResponse* response)
     -> grpc::Status {
-    auto group = GetCacheGroup(request->group());
+    RequestScope scope{this};
+    auto group = ResolveGroup(*request);
     if (!group) {
         return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
     }
@@ -60,7 +224,8 @@ auto KCacheServer::Delete(grpc::ServerContext* context, const pb::Request* reque
 
 auto KCacheServer::Invalidate(grpc::ServerContext* context, const pb::Request* request,
                               pb::InvalidateResponse* response) -> grpc::Status {
-    auto group = GetCacheGroup(request->group());
+    RequestScope scope{this};
+    auto group = ResolveGroup(*request);
     if (!group) {
         return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
     }
@@ -70,6 +235,337 @@ auto KCacheServer::Invalidate(grpc::ServerContext* context, const pb::Request* r
     return grpc::Status::OK;
 }
 
+auto KCacheServer::Lease(grpc::ServerContext* context, const pb::Request* request, pb::LeaseResponse* response)
+    -> grpc::Status {
+    RequestScope scope{this};
+    auto group = ResolveGroup(*request);
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    auto result = group->GetOrLease(request->key());
+    if (!result.value && result.token == 0 && result.retry_after.count() == 0) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Key not found");
+    }
+    if (result.value) {
+        response->set_value(result.value->ToString());
+        bytes_served_ += result.value->Len();
+    }
+    response->set_hit(result.hit);
+    response->set_stale(result.stale);
+    response->set_token(result.token);
+    response->set_retry_after_ms(result.retry_after.count());
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Fill(grpc::ServerContext* context, const pb::FillRequest* request, pb::FillResponse* response)
+    -> grpc::Status {
+    RequestScope scope{this};
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    ByteViewOptional value;
+    if (!request->absent()) {
+        value = ByteView{request->value()};
+    }
+    response->set_value(group->Fill(request->key(), value, request->token()));
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::BatchInvalidate(grpc::ServerContext* context, const pb::BatchInvalidateRequest* request,
+                                   pb::BatchInvalidateResponse* response) -> grpc::Status {
+    RequestScope scope{this};
+    int64_t invalidated = 0;
+    for (const auto& entry : request->entries()) {
+        auto group = GetCacheGroup(entry.group());
+        if (group && group->InvalidateFromPeer(entry.key())) {
+            ++invalidated;
+        }
+    }
+    response->set_invalidated(invalidated);
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::InvalidateTag(grpc::ServerContext* context, const pb::InvalidateTagRequest* request,
+                                 pb::BulkInvalidateResponse* response) -> grpc::Status {
+    RequestScope scope{this};
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    response->set_invalidated(group->InvalidateTag(request->tag()));
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::InvalidatePrefix(grpc::ServerContext* context, const pb::InvalidatePrefixRequest* request,
+                                    pb::BulkInvalidateResponse* response) -> grpc::Status {
+    RequestScope scope{this};
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    response->set_invalidated(group->InvalidatePrefix(request->prefix()));
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Flush(grpc::ServerContext* context, const pb::FlushRequest* request, pb::FlushResponse* response)
+    -> grpc::Status {
+    RequestScope scope{this};
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    response->set_generation(group->Flush());
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::CompareAndSet(grpc::ServerContext* context, const pb::CasRequest* request,
+                                 pb::CasResponse* response) -> grpc::Status {
+    RequestScope scope{this};
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    auto result = group->CompareAndSet(request->key(), request->value(), request->expected_version());
+    response->set_ok(result.ok);
+    response->set_version(result.version);
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Incr(grpc::ServerContext* context, const pb::IncrRequest* request, pb::IncrResponse* response)
+    -> grpc::Status {
+    RequestScope scope{this};
+    auto group = GetCacheGroup(request->group());
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    auto result = group->Incr(request->key(), request->delta());
+    if (!result) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Value is not an integer or overflows");
+    }
+    response->set_value(result->first);
+    response->set_version(result->second);
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Append(grpc::ServerContext* context, const pb::Request* request, pb::AppendResponse* response)
+    -> grpc::Status {
+    RequestScope scope{this};
+    auto group = ResolveGroup(*request);
+    if (!group) {
+        return grpc::Status(grpc::StatusCode::NOT_FOUND, "Group not found");
+    }
+    auto version = group->Append(request->key(), request->value());
+    if (version == 0) {
+        return grpc::Status(grpc::StatusCode::FAILED_PRECONDITION, "Failed to append");
+    }
+    response->set_version(version);
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Stats(grpc::ServerContext* context, const pb::StatsRequest* request,
+                         pb::StatsResponse* response) -> grpc::Status {
+    int64_t loads = 0;
+    int64_t load_duration = 0;
+    GroupReadGuard guard;
+    for (auto* group : GetCacheGroups()) {
+        auto stats = group->Stats();
+        loads += stats.loads;
+        load_duration += stats.load_duration;
+    }
+
+    // 进程 CPU 时间同时反映了请求量、value 大小和回源开销，是比请求数更真实的负载
+    struct timespec ts {};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    response->set_requests(requests_.load());
+    response->set_bytes_served(bytes_served_.load());
+    response->set_cpu_time_ns(static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec);
+    response->set_loads(loads);
+    response->set_load_duration_ns(load_duration);
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Pull(grpc::ServerContext* context, const pb::PullRequest* request,
+                        grpc::ServerWriter<pb::TransferBatch>* writer) -> grpc::Status {
+    std::vector<std::string> members{request->members().begin(), request->members().end()};
+    if (request->requester().empty() || members.empty()) {
+        return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "Requester and members are required");
+    }
+
+    auto ring = MakeRing(members);
+    RateLimiter limiter{opts_.handoff_rate};
+    pb::TransferBatch batch;
+    int64_t sent = 0;
+
+    auto flush = [&]() -> bool {
+        if (batch.entries_size() == 0) {
+            return true;
+        }
+        limiter.Acquire(batch.entries_size());
+        sent += batch.entries_size();
+        bool ok = writer->Write(batch);
+        batch.Clear();
+        return ok;
+    };
+
+    // 只在最热的 limit 个 key 中挑选，避免在缓存锁内复制全部 key
+    auto limit = static_cast<size_t>(opts_.handoff_max_entries);
+    if (request->limit() > 0 && (limit == 0 || static_cast<size_t>(request->limit()) < limit)) {
+        limit = static_cast<size_t>(request->limit());
+    }
+    GroupReadGuard guard;
+    for (auto* group : GetCacheGroups()) {
+        for (const auto& key : group->HotKeys(limit)) {
+            if (context->IsCancelled()) {
+                return grpc::Status(grpc::StatusCode::CANCELLED, "Pull cancelled");
+            }
+            if (ring->Get(key) != request->requester()) {
+                continue;
+            }
+            if (!AddTransferEntry(&batch, group, key)) {
+                continue;  // 遍历期间已被淘汰或已过期
+            }
+            if (batch.entries_size() >= opts_.handoff_batch_size && !flush()) {
+                return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Failed to write transfer batch");
+            }
+        }
+    }
+    if (!flush()) {
+        return grpc::Status(grpc::StatusCode::UNAVAILABLE, "Failed to write transfer batch");
+    }
+
+    spdlog::info("Handed off {} entries to joining node {}", sent, request->requester());
+    return grpc::Status::OK;
+}
+
+auto KCacheServer::Push(grpc::ServerContext* context, grpc::ServerReader<pb::TransferBatch>* reader,
+                        pb::PushResponse* response) -> grpc::Status {
+    pb::TransferBatch batch;
+    int64_t accepted = 0;
+    while (reader->Read(&batch)) {
+        accepted += WarmEntries(batch);
+    }
+    response->set_accepted(accepted);
+    spdlog::info("Accepted {} entries from draining node", accepted);
+    return grpc::Status::OK;
+}
+
+void KCacheServer::WarmUp() {
+    if (!etcd_register_) {
+        return;
+    }
+    const auto& self = etcd_register_->Addr();
+    auto members = RefreshPeers();
+
+    pb::PullRequest request;
+    request.set_requester(self);
+    request.set_limit(opts_.handoff_max_entries);
+    for (const auto& member : members) {
+        request.add_members(member);
+    }
+
+    int64_t total = 0;
+    for (const auto& peer : members) {
+        if (peer == self) {
+            continue;
+        }
+        auto stub = PeerStub(peer);
+        if (!stub) {
+            continue;
+        }
+        grpc::ClientContext ctx;
+        ctx.set_deadline(std::chrono::system_clock::now() + opts_.handoff_timeout);
+
+        auto reader = stub->Pull(&ctx, request);
+        pb::TransferBatch batch;
+        while (reader->Read(&batch)) {
+            total += WarmEntries(batch);
+        }
+        auto status = reader->Finish();
+        if (!status.ok()) {
+            spdlog::warn("Failed to pull entries from {}: {}", peer, status.error_message());
+        }
+    }
+    spdlog::info("Warm up finished, pulled {} entries from {} peers", total, members.size() - 1);
+}
+
+void KCacheServer::Drain() {
+    if (!etcd_register_) {
+        return;
+    }
+    const auto& self = etcd_register_->Addr();
+    auto members = RefreshPeers();
+    members.erase(std::remove(members.begin(), members.end(), self), members.end());
+    if (members.empty()) {
+        return;
+    }
+
+    // 每个后继节点一条推送流
+    struct PushStream {
+        std::shared_ptr<pb::KCache::Stub> stub;
+        grpc::ClientContext ctx;
+        pb::PushResponse response;
+        std::unique_ptr<grpc::ClientWriter<pb::TransferBatch>> writer;
+        pb::TransferBatch batch;
+        bool ok = true;
+    };
+    std::unordered_map<std::string, std::unique_ptr<PushStream>> streams;
+    RateLimiter limiter{opts_.handoff_rate};
+
+    auto flush = [&](PushStream& stream) {
+        if (!stream.ok || stream.batch.entries_size() == 0) {
+            return;
+        }
+        limiter.Acquire(stream.batch.entries_size());
+        stream.ok = stream.writer->Write(stream.batch);
+        stream.batch.Clear();
+    };
+
+    auto ring = MakeRing(members);
+    GroupReadGuard guard;
+    for (auto* group : GetCacheGroups()) {
+        // 只推送最热的部分数据，冷数据交给后继节点按需回源
+        for (const auto& key : group->HotKeys(opts_.handoff_max_entries)) {
+            auto owner = ring->Get(key);
+            auto it = streams.find(owner);
+            if (it == streams.end()) {
+                // 拿到 stub 之后才建立推送流，不在集群中的节点不会留下空的流
+                auto stub = PeerStub(owner);
+                if (!stub) {
+                    continue;
+                }
+                auto stream = std::make_unique<PushStream>();
+                stream->stub = std::move(stub);
+                stream->ctx.set_deadline(std::chrono::system_clock::now() + opts_.handoff_timeout);
+                stream->writer = stream->stub->Push(&stream->ctx, &stream->response);
+                it = streams.emplace(owner, std::move(stream)).first;
+            }
+            auto& stream = it->second;
+            if (!AddTransferEntry(&stream->batch, group, key)) {
+                continue;
+            }
+            if (stream->batch.entries_size() >= opts_.handoff_batch_size) {
+                flush(*stream);
+            }
+        }
+    }
+
+    for (auto& [peer, stream] : streams) {
+        if (!stream || !stream->writer) {
+            continue;
+        }
+        flush(*stream);
+        stream->writer->WritesDone();
+        auto status = stream->writer->Finish();
+        if (status.ok()) {
+            spdlog::info("Pushed {} entries to successor {}", stream->response.accepted(), peer);
+        } else {
+            spdlog::warn("Failed to push entries to {}: {}", peer, status.error_message());
+        }
+    }
+}
+
 // 启动 gRPC 服务器
 void KCacheServer::Start() {
     try {
@@ -98,6 +594,7 @@ void KCacheServer::Start() {
 
         // 注册服务
         builder.RegisterService(this);
+        builder.RegisterService(admin_.get());
 
         // 构建并启动服务器
         grpc_server_ = builder.BuildAndStart();
@@ -112,9 +609,14 @@ void KCacheServer::Start() {
         }
 
         is_stop_ = false;
+        peer_thread_ = std::thread{[this] { PeerRefreshLoop(); }};
 
         spdlog::info("gRPC Server start success at {}!", addr_);
 
+        if (opts_.metrics_port > 0) {
+            StartMetricsServer();
+        }
+
         grpc_server_->Wait();
 
     } catch (const std::exception& e) {
@@ -125,15 +627,29 @@ void KCacheServer::Start() {
 
 // 关闭 gRPC 服务器
 void KCacheServer::Stop() {
-    is_stop_ = true;
+    {
+        std::lock_guard lock{peer_mtx_};
+        is_stop_ = true;
+    }
+    peer_cv_.notify_all();
+    // 刷新线程会访问注册器和成员列表，先等它退出，Drain 期间成员列表不会被并发修改
+    if (peer_thread_.joinable()) {
+        peer_thread_.join();
+    }
+    // 注销之前先把热点数据交给后继节点，减少下线带来的回源压力
+    Drain();
     if (etcd_register_) {
         etcd_register_->Unregister();
-        etcd_register_.reset();
     }
     if (grpc_server_) {
         grpc_server_->Shutdown();
         grpc_server_.reset();
     }
+    // 管理服务会访问注册器，gRPC 服务停止之后才能释放
+    etcd_register_.reset();
+    if (metrics_server_) {
+        metrics_server_->stop();
+    }
     spdlog::info("gRPC Server {} stopped.", addr_);
 }
 
@@ -143,4 +659,70 @@ auto KCacheServer::LoadTLSCredentials(const std::string& cert_file, const std::s
     return grpc::SslServerCredentials(grpc::SslServerCredentialsOptions{});
 }
 
+auto KCacheServer::PeerStub(const std::string& addr) -> std::shared_ptr<pb::KCache::Stub> {
+    std::lock_guard lock{peer_mtx_};
+    if (peers_.count(addr) == 0) {
+        return nullptr;
+    }
+    auto& stub = peer_stubs_[addr];
+    if (!stub) {
+        stub = pb::KCache::NewStub(grpc::CreateChannel(addr, grpc::InsecureChannelCredentials()));
+    }
+    return stub;
+}
+
+auto KCacheServer::RefreshPeers() -> std::vector<std::string> {
+    if (!etcd_register_) {
+        return {};
+    }
+    auto members = etcd_register_->ListServices(svc_name_);
+    std::lock_guard lock{peer_mtx_};
+    // 读不到任何成员（包括本节点）说明 etcd 暂时不可用，沿用之前的视图
+    if (members.empty()) {
+        return {peers_.begin(), peers_.end()};
+    }
+    const auto& self = etcd_register_->Addr();
+    if (std::find(members.begin(), members.end(), self) == members.end()) {
+        members.push_back(self);
+    }
+    peers_ = {members.begin(), members.end()};
+    for (auto it = peer_stubs_.begin(); it != peer_stubs_.end();) {
+        it = peers_.count(it->first) ? std::next(it) : peer_stubs_.erase(it);
+    }
+    return members;
+}
+
+void KCacheServer::PeerRefreshLoop() {
+    std::unique_lock lock{peer_mtx_};
+    do {
+        lock.unlock();
+        RefreshPeers();
+        lock.lock();
+    } while (!peer_cv_.wait_for(lock, kPeerRefreshInterval, [this] { return is_stop_.load(); }));
+}
+
+auto KCacheServer::RenderMetrics() -> std::string {
+    PrometheusWriter writer;
+    WriteGroupMetrics(&writer);
+    auto labels = PrometheusWriter::Label("addr", addr_);
+    writer.Counter("kcache_rpc_requests_total", "gRPC requests handled", labels, requests_.load());
+    writer.Gauge("kcache_rpc_inflight", "gRPC requests being handled", labels, inflight_.load());
+    writer.Counter("kcache_rpc_sent_bytes_total", "Value bytes returned to callers", labels, bytes_served_.load());
+    return writer.Render();
+}
+
+void KCacheServer::StartMetricsServer() {
+    metrics_server_ = std::make_unique<httplib::Server>();
+    metrics_server_->Get("/metrics", [this](const httplib::Request&, httplib::Response& res) {
+        res.set_content(RenderMetrics(), "text/plain; version=0.0.4");
+    });
+    // 先同步绑定端口，之后的 stop 一定能让监听线程退出
+    if (!metrics_server_->bind_to_port("0.0.0.0", opts_.metrics_port)) {
+        spdlog::error("Failed to bind metrics endpoint on port {}", opts_.metrics_port);
+        return;
+    }
+    spdlog::info("Metrics endpoint listening on port {}", opts_.metrics_port);
+    metrics_thread_ = std::thread{[this] { metrics_server_->listen_after_bind(); }};
+}
+
 }  // namespace kcache
\ No newline at end of file
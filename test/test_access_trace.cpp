@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "kcache/access_trace.h"
+#include "kcache/group.h"
+
+using namespace kcache;
+
+// 全量采样时读回的记录与写入的一致，时间戳单调不减
+TEST(AccessTraceTest, RoundTrip) {
+    auto path = testing::TempDir() + "access_trace_round_trip.bin";
+    {
+        AccessTraceWriter writer{path, 1.0, 64};
+        ASSERT_TRUE(writer.IsOpen());
+        for (int i = 0; i < 100; ++i) {
+            writer.Record(AccessOp::kGet, "key" + std::to_string(i), i * 1000, i * 1000);
+        }
+        writer.Record(AccessOp::kSet, "key1", 12);
+        writer.Record(AccessOp::kDelete, "key2", 0);
+        EXPECT_EQ(writer.Records(), 102);
+    }
+
+    AccessTraceReader reader{path};
+    ASSERT_TRUE(reader.IsValid());
+    EXPECT_EQ(reader.SampleRate(), 1.0);
+    std::vector<AccessRecord> records;
+    AccessRecord record;
+    while (reader.Next(&record)) {
+        records.push_back(record);
+    }
+    ASSERT_EQ(records.size(), 102);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_EQ(records[i].op, AccessOp::kGet);
+        EXPECT_EQ(records[i].key, "key" + std::to_string(i));
+        EXPECT_EQ(records[i].bytes, i * 1000);
+        EXPECT_EQ(records[i].cost_us, i);
+        if (i > 0) {
+            EXPECT_GE(records[i].timestamp_us, records[i - 1].timestamp_us);
+        }
+    }
+    EXPECT_EQ(records[100].op, AccessOp::kSet);
+    EXPECT_EQ(records[100].bytes, 12);
+    EXPECT_EQ(records[101].op, AccessOp::kDelete);
+    EXPECT_EQ(records[101].key, "key2");
+
+    EXPECT_FALSE(AccessTraceReader{testing::TempDir() + "access_trace_missing.bin"}.IsValid());
+}
+
+// 按 key 采样：被采样的 key 的每次访问都被记录，缓存组的读写删都会写入轨迹
+TEST(AccessTraceTest, GroupRecordsSampledKeys) {
+    auto path = testing::TempDir() + "access_trace_group.bin";
+    auto writer = std::make_shared<AccessTraceWriter>(path, 0.5);
+    GroupOptions opts;
+    WithAccessTrace(writer)(&opts);
+    auto& group = MakeCacheGroup(
+        "access_trace", 1 << 20,
+        [](const std::string& key) -> ByteViewOptional {
+            if (key.rfind("missing", 0) == 0) return std::nullopt;
+            return ByteView{"v" + key};
+        },
+        opts);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 1000; ++i) {
+            group.Get("key" + std::to_string(i));
+        }
+    }
+    for (int i = 0; i < 1000; ++i) {
+        group.Get("missing" + std::to_string(i));
+    }
+    group.Set("key0", ByteView{"value"});
+    group.Delete("key0");
+    writer->Flush();
+
+    AccessTraceReader reader{path};
+    ASSERT_TRUE(reader.IsValid());
+    EXPECT_EQ(reader.SampleRate(), 0.5);
+    std::map<std::string, int> gets;
+    int misses = 0;
+    AccessRecord record;
+    while (reader.Next(&record)) {
+        if (record.op == AccessOp::kGet) {
+            EXPECT_EQ(record.bytes, static_cast<int64_t>(record.key.size() * 2 + 1));
+            ++gets[record.key];
+        } else if (record.op == AccessOp::kGetMiss) {
+            // 没有拿到数据的读取同样被记录
+            EXPECT_EQ(record.key.rfind("missing", 0), 0);
+            EXPECT_EQ(record.bytes, 0);
+            ++misses;
+        }
+    }
+    EXPECT_GT(gets.size(), 400);
+    EXPECT_LT(gets.size(), 600);
+    EXPECT_GT(misses, 400);
+    EXPECT_LT(misses, 600);
+    for (const auto& [key, count] : gets) {
+        EXPECT_EQ(count, 3) << key;
+    }
+}
@@ -357,3 +357,40 @@ TEST_F(ConsistentHashTest, DestructorTest) {
     // If we reach here without hanging, destructor worked correctly
     SUCCEED();
 }
+
+// 节点上报的负载驱动再平衡，且每轮变动的虚拟节点数受 max_move_ratio 限制
+TEST_F(ConsistentHashTest, ReportedLoadsDriveRebalance) {
+    HashConfig config = test_config_;
+    config.replicas = 10;
+    config.max_replicas = 50;
+    config.max_move_ratio = 0.1;  // 20 个虚拟节点，每轮最多变动 2 个
+    ConsistentHashMap hash_map(config);
+    EXPECT_TRUE(hash_map.Add({"node1", "node2"}));
+
+    // 本实例没有路由过任何请求，但集群上报 node1 的负载是 node2 的 3 倍
+    hash_map.UpdateLoads({{"node1", 3.0}, {"node2", 1.0}, {"unknown", 10.0}});
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    auto replicas = hash_map.GetReplicas();
+    ASSERT_EQ(replicas.size(), 2);
+    int moved = std::abs(replicas["node1"] - 10) + std::abs(replicas["node2"] - 10);
+    EXPECT_GT(moved, 0);
+    EXPECT_LE(moved, 2);
+    EXPECT_LE(replicas["node1"], 10);
+    EXPECT_GE(replicas["node2"], 10);
+}
+
+// 部分节点没有上报负载时，不使用上报值
+TEST_F(ConsistentHashTest, PartialReportedLoadsAreIgnored) {
+    ConsistentHashMap hash_map(test_config_);
+    EXPECT_TRUE(hash_map.Add({"node1", "node2"}));
+
+    hash_map.UpdateLoads({{"node1", 100.0}});
+    // 退化为按本实例的请求数时同样要求足够的样本，一次请求造成的不均衡不会触发调整
+    hash_map.Get("key");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    auto replicas = hash_map.GetReplicas();
+    EXPECT_EQ(replicas["node1"], test_config_.replicas);
+    EXPECT_EQ(replicas["node2"], test_config_.replicas);
+}
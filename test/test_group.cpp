@@ -1,9 +1,15 @@
 // SPDX-License-Identifier: MIT
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -140,32 +146,21 @@ TEST_F(CacheGroupTest, SingleFlightAvoidsDuplicateLoads) {
     EXPECT_EQ(call_count_["key1"], 1);
 }
 
-// 移动构造后，已缓存的值仍可直接命中，不重复回源
-TEST_F(CacheGroupTest, MoveConstructorPreservesCache) {
-    KCacheGroup g1("group_move_ctor", 1024, getter_);
-    ASSERT_TRUE(g1.Get("key1").has_value());
+// 缓存组不能移动，通过 std::unique_ptr 转移所有权后缓存仍可直接命中，不重复回源
+TEST_F(CacheGroupTest, OwnershipTransferPreservesCache) {
+    static_assert(!std::is_move_constructible_v<KCacheGroup>);
+    static_assert(!std::is_move_assignable_v<KCacheGroup>);
 
-    KCacheGroup g2(std::move(g1));
-    auto r = g2.Get("key1");
+    auto g1 = std::make_unique<KCacheGroup>("group_move", 1024, getter_);
+    ASSERT_TRUE(g1->Get("key1").has_value());
+
+    auto g2 = std::move(g1);
+    auto r = g2->Get("key1");
     ASSERT_TRUE(r.has_value());
     EXPECT_EQ(r->ToString(), "value1");
     EXPECT_EQ(call_count_["key1"], 1);  // 未再次回源
 }
 
-// 移动赋值后亦保持缓存命中
-TEST_F(CacheGroupTest, MoveAssignmentPreservesCache) {
-    KCacheGroup g1("group_move_assign_src", 1024, getter_);
-    KCacheGroup g2("group_move_assign_dst", 1024, getter_);
-    ASSERT_TRUE(g1.Get("key2").has_value());
-
-    g2 = std::move(g1);
-
-    auto r = g2.Get("key2");
-    ASSERT_TRUE(r.has_value());
-    EXPECT_EQ(r->ToString(), "value2");
-    EXPECT_EQ(call_count_["key2"], 1);
-}
-
 TEST_F(CacheGroupTest, BatchGetAcrossKeys) {
     KCacheGroup group("group_batch", 1024, getter_);
     for (const auto& kv : db_) {
@@ -179,6 +174,779 @@ TEST_F(CacheGroupTest, BatchGetAcrossKeys) {
     }
 }
 
+// 迁移来的数据不覆盖本地已有的 key，并且可以直接命中
+TEST_F(CacheGroupTest, WarmDoesNotOverwrite) {
+    KCacheGroup group("group_warm", 1024, getter_);
+    EXPECT_TRUE(group.Set("key1", ByteView{"local"}));
+
+    EXPECT_FALSE(group.Warm("key1", ByteView{"remote"}, 0));
+    EXPECT_TRUE(group.Warm("key2", ByteView{"remote"}, 0));
+
+    EXPECT_EQ(group.Get("key1")->ToString(), "local");
+    EXPECT_EQ(group.Get("key2")->ToString(), "remote");
+    EXPECT_EQ(call_count_["key2"], 0);
+    EXPECT_EQ(group.HotKeys(1), std::vector<std::string>{"key2"});
+}
+
+// 迁移来的数据保留原来的过期时间，已过期的数据不写入
+TEST_F(CacheGroupTest, WarmKeepsDeadline) {
+    GroupOptions opts;
+    WithTTL(std::chrono::hours(1))(&opts);
+    KCacheGroup group("group_warm_ttl", 1024, getter_, opts);
+    auto expire_at = NowNs() + 50'000'000;
+    EXPECT_TRUE(group.Warm("key1", ByteView{"remote"}, expire_at));
+    EXPECT_FALSE(group.Warm("key2", ByteView{"remote"}, NowNs() - 1));
+    EXPECT_FALSE(group.Peek("key2"));
+
+    auto entry = group.PeekEntry("key1");
+    ASSERT_TRUE(entry);
+    EXPECT_EQ(entry->expire_at_, expire_at);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_FALSE(group.PeekEntry("key1"));
+    EXPECT_EQ(group.Get("key1")->ToString(), "value1");
+    EXPECT_EQ(call_count_["key1"], 1);
+}
+
+// 异步 getter 在其他线程回调，结果写入缓存
+TEST_F(CacheGroupTest, AsyncGetterLoadsAndCaches) {
+    std::atomic<int> calls{0};
+    GroupOptions opts;
+    WithAsyncGetter([&](const std::string& key, LoadCallback cb) {
+        ++calls;
+        std::thread{[key, cb] { cb(key == "async" ? ByteViewOptional{ByteView{"value"}} : std::nullopt); }}.detach();
+    })(&opts);
+    KCacheGroup group("group_async", 1024, nullptr, opts);
+
+    auto r = group.Get("async");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->ToString(), "value");
+    EXPECT_TRUE(group.Get("async").has_value());
+    EXPECT_FALSE(group.Get("missing").has_value());
+    EXPECT_EQ(calls.load(), 2);
+}
+
+// 加载超时后所有等待者返回，慢加载完成前不会一直阻塞
+TEST_F(CacheGroupTest, LoadTimeoutReleasesWaiters) {
+    DataGetter slow_getter = [](const std::string&) -> ByteViewOptional {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        return ByteView{"slow"};
+    };
+    GroupOptions opts;
+    WithLoaderPool(2, 16)(&opts);
+    WithLoadTimeout(std::chrono::milliseconds(50))(&opts);
+    KCacheGroup group("group_timeout", 1024, slow_getter, opts);
+
+    const int N = 4;
+    std::vector<std::thread> ths;
+    std::atomic<int> failed{0};
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < N; ++i) {
+        ths.emplace_back([&] {
+            if (!group.Get("key1").has_value()) ++failed;
+        });
+    }
+    for (auto& t : ths) t.join();
+    auto cost = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(failed.load(), N);
+    EXPECT_LT(cost, std::chrono::milliseconds(250));
+    // 每个等待者各自超时
+    EXPECT_EQ(group.Stats().loader_errors, N);
+}
+
+// 异步 getter 超过并发上限时直接失败，不排队
+TEST_F(CacheGroupTest, ConcurrentLoadLimit) {
+    std::mutex mu;
+    std::vector<LoadCallback> pending;
+    GroupOptions opts;
+    WithAsyncGetter([&](const std::string&, LoadCallback cb) {
+        std::lock_guard lock{mu};
+        pending.push_back(cb);
+    })(&opts);
+    WithLoaderPool(1, 0)(&opts);
+    WithLoadTimeout(std::chrono::milliseconds(20))(&opts);
+    KCacheGroup group("group_limit", 1024, nullptr, opts);
+
+    // 第一次加载超时但仍在进行中，占住唯一的并发名额
+    EXPECT_FALSE(group.Get("a").has_value());
+    EXPECT_FALSE(group.Get("b").has_value());
+    {
+        std::lock_guard lock{mu};
+        EXPECT_EQ(pending.size(), 1);
+        pending[0](ByteView{"late"});
+    }
+    EXPECT_FALSE(group.Get("b").has_value());  // 名额已释放，再次发起加载
+    std::lock_guard lock{mu};
+    EXPECT_EQ(pending.size(), 2);
+    pending[1](std::nullopt);
+}
+
+// 异步 getter 一直不回调时析构最多等待 load_timeout，之后到达的回调被丢弃
+TEST_F(CacheGroupTest, DestroyDoesNotWaitForLostAsyncLoads) {
+    std::mutex mu;
+    std::vector<LoadCallback> pending;
+    GroupOptions opts;
+    WithAsyncGetter([&](const std::string&, LoadCallback cb) {
+        std::lock_guard lock{mu};
+        pending.push_back(cb);
+    })(&opts);
+    WithLoadTimeout(std::chrono::milliseconds(20))(&opts);
+    auto group = std::make_unique<KCacheGroup>("group_lost_load", 1024, nullptr, opts);
+    EXPECT_FALSE(group->Get("a").has_value());
+
+    auto start = std::chrono::steady_clock::now();
+    group.reset();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+    std::lock_guard lock{mu};
+    ASSERT_EQ(pending.size(), 1);
+    pending[0](ByteView{"late"});
+}
+
+// 不同 key 的并发未命中合并为一次批量加载，结果分发给各自的等待者
+TEST_F(CacheGroupTest, BatchGetterCoalescesMisses) {
+    std::mutex mu;
+    std::vector<size_t> batch_sizes;
+    auto batch_getter = [&](const std::vector<std::string>& keys) {
+        {
+            std::lock_guard lock{mu};
+            batch_sizes.push_back(keys.size());
+        }
+        std::unordered_map<std::string, ByteViewOptional> values;
+        for (const auto& key : keys) {
+            values[key] = key == "k_missing" ? ByteViewOptional{} : ByteView{"v_" + key};
+        }
+        return values;
+    };
+    GroupOptions opts;
+    WithBatchGetter(batch_getter, std::chrono::milliseconds(50), 4)(&opts);
+    KCacheGroup group("group_batch_getter", 4096, nullptr, opts);
+
+    const int N = 8;
+    std::vector<std::thread> ths;
+    std::vector<std::string> results(N);
+    for (int i = 0; i < N; ++i) {
+        ths.emplace_back([&, i] {
+            auto key = i == N - 1 ? std::string{"k_missing"} : "k" + std::to_string(i);
+            auto r = group.Get(key);
+            results[i] = r ? r->ToString() : "<none>";
+        });
+    }
+    for (auto& t : ths) t.join();
+
+    for (int i = 0; i < N - 1; ++i) EXPECT_EQ(results[i], "v_k" + std::to_string(i));
+    EXPECT_EQ(results[N - 1], "<none>");
+
+    std::lock_guard lock{mu};
+    size_t total = 0;
+    for (auto n : batch_sizes) {
+        EXPECT_LE(n, 4);
+        total += n;
+    }
+    EXPECT_EQ(total, N);
+    EXPECT_LT(batch_sizes.size(), N);
+}
+
+// 攒批窗口结束前等待者都已超时离开的 key 不再加载
+TEST_F(CacheGroupTest, BatchSkipsAbandonedKeys) {
+    std::atomic<int> loaded{0};
+    GroupOptions opts;
+    WithBatchGetter(
+        [&](const std::vector<std::string>& keys) {
+            loaded += static_cast<int>(keys.size());
+            return std::unordered_map<std::string, ByteViewOptional>{};
+        },
+        std::chrono::milliseconds(100), 4)(&opts);
+    WithLoadTimeout(std::chrono::milliseconds(10))(&opts);
+    {
+        KCacheGroup group("group_batch_abandon", 1024, nullptr, opts);
+        EXPECT_FALSE(group.Get("k").has_value());
+    }
+    EXPECT_EQ(loaded.load(), 0);
+}
+
+// 过期后重新回源
+TEST_F(CacheGroupTest, TTLExpiresEntries) {
+    GroupOptions opts;
+    WithTTL(std::chrono::milliseconds(50))(&opts);
+    KCacheGroup group("group_ttl", 1024, getter_, opts);
+
+    ASSERT_TRUE(group.Get("key1").has_value());
+    ASSERT_TRUE(group.Get("key1").has_value());
+    EXPECT_EQ(call_count_["key1"], 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    ASSERT_TRUE(group.Get("key1").has_value());
+    EXPECT_EQ(call_count_["key1"], 2);
+}
+
+// 即将过期时访问触发后台刷新，期间继续返回旧值
+TEST_F(CacheGroupTest, RefreshAheadReloadsInBackground) {
+    std::atomic<int> version{0};
+    std::atomic<int> calls{0};
+    DataGetter getter = [&](const std::string&) -> ByteViewOptional {
+        ++calls;
+        return ByteView{"v" + std::to_string(version.load())};
+    };
+    GroupOptions opts;
+    WithTTL(std::chrono::milliseconds(200))(&opts);
+    WithRefreshAhead(std::chrono::milliseconds(150))(&opts);
+    KCacheGroup group("group_refresh", 1024, getter, opts);
+
+    EXPECT_EQ(group.Get("k")->ToString(), "v0");
+    version = 1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // 进入刷新窗口：本次仍返回旧值，后台完成刷新
+    EXPECT_EQ(group.Get("k")->ToString(), "v0");
+    for (int i = 0; i < 50 && calls.load() < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(calls.load(), 2);
+    EXPECT_EQ(group.Get("k")->ToString(), "v1");
+    EXPECT_EQ(group.Stats().refreshes, 1);
+}
+
+// 过期后回源失败，宽限期内返回旧值，超过宽限期返回空
+TEST_F(CacheGroupTest, StaleGraceServesOldValueOnLoadFailure) {
+    std::atomic<bool> healthy{true};
+    DataGetter getter = [&](const std::string&) -> ByteViewOptional {
+        if (!healthy) throw std::runtime_error("source unavailable");
+        return ByteView{"fresh"};
+    };
+    GroupOptions opts;
+    WithTTL(std::chrono::milliseconds(30))(&opts);
+    WithStaleGrace(std::chrono::milliseconds(100))(&opts);
+    KCacheGroup group("group_stale", 1024, getter, opts);
+
+    ASSERT_TRUE(group.Get("k").has_value());
+    healthy = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    auto r = group.Get("k");
+    ASSERT_TRUE(r.has_value());
+    EXPECT_EQ(r->ToString(), "fresh");
+    EXPECT_EQ(group.Stats().stale_hits, 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    EXPECT_FALSE(group.Get("k").has_value());
+}
+
+// 过期后数据源确认 key 已被删除时不返回旧值
+TEST_F(CacheGroupTest, StaleGraceSkipsDeletedKey) {
+    std::atomic<bool> exists{true};
+    DataGetter getter = [&](const std::string&) -> ByteViewOptional {
+        if (!exists) return std::nullopt;
+        return ByteView{"fresh"};
+    };
+    GroupOptions opts;
+    WithTTL(std::chrono::milliseconds(30))(&opts);
+    WithStaleGrace(std::chrono::milliseconds(1000))(&opts);
+    KCacheGroup group("group_stale_deleted", 1024, getter, opts);
+
+    ASSERT_TRUE(group.Get("k").has_value());
+    exists = false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    EXPECT_FALSE(group.Get("k").has_value());
+    EXPECT_EQ(group.Stats().stale_hits, 0);
+}
+
+// 不存在的 key 在负缓存有效期内只回源一次，Set 后负缓存失效
+TEST_F(CacheGroupTest, NegativeCacheSuppressesRepeatedMisses) {
+    GroupOptions opts;
+    WithNegativeCache(std::chrono::milliseconds(100), 1024)(&opts);
+    KCacheGroup group("group_negative", 1024, getter_, opts);
+
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_FALSE(group.Get("ghost").has_value());
+    }
+    EXPECT_EQ(call_count_["ghost"], 1);
+    EXPECT_EQ(group.Stats().negative_hits, 4);
+
+    // 过期后重新回源
+    std::this_thread::sleep_for(std::chrono::milliseconds(120));
+    EXPECT_FALSE(group.Get("ghost").has_value());
+    EXPECT_EQ(call_count_["ghost"], 2);
+
+    // Set 清除负缓存
+    EXPECT_TRUE(group.Set("ghost", ByteView{"now_exists"}));
+    EXPECT_EQ(group.Get("ghost")->ToString(), "now_exists");
+    EXPECT_TRUE(group.Delete("ghost"));
+    db_["ghost"] = "from_db";
+    EXPECT_EQ(group.Get("ghost")->ToString(), "from_db");
+}
+
+// 加载失败不写入负缓存，下次访问重新回源；只有数据源明确返回不存在时才写入
+TEST_F(CacheGroupTest, LoadErrorIsNotCachedAsAbsent) {
+    std::mutex mu;
+    std::unordered_map<std::string, int> calls;
+    GroupOptions opts;
+    WithNegativeCache(std::chrono::milliseconds(1000), 1024)(&opts);
+    WithAsyncGetter([&](const std::string& key, LoadCallback cb) {
+        {
+            std::lock_guard lock{mu};
+            ++calls[key];
+        }
+        if (key == "broken") {
+            cb.Fail();
+        } else {
+            cb(std::nullopt);
+        }
+    })(&opts);
+    KCacheGroup group("group_load_error", 1024, nullptr, opts);
+
+    EXPECT_FALSE(group.Get("broken").has_value());
+    EXPECT_FALSE(group.Get("broken").has_value());
+    EXPECT_FALSE(group.Get("absent").has_value());
+    EXPECT_FALSE(group.Get("absent").has_value());
+    EXPECT_EQ(calls["broken"], 2);
+    EXPECT_EQ(calls["absent"], 1);
+    EXPECT_EQ(group.Stats().negative_hits, 1);
+
+    // 批量结果中缺少的 key 同样按失败处理
+    GroupOptions batch_opts;
+    WithNegativeCache(std::chrono::milliseconds(1000), 1024)(&batch_opts);
+    WithBatchGetter(
+        [&](const std::vector<std::string>& keys) {
+            std::lock_guard lock{mu};
+            for (const auto& key : keys) ++calls[key];
+            return std::unordered_map<std::string, ByteViewOptional>{};
+        },
+        std::chrono::milliseconds(1), 4)(&batch_opts);
+    KCacheGroup batch_group("group_batch_error", 1024, nullptr, batch_opts);
+    EXPECT_FALSE(batch_group.Get("omitted").has_value());
+    EXPECT_FALSE(batch_group.Get("omitted").has_value());
+    EXPECT_EQ(calls["omitted"], 2);
+}
+
+// 过滤器判定一定不存在的 key 不回源
+TEST_F(CacheGroupTest, KeyFilterSkipsLoader) {
+    GroupOptions opts;
+    WithKeyFilter([](const std::string& key) { return key.rfind("key", 0) == 0; })(&opts);
+    KCacheGroup group("group_filter", 1024, getter_, opts);
+
+    EXPECT_FALSE(group.Get("bot_probe").has_value());
+    EXPECT_EQ(call_count_["bot_probe"], 0);
+    EXPECT_TRUE(group.Get("key1").has_value());
+    EXPECT_EQ(call_count_["key1"], 1);
+}
+
+// 未命中时只有第一个请求方拿到租约，填充后其他请求方直接命中
+TEST_F(CacheGroupTest, LeaseGrantsSingleFill) {
+    GroupOptions opts;
+    WithLease(std::chrono::milliseconds(200), std::chrono::milliseconds(5), std::chrono::seconds(1))(&opts);
+    KCacheGroup group("group_lease", 1024, getter_, opts);
+
+    auto first = group.GetOrLease("key");
+    EXPECT_FALSE(first.hit);
+    EXPECT_NE(first.token, 0);
+
+    auto second = group.GetOrLease("key");
+    EXPECT_EQ(second.token, 0);
+    EXPECT_FALSE(second.value.has_value());
+    EXPECT_EQ(second.retry_after, std::chrono::milliseconds(5));
+
+    EXPECT_FALSE(group.Fill("key", ByteView{"wrong"}, first.token + 1));
+    EXPECT_TRUE(group.Fill("key", ByteView{"leased"}, first.token));
+    auto third = group.GetOrLease("key");
+    EXPECT_TRUE(third.hit);
+    EXPECT_EQ(third.value->ToString(), "leased");
+    EXPECT_EQ(call_count_["key"], 0);
+    EXPECT_EQ(group.Stats().lease_grants, 1);
+    EXPECT_EQ(group.Stats().lease_waits, 1);
+}
+
+// 失效会撤销进行中的租约，等待者在填充完成前拿到旧值
+TEST_F(CacheGroupTest, InvalidateRevokesLeaseAndKeepsStale) {
+    GroupOptions opts;
+    WithLease(std::chrono::milliseconds(200), std::chrono::milliseconds(5), std::chrono::seconds(1))(&opts);
+    KCacheGroup group("group_lease_stale", 1024, getter_, opts);
+
+    auto lease = group.GetOrLease("key");
+    ASSERT_NE(lease.token, 0);
+    group.Set("key", ByteView{"v1"});
+    // Set 之后旧租约失效，不会用可能过时的数据覆盖新值
+    EXPECT_FALSE(group.Fill("key", ByteView{"old"}, lease.token));
+    EXPECT_EQ(group.GetOrLease("key").value->ToString(), "v1");
+
+    group.InvalidateFromPeer("key");
+    auto holder = group.GetOrLease("key");
+    EXPECT_NE(holder.token, 0);
+    auto waiter = group.GetOrLease("key");
+    EXPECT_TRUE(waiter.stale);
+    EXPECT_EQ(waiter.value->ToString(), "v1");
+
+    EXPECT_TRUE(group.Fill("key", ByteView{"v2"}, holder.token));
+    auto after = group.GetOrLease("key");
+    EXPECT_TRUE(after.hit);
+    EXPECT_EQ(after.value->ToString(), "v2");
+}
+
+// write-through：数据源写入失败时不更新缓存
+TEST_F(CacheGroupTest, WriteThroughPersistsBeforeCaching) {
+    bool fail = false;
+    GroupOptions opts;
+    WithWriteThrough([&](const std::string& key, const ByteView& value) {
+        if (fail) return false;
+        db_[key] = value.ToString();
+        return true;
+    })(&opts);
+    KCacheGroup group("group_write_through", 1024, getter_, opts);
+
+    EXPECT_TRUE(group.Set("key4", ByteView{"value4"}));
+    EXPECT_EQ(db_["key4"], "value4");
+    EXPECT_EQ(group.Get("key4")->ToString(), "value4");
+
+    fail = true;
+    EXPECT_FALSE(group.Set("key4", ByteView{"value5"}));
+    EXPECT_EQ(group.Get("key4")->ToString(), "value4");
+    EXPECT_EQ(group.Stats().write_errors, 1);
+}
+
+// write-behind：同一个 key 的多次写入合并后批量写回，写回前回源以待写入的值为准
+TEST_F(CacheGroupTest, WriteBehindCoalescesWrites) {
+    std::mutex mu;
+    std::vector<std::pair<std::string, ByteView>> written;
+    int batches = 0;
+    GroupOptions opts;
+    WithWriteBehind(
+        [&](const std::vector<std::pair<std::string, ByteView>>& entries) {
+            std::lock_guard lock{mu};
+            ++batches;
+            written.insert(written.end(), entries.begin(), entries.end());
+            return true;
+        },
+        std::chrono::milliseconds(50), 128, 1000)(&opts);
+    KCacheGroup group("group_write_behind", 1024, getter_, opts);
+
+    for (int i = 0; i < 100; ++i) {
+        group.Set("counter", ByteView{std::to_string(i)});
+    }
+    // 缓存被删除后仍能读到尚未写回的值，而不是数据源中的旧值
+    group.Delete("counter");
+    EXPECT_EQ(group.Get("counter")->ToString(), "99");
+    EXPECT_EQ(call_count_["counter"], 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    std::lock_guard lock{mu};
+    ASSERT_EQ(written.size(), 1);
+    EXPECT_EQ(batches, 1);
+    EXPECT_EQ(written[0].first, "counter");
+    EXPECT_EQ(written[0].second.ToString(), "99");
+    EXPECT_EQ(group.Stats().write_behind_written, 1);
+}
+
+// write-behind 写回失败后等一个间隔再重试，积压攒够一批也不会空转；重试时保持原来的写入顺序
+TEST_F(CacheGroupTest, WriteBehindRetriesInOrder) {
+    std::mutex mu;
+    std::vector<std::vector<std::string>> batches;
+    bool healthy = false;
+    GroupOptions opts;
+    WithWriteBehind(
+        [&](const std::vector<std::pair<std::string, ByteView>>& entries) {
+            std::lock_guard lock{mu};
+            batches.emplace_back();
+            for (const auto& entry : entries) {
+                batches.back().push_back(entry.first);
+            }
+            return healthy;
+        },
+        std::chrono::milliseconds(100), 2, 1000)(&opts);
+    KCacheGroup group("group_write_behind_retry", 1024, getter_, opts);
+
+    group.Set("a", ByteView{"1"});
+    group.Set("b", ByteView{"2"});
+    group.Set("c", ByteView{"3"});
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    {
+        std::lock_guard lock{mu};
+        ASSERT_EQ(batches.size(), 1);
+        EXPECT_EQ(batches[0], (std::vector<std::string>{"a", "b"}));
+        healthy = true;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    std::lock_guard lock{mu};
+    ASSERT_GE(batches.size(), 2);
+    EXPECT_EQ(batches[1], (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(group.Stats().write_behind_written, 3);
+}
+
+// 按标签批量失效，显式标签和 tagger 生成的标签都生效
+TEST_F(CacheGroupTest, InvalidateTag) {
+    GroupOptions opts;
+    WithTagger([](const std::string& key) -> std::vector<std::string> {
+        return {key.substr(0, key.find(':'))};
+    })(&opts);
+    KCacheGroup group("group_tag", 1024, getter_, opts);
+
+    group.Set("u1:name", ByteView{"a"}, {"tenant:1"});
+    group.Set("u1:age", ByteView{"b"}, {"tenant:1"});
+    group.Set("u2:name", ByteView{"c"}, {"tenant:2"});
+    group.Set("u3:name", ByteView{"d"});
+
+    EXPECT_EQ(group.InvalidateTag("tenant:1"), 2);
+    EXPECT_FALSE(group.Peek("u1:name").has_value());
+    EXPECT_FALSE(group.Peek("u1:age").has_value());
+    EXPECT_TRUE(group.Peek("u2:name").has_value());
+
+    EXPECT_EQ(group.InvalidateTag("u3"), 1);
+    EXPECT_FALSE(group.Peek("u3:name").has_value());
+    EXPECT_EQ(group.InvalidateTag("tenant:1"), 0);
+}
+
+// 按标签失效只撤销属于该标签的 key 的租约，其他 key 的租约持有者仍可填充
+TEST_F(CacheGroupTest, InvalidateTagRevokesOnlyTaggedLeases) {
+    GroupOptions opts;
+    WithLease(std::chrono::milliseconds(200), std::chrono::milliseconds(5), std::chrono::seconds(1))(&opts);
+    WithTagger([](const std::string& key) -> std::vector<std::string> {
+        return {key.substr(0, key.find(':'))};
+    })(&opts);
+    KCacheGroup group("group_tag_lease", 1024, getter_, opts);
+
+    auto u1 = group.GetOrLease("u1:name");
+    auto u2 = group.GetOrLease("u2:name");
+    ASSERT_NE(u1.token, 0);
+    ASSERT_NE(u2.token, 0);
+
+    group.InvalidateTag("u1");
+    EXPECT_FALSE(group.Fill("u1:name", ByteView{"a"}, u1.token));
+    EXPECT_TRUE(group.Fill("u2:name", ByteView{"b"}, u2.token));
+    EXPECT_EQ(group.Peek("u2:name")->ToString(), "b");
+}
+
+// 按前缀批量失效，有无前缀索引结果一致，淘汰的 key 会从索引中移除
+TEST_F(CacheGroupTest, InvalidatePrefix) {
+    for (bool indexed : {false, true}) {
+        GroupOptions opts;
+        WithPrefixIndex(indexed)(&opts);
+        KCacheGroup group("group_prefix", 1024, getter_, opts);
+
+        group.Set("user/1/a", ByteView{"1"});
+        group.Set("user/1/b", ByteView{"2"});
+        group.Set("user/10/a", ByteView{"3"});
+        group.Set("user/2/a", ByteView{"4"});
+        group.Delete("user/1/b");
+
+        EXPECT_EQ(group.InvalidatePrefix("user/1/"), 1);
+        EXPECT_FALSE(group.Peek("user/1/a").has_value());
+        EXPECT_TRUE(group.Peek("user/10/a").has_value());
+        EXPECT_EQ(group.InvalidatePrefix("user/"), 2);
+    }
+}
+
+// 未开启前缀索引时，按前缀失效也会删除已过期的 key，宽限期内不会再作为旧值返回
+TEST_F(CacheGroupTest, InvalidatePrefixRemovesExpiredKeys) {
+    DataGetter getter = [](const std::string&) -> ByteViewOptional { throw std::runtime_error("source unavailable"); };
+    GroupOptions opts;
+    WithTTL(std::chrono::milliseconds(30))(&opts);
+    WithStaleGrace(std::chrono::seconds(10))(&opts);
+    KCacheGroup group("group_prefix_expired", 1024, getter, opts);
+
+    group.Set("user/1/a", ByteView{"1"});
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    EXPECT_EQ(group.InvalidatePrefix("user/1/"), 1);
+    EXPECT_FALSE(group.Get("user/1/a").has_value());
+    EXPECT_EQ(group.Stats().stale_hits, 0);
+}
+
+// Flush 之后旧数据立即不可见，重新回源
+TEST_F(CacheGroupTest, FlushHidesEntries) {
+    KCacheGroup group("group_flush", 1024, getter_);
+    EXPECT_EQ(group.Get("key1")->ToString(), "value1");
+    group.Set("key4", ByteView{"value4"});
+
+    auto generation = group.Flush();
+    EXPECT_EQ(generation, 1);
+    EXPECT_FALSE(group.Peek("key4").has_value());
+    EXPECT_EQ(group.Get("key1")->ToString(), "value1");
+    EXPECT_EQ(call_count_["key1"], 2);
+}
+
+// 版本号不匹配时条件写入失败，并返回当前版本号
+TEST_F(CacheGroupTest, CompareAndSet) {
+    KCacheGroup group("group_cas", 1024, getter_);
+    auto loaded = group.GetVersioned("key1");
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_GT(loaded->version, 0);
+
+    auto first = group.CompareAndSet("key1", ByteView{"v2"}, loaded->version);
+    EXPECT_TRUE(first.ok);
+    EXPECT_GT(first.version, loaded->version);
+
+    // 使用过期的版本号写入失败
+    auto second = group.CompareAndSet("key1", ByteView{"v3"}, loaded->version);
+    EXPECT_FALSE(second.ok);
+    EXPECT_EQ(second.version, first.version);
+    EXPECT_EQ(group.Get("key1")->ToString(), "v2");
+
+    // expected_version 为 0 表示仅在不存在时写入
+    EXPECT_TRUE(group.CompareAndSet("new_key", ByteView{"v"}, 0).ok);
+    EXPECT_FALSE(group.CompareAndSet("new_key", ByteView{"w"}, 0).ok);
+}
+
+// 并发 Incr 不丢失更新，非整数值拒绝 Incr，Append 在末尾追加
+TEST_F(CacheGroupTest, IncrAndAppend) {
+    KCacheGroup group("group_incr", 1024, getter_);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&group] {
+            for (int j = 0; j < 100; ++j) {
+                group.Incr("counter", 1);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(group.Get("counter")->ToString(), "800");
+    EXPECT_EQ(group.Incr("counter", -1000)->first, -200);
+    EXPECT_FALSE(group.Incr("key1", 1).has_value());
+
+    EXPECT_GT(group.Append("key1", ByteView{"_tail"}), 0);
+    EXPECT_EQ(group.Get("key1")->ToString(), "value1_tail");
+}
+
+// 缓存中的计数器过期后从数据源中的值继续累加，回源失败时 Incr 和 Append 失败，不会把值重置
+TEST_F(CacheGroupTest, IncrReloadsExpiredValue) {
+    std::atomic<bool> healthy{true};
+    DataGetter getter = [&](const std::string& key) -> ByteViewOptional {
+        if (!healthy) throw std::runtime_error("db down");
+        auto it = db_.find(key);
+        return it != db_.end() ? ByteViewOptional{ByteView{it->second}} : std::nullopt;
+    };
+    GroupOptions opts;
+    WithTTL(std::chrono::milliseconds(30))(&opts);
+    WithWriteThrough([&](const std::string& key, const ByteView& value) {
+        db_[key] = value.ToString();
+        return true;
+    })(&opts);
+    KCacheGroup group("group_incr_reload", 1024, getter, opts);
+
+    db_["counter"] = "41";
+    EXPECT_EQ(group.Incr("counter", 1)->first, 42);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(group.Incr("counter", 1)->first, 43);
+    EXPECT_EQ(db_["counter"], "43");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    healthy = false;
+    EXPECT_FALSE(group.Incr("counter", 1).has_value());
+    EXPECT_EQ(group.Append("key1", ByteView{"_tail"}), 0);
+    EXPECT_EQ(db_["counter"], "43");
+    EXPECT_EQ(db_["key1"], "value1");
+}
+
+// 热点 key 被探测出来；作为副本读取时未命中只向 owner 拉取一次，不访问数据源
+TEST_F(CacheGroupTest, HotKeyReplica) {
+    GroupOptions opts;
+    WithHotKeyDetection(16, 0.2, std::chrono::seconds(1))(&opts);
+    opts.hot_key_sample_rate = 1;
+    KCacheGroup group("group_hot", 1024, getter_, opts);
+    // 热点集合每 1024 次采样发布一次
+    for (int i = 0; i < 600; ++i) {
+        group.Get("key1");
+        group.Get("key" + std::to_string(i % 3 + 2));
+    }
+    EXPECT_TRUE(group.IsHotKey("key1"));
+    EXPECT_FALSE(group.IsHotKey("key2"));
+    EXPECT_EQ(group.TopKeys(1)[0].key, "key1");
+
+    int fetches = 0;
+    auto fetch = [&fetches](const std::string& key) -> ByteViewOptional {
+        ++fetches;
+        return ByteView{"from_owner"};
+    };
+    EXPECT_EQ(group.GetReplica("replica_key", fetch)->ToString(), "from_owner");
+    EXPECT_EQ(group.GetReplica("replica_key", fetch)->ToString(), "from_owner");
+    EXPECT_EQ(fetches, 1);
+    EXPECT_EQ(call_count_["replica_key"], 0);
+    EXPECT_EQ(group.Stats().peer_hits, 1);
+}
+
+// 反复读取的 key 由线程本地 L0 缓存返回，不再访问共享的缓存；写入和 Flush 后立即失效
+TEST_F(CacheGroupTest, L0CacheServesRepeatedReads) {
+    GroupOptions opts;
+    WithL0Cache(std::chrono::seconds(10))(&opts);
+    KCacheGroup group("group_l0", 1024, getter_, opts);
+    group.Get("key1");  // 回源
+    group.Get("key1");  // 本地缓存命中，第一次尝试写入 L0
+    group.Get("key1");  // 本地缓存命中，写入 L0
+    auto hits = group.Stats().local_hits;
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(group.Get("key1")->ToString(), "value1");
+    }
+    EXPECT_EQ(group.Stats().local_hits, hits);
+    EXPECT_EQ(group.Stats().l0_hits, 10);
+    EXPECT_EQ(group.Stats().load_latency.count, 1);
+    // L0 命中共享同一份值，不复制
+    EXPECT_EQ(group.GetVersioned("key1")->value.get(), group.GetVersioned("key1")->value.get());
+
+    group.Set("key1", ByteView{"new"});
+    EXPECT_EQ(group.Get("key1")->ToString(), "new");
+
+    group.Get("key1");
+    group.Flush();
+    EXPECT_EQ(group.Get("key1")->ToString(), "value1");
+
+    // 其他线程看到的是自己的 L0 缓存
+    std::thread reader{[&group] { EXPECT_EQ(group.Get("key1")->ToString(), "value1"); }};
+    reader.join();
+}
+
+// 后台刷新写入的新值同样使各线程 L0 中的旧副本失效
+TEST_F(CacheGroupTest, RefreshInvalidatesL0) {
+    GroupOptions opts;
+    WithL0Cache(std::chrono::seconds(10))(&opts);
+    WithTTL(std::chrono::milliseconds(300))(&opts);
+    WithRefreshAhead(std::chrono::milliseconds(250))(&opts);
+    KCacheGroup group("group_l0_refresh", 1024, getter_, opts);
+    group.Get("key1");  // 回源
+    group.Get("key1");  // 本地缓存命中，第一次尝试写入 L0
+    group.Get("key1");  // 本地缓存命中，写入 L0
+    EXPECT_EQ(group.Get("key1")->ToString(), "value1");
+    ASSERT_EQ(group.Stats().l0_hits, 1);
+
+    db_["key1"] = "refreshed";
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    // 其他线程的本地缓存命中落在刷新窗口内，触发后台刷新
+    std::thread reader{[&group] { group.Get("key1"); }};
+    reader.join();
+
+    // 旧值在 300ms 后才过期，在此之前读到新值说明 L0 副本已随刷新失效
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(150);
+    while (group.Get("key1")->ToString() != "refreshed" && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(group.Get("key1")->ToString(), "refreshed");
+}
+
+// 运行时调整容量：扩容不丢数据，缩容立即淘汰最久未使用的数据
+TEST_F(CacheGroupTest, SetMaxBytesResizesInPlace) {
+    KCacheGroup group("group_resize", 64, getter_);
+    group.Get("key1");
+    group.Get("key2");
+    group.Get("key3");
+    EXPECT_EQ(group.Occupancy()[0].entries, 3);
+
+    EXPECT_EQ(group.SetMaxBytes(1024), 0);
+    EXPECT_EQ(group.Occupancy()[0].max_bytes, 1024);
+    EXPECT_TRUE(group.Peek("key1").has_value());
+
+    EXPECT_EQ(group.SetMaxBytes(10), 2);
+    EXPECT_FALSE(group.Peek("key1").has_value());
+    EXPECT_TRUE(group.Peek("key3").has_value());
+    EXPECT_EQ(group.Stats().evictions, 2);
+    EXPECT_FALSE(group.SetEvictionPolicy("unknown"));
+    EXPECT_TRUE(group.SetEvictionPolicy("gdsf"));
+    EXPECT_EQ(group.EvictionPolicy(), "gdsf");
+    EXPECT_TRUE(group.Peek("key3").has_value());
+}
+
 // 全局方法测试
 TEST(CacheGroupGlobalTest, MakeCacheGroupCreatesUsableGroup) {
     std::unordered_map<std::string, std::string> db = {{"gkey", "gvalue"}};
@@ -230,3 +998,53 @@ TEST(CacheGroupGlobalTest, MultipleNamedGroupsAreIndependent) {
     EXPECT_FALSE(g1.Get("k2").has_value());
     EXPECT_FALSE(g2.Get("k1").has_value());
 }
+
+// 按编号查找与按名称查找得到同一个对象，同名重新创建时沿用原来的编号，旧对象被关闭但在 guard 期间仍然可以访问
+TEST(CacheGroupGlobalTest, GroupIdLookupAndReplace) {
+    auto getter = [](const std::string& key) -> ByteViewOptional { return ByteView{key}; };
+    GroupReadGuard guard;
+    auto& first = MakeCacheGroup("id_group", 256, getter);
+    ASSERT_NE(first.Id(), 0);
+    EXPECT_EQ(GetCacheGroup(first.Id()), &first);
+    EXPECT_EQ(GetCacheGroup("id_group"), &first);
+
+    auto& second = MakeCacheGroup("id_group", 256, getter);
+    EXPECT_NE(&second, &first);
+    EXPECT_EQ(second.Id(), first.Id());
+    EXPECT_EQ(GetCacheGroup(first.Id()), &second);
+    EXPECT_FALSE(first.Get("closed").has_value());
+    EXPECT_TRUE(second.Get("open").has_value());
+
+    auto& other = MakeCacheGroup("id_group_other", 256, getter);
+    EXPECT_NE(other.Id(), first.Id());
+    EXPECT_EQ(GetCacheGroup(uint32_t{0}), nullptr);
+    EXPECT_EQ(GetCacheGroup(other.Id() + 1), nullptr);
+}
+
+// 被替换的缓存组立即写回积压的数据，替换前开始的读取方都结束后才释放
+TEST(CacheGroupGlobalTest, ReplacedGroupIsClosedAndReclaimed) {
+    auto owner = std::make_shared<int>(0);  // 旧缓存组的 getter 持有一份，缓存组释放时随之释放
+    auto getter = [](const std::string& key) -> ByteViewOptional { return ByteView{key}; };
+    std::atomic<int> written{0};
+    auto setter = [&written](const std::vector<std::pair<std::string, ByteView>>& entries) {
+        written += static_cast<int>(entries.size());
+        return true;
+    };
+    GroupOptions opts;
+    WithWriteBehind(setter, std::chrono::hours(1), 100, 100)(&opts);
+    auto* first = &MakeCacheGroup(
+        "replaced_group", 256, [owner](const std::string& key) -> ByteViewOptional { return ByteView{key}; }, opts);
+    std::optional<GroupReadGuard> reader;
+    reader.emplace();
+    ASSERT_TRUE(first->Set("k", ByteView{"v"}));
+
+    MakeCacheGroup("replaced_group", 256, getter);
+    EXPECT_EQ(written.load(), 1);
+    EXPECT_FALSE(first->Set("k", ByteView{"v2"}));
+    EXPECT_GT(owner.use_count(), 1);
+
+    reader.reset();
+    EXPECT_EQ(owner.use_count(), 1);
+    GroupReadGuard guard;
+    EXPECT_NE(GetCacheGroup("replaced_group"), first);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "kcache/hot_keys.h"
+
+using namespace kcache;
+
+// 倾斜的访问分布下能找出真正的热点，冷门 key 不会被判定为热点
+TEST(HotKeySketchTest, FindsHeavyHitters) {
+    HotKeySketch sketch{8, 1, 1 << 20, 0.1};
+    for (int i = 0; i < 1000; ++i) {
+        sketch.Record("viral");
+        if (i % 2 == 0) {
+            sketch.Record("popular");
+        }
+        sketch.Record("cold" + std::to_string(i));
+    }
+
+    auto top = sketch.TopK(2);
+    ASSERT_EQ(top.size(), 2);
+    EXPECT_EQ(top[0].key, "viral");
+    EXPECT_EQ(top[1].key, "popular");
+    EXPECT_TRUE(sketch.IsHot("viral"));
+    EXPECT_FALSE(sketch.IsHot("cold999"));
+    EXPECT_FALSE(sketch.IsHot("never"));
+    // 只跟踪固定数量的 key
+    EXPECT_EQ(sketch.TopK(100).size(), 8);
+}
+
+// 计数随窗口衰减，不再被访问的热点最终会被新的热点替换
+TEST(HotKeySketchTest, OldHotKeysDecay) {
+    HotKeySketch sketch{4, 1, 200, 0.1};
+    for (int i = 0; i < 1000; ++i) {
+        sketch.Record("old");
+    }
+    for (int i = 0; i < 1000; ++i) {
+        sketch.Record("new");
+        sketch.Record("other" + std::to_string(i % 16));
+    }
+    EXPECT_EQ(sketch.TopK(1)[0].key, "new");
+    EXPECT_FALSE(sketch.IsHot("old"));
+}
+
+// 热点集合定期发布，两次发布之间的新热点要等到下一次发布才生效
+TEST(HotKeySketchTest, PublishesHotSet) {
+    HotKeySketch sketch{8, 1, 1 << 20, 0.5};
+    for (int i = 0; i < 1000; ++i) {
+        sketch.Record("hot");
+    }
+    EXPECT_FALSE(sketch.IsHot("hot"));
+    for (int i = 0; i < 100; ++i) {
+        sketch.Record("hot");
+    }
+    EXPECT_TRUE(sketch.IsHot("hot"));
+    EXPECT_FALSE(sketch.IsHot("cold"));
+}
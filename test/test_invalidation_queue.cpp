@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MIT
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "kcache/invalidation_queue.h"
+
+using namespace kcache;
+
+namespace {
+
+using Batch = std::vector<std::pair<std::string, std::string>>;
+
+// 记录每次发送的批次，前 FailTimes 次发送失败；Hold 之后发送阻塞到 Release
+class FakeNode {
+public:
+    auto Sender() -> InvalidationSender {
+        return [this](const Batch& batch) {
+            std::unique_lock lock{mtx_};
+            ++calls_;
+            cv_.wait(lock, [this] { return !hold_; });
+            batches_.push_back(batch);
+            return static_cast<int>(batches_.size()) > fail_times_;
+        };
+    }
+
+    void Hold() {
+        std::lock_guard lock{mtx_};
+        hold_ = true;
+    }
+
+    void Release() {
+        {
+            std::lock_guard lock{mtx_};
+            hold_ = false;
+        }
+        cv_.notify_all();
+    }
+
+    void FailTimes(int n) {
+        std::lock_guard lock{mtx_};
+        fail_times_ = n;
+    }
+
+    // 已开始的发送次数，包括阻塞中的
+    auto Calls() -> int {
+        std::lock_guard lock{mtx_};
+        return calls_;
+    }
+
+    auto Batches() -> std::vector<Batch> {
+        std::lock_guard lock{mtx_};
+        return batches_;
+    }
+
+private:
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool hold_{false};
+    int fail_times_{0};
+    int calls_{0};
+    std::vector<Batch> batches_;
+};
+
+bool WaitFor(const std::function<bool()>& cond, std::chrono::milliseconds timeout = std::chrono::seconds(5)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!cond()) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+}  // namespace
+
+// 发送期间同一个 key 的多次失效合并为一次，之后按入队顺序批量发送
+TEST(InvalidationQueueTest, MergesPendingKeys) {
+    FakeNode node;
+    node.Hold();
+    InvalidationQueue queue{"node", node.Sender(), 16, std::chrono::milliseconds(10)};
+    queue.Push("g", "k0");
+    ASSERT_TRUE(WaitFor([&] { return node.Calls() == 1; }));
+
+    queue.Push("g", "k1");
+    queue.Push("g", "k2");
+    queue.Push("g", "k1");
+    EXPECT_EQ(queue.Pending(), 3);
+
+    node.Release();
+    ASSERT_TRUE(WaitFor([&] { return queue.Pending() == 0; }));
+    auto batches = node.Batches();
+    ASSERT_EQ(batches.size(), 2);
+    EXPECT_EQ(batches[0], (Batch{{"g", "k0"}}));
+    EXPECT_EQ(batches[1], (Batch{{"g", "k1"}, {"g", "k2"}}));
+}
+
+// 发送失败的批次放回队首重试，重试时排在之后入队的 key 前面
+TEST(InvalidationQueueTest, RetriesFailedBatchInOrder) {
+    FakeNode node;
+    node.FailTimes(2);
+    node.Hold();
+    InvalidationQueue queue{"node", node.Sender(), 16, std::chrono::milliseconds(10)};
+    queue.Push("g", "k0");
+    ASSERT_TRUE(WaitFor([&] { return node.Calls() == 1; }));
+    queue.Push("g", "k1");
+    queue.Push("g", "k2");
+    node.Release();
+
+    ASSERT_TRUE(WaitFor([&] { return queue.Pending() == 0; }));
+    auto batches = node.Batches();
+    ASSERT_EQ(batches.size(), 3);
+    EXPECT_EQ(batches[0], (Batch{{"g", "k0"}}));
+    EXPECT_EQ(batches[1], (Batch{{"g", "k0"}, {"g", "k1"}, {"g", "k2"}}));
+    EXPECT_EQ(batches[2], batches[1]);
+}
+
+// 停止时先把积压的失效通知发送完
+TEST(InvalidationQueueTest, StopDrainsPending) {
+    FakeNode node;
+    node.Hold();
+    InvalidationQueue queue{"node", node.Sender(), 2, std::chrono::milliseconds(10)};
+    for (int i = 0; i < 5; ++i) {
+        queue.Push("g", "k" + std::to_string(i));
+    }
+    std::thread stopper{[&] { queue.Stop(); }};
+    node.Release();
+    stopper.join();
+
+    EXPECT_EQ(queue.Pending(), 0);
+    size_t sent = 0;
+    for (const auto& batch : node.Batches()) {
+        sent += batch.size();
+    }
+    EXPECT_EQ(sent, 5);
+}
+
+// 节点下线后停止队列：发送失败时不再等待重试，丢弃剩余的通知，之后的失效通知也不再入队
+TEST(InvalidationQueueTest, StopAfterPeerRemoved) {
+    FakeNode node;
+    node.FailTimes(1 << 20);
+    InvalidationQueue queue{"node", node.Sender(), 16, std::chrono::seconds(60)};
+    queue.Push("g", "k0");
+    queue.Push("g", "k1");
+    ASSERT_TRUE(WaitFor([&] { return !node.Batches().empty(); }));
+
+    auto start = std::chrono::steady_clock::now();
+    queue.Stop();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_EQ(queue.Pending(), 0);
+
+    auto sent = node.Batches().size();
+    queue.Push("g", "k2");
+    EXPECT_EQ(queue.Pending(), 0);
+    queue.Stop();
+    EXPECT_EQ(node.Batches().size(), sent);
+}
@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <fmt/format.h>
+
+#include "kcache/cache.h"
+#include "kcache/log.h"
+
+using namespace kcache;
+
+// 同一秒内超出限额的日志被丢弃并计数，下一秒放行时取走丢弃的条数
+TEST(LogTest, RateLimiterSuppressesBurst) {
+    LogRateLimiter limiter{3};
+    int allowed = 0;
+    int64_t suppressed = 0;
+    auto start = NowNs() / 1000000000;
+    for (int i = 0; i < 10; ++i) {
+        allowed += limiter.Allow(&suppressed) ? 1 : 0;
+    }
+    if (NowNs() / 1000000000 != start) {
+        GTEST_SKIP() << "crossed a second boundary";
+    }
+    EXPECT_EQ(allowed, 3);
+    EXPECT_EQ(suppressed, 0);
+}
+
+// 短值原样输出，长值只输出前缀和总长度
+TEST(LogTest, FormatByteView) {
+    EXPECT_EQ(fmt::format("{}", ByteView{"hello"}), "hello");
+    std::string long_value(kLogValuePreview + 10, 'x');
+    EXPECT_EQ(fmt::format("{}", ByteView{long_value}),
+              std::string(kLogValuePreview, 'x') + "...(" + std::to_string(long_value.size()) + " bytes)");
+}
@@ -61,4 +61,149 @@ TEST(LRUCacheTest, TestEvictedFunc) {
 
     std::vector<kcache::Entry> expected{{"key1", kcache::ByteView{"123456"}}, {"k2", kcache::ByteView{"v2"}}};
     EXPECT_EQ(kvs, expected);
-}
\ No newline at end of file
+}
+TEST(LRUCacheTest, TestSetIfAbsent) {
+    kcache::LRUCache cache{100, nullptr};
+    EXPECT_TRUE(cache.SetIfAbsent("k", kcache::ByteView{"v1"}));
+    // 已存在的 key 不会被覆盖
+    EXPECT_FALSE(cache.SetIfAbsent("k", kcache::ByteView{"v2"}));
+    EXPECT_EQ(cache.Get("k").value().ToString(), "v1");
+}
+
+TEST(LRUCacheTest, TestPeekAndKeys) {
+    kcache::LRUCache cache{100, nullptr};
+    cache.Set("a", kcache::ByteView{"1"});
+    cache.Set("b", kcache::ByteView{"2"});
+    cache.Set("c", kcache::ByteView{"3"});
+
+    // Peek 不改变淘汰顺序，Keys 按最近使用顺序返回
+    EXPECT_EQ(cache.Peek("a").value().ToString(), "1");
+    EXPECT_EQ(cache.Keys(), (std::vector<std::string>{"c", "b", "a"}));
+
+    cache.Get("a");
+    EXPECT_EQ(cache.Keys(2), (std::vector<std::string>{"a", "c"}));
+    EXPECT_EQ(cache.Peek("missing"), std::nullopt);
+
+    // 已过期的 key 不返回，也不占 limit 的名额
+    cache.Set("d", kcache::ByteView{"4"}, kcache::NowNs() - 1);
+    EXPECT_EQ(cache.Keys(2), (std::vector<std::string>{"a", "c"}));
+}
+
+TEST(LRUCacheTest, TestExpiredEntry) {
+    kcache::LRUCache cache{100, nullptr};
+    cache.Set("k", kcache::ByteView{"v"}, kcache::NowNs() - 1);
+    // Get 不返回过期数据，Lookup 仍能拿到过期的缓存项
+    EXPECT_EQ(cache.Get("k"), std::nullopt);
+    auto entry = cache.Lookup("k");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_TRUE(entry->IsExpired(kcache::NowNs()));
+    EXPECT_EQ(entry->value_.ToString(), "v");
+}
+
+TEST(LRUCacheTest, TestFlush) {
+    std::vector<std::string> evicted;
+    kcache::LRUCache cache{100, [&](std::string key, kcache::ByteView) { evicted.push_back(key); }};
+    cache.Set("k1", kcache::ByteView{"v1"});
+    cache.Set("k2", kcache::ByteView{"v2"});
+    cache.Set("k3", kcache::ByteView{"v3"});
+
+    cache.Flush();
+    // 旧数据立即不可见
+    EXPECT_EQ(cache.Peek("k2"), std::nullopt);
+    EXPECT_TRUE(cache.Keys().empty());
+    EXPECT_TRUE(cache.SetIfAbsent("k2", kcache::ByteView{"new"}));
+    EXPECT_EQ(cache.Get("k2")->ToString(), "new");
+
+    // 访问和写入时逐步回收旧数据
+    EXPECT_EQ(cache.Get("k1"), std::nullopt);
+    cache.Set("k4", kcache::ByteView{"v4"});
+    EXPECT_EQ(evicted.size(), 3);
+    EXPECT_EQ(cache.Keys(), (std::vector<std::string>{"k4", "k2"}));
+}
+
+// 回收已被 Flush 的旧数据不计入淘汰数
+TEST(LRUCacheTest, TestFlushedEntriesNotCountedAsEvictions) {
+    kcache::LRUCache cache{12};
+    cache.Set("k1", kcache::ByteView{"v1"});
+    cache.Set("k2", kcache::ByteView{"v2"});
+    cache.Set("k3", kcache::ByteView{"v3"});
+    cache.Flush();
+
+    cache.Set("k4", kcache::ByteView{"v4"});
+    cache.Set("k5", kcache::ByteView{"v5"});
+    cache.Set("k6", kcache::ByteView{"v6"});
+    EXPECT_EQ(cache.Evictions(), 0);
+
+    cache.Set("k7", kcache::ByteView{"v7"});
+    EXPECT_EQ(cache.Evictions(), 1);
+    EXPECT_EQ(cache.Peek("k4"), std::nullopt);
+}
+
+TEST(LRUCacheTest, TestUpdateVersion) {
+    kcache::LRUCache cache{100};
+    auto v1 = cache.Set("k1", kcache::ByteView{"1"});
+    auto entry = cache.PeekEntry("k1");
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->version_, v1);
+
+    // 读-改-写生成更大的版本号
+    auto updated = cache.Update("k1", [](const kcache::Entry* cur) -> kcache::ByteViewOptional {
+        return kcache::ByteView{cur->value_.ToString() + "2"};
+    });
+    ASSERT_TRUE(updated.has_value());
+    EXPECT_GT(updated->version_, v1);
+    EXPECT_EQ(cache.Get("k1")->ToString(), "12");
+
+    // 放弃写入时值和版本号都不变
+    EXPECT_FALSE(cache.Update("k1", [](const kcache::Entry*) { return kcache::ByteViewOptional{}; }).has_value());
+    EXPECT_EQ(cache.PeekEntry("k1")->version_, updated->version_);
+    EXPECT_EQ(cache.PeekEntry("missing"), std::nullopt);
+}
+
+// GDSF 策略下淘汰 访问次数 × 代价 / 大小 最小的缓存项，重新加载慢的缓存项比最近访问的便宜缓存项活得更久
+TEST(LRUCacheTest, TestGdsfKeepsCostlyEntries) {
+    kcache::LRUCache cache{30};
+    cache.SetPolicy(kcache::CachePolicy::kGdsf);
+    cache.Set("k1", kcache::ByteView{"12345678"}, 0, 500000);  // 每项 10 字节
+    cache.Set("k2", kcache::ByteView{"12345678"}, 0, 2000);
+    cache.Set("k3", kcache::ByteView{"12345678"}, 0, 1000);
+    cache.Get("k2");
+    cache.Get("k3");
+
+    // LRU 会淘汰最久未使用的 k1
+    cache.Set("k4", kcache::ByteView{"12345678"}, 0, 3000);
+    EXPECT_TRUE(cache.Peek("k1").has_value());
+    EXPECT_FALSE(cache.Peek("k3").has_value());
+
+    // 被淘汰的优先级成为新的基准，后写入的 k5 代价虽小，优先级却超过了没有再被访问的 k4
+    cache.Set("k5", kcache::ByteView{"12345678"}, 0, 2000);
+    EXPECT_FALSE(cache.Peek("k4").has_value());
+    EXPECT_TRUE(cache.Peek("k5").has_value());
+    EXPECT_EQ(cache.Evictions(), 2);
+
+    // 切回 LRU 后按访问顺序淘汰
+    cache.SetPolicy(kcache::CachePolicy::kLru);
+    EXPECT_EQ(cache.Policy(), kcache::CachePolicy::kLru);
+    cache.Set("k6", kcache::ByteView{"12345678"}, 0, 1000);
+    EXPECT_FALSE(cache.Peek("k1").has_value());
+}
+
+// 没有给出代价的新缓存项按平均代价估计；缓存之外的命中计入访问次数
+TEST(LRUCacheTest, TestGdsfEstimatesUnknownCost) {
+    kcache::LRUCache cache{40};
+    cache.SetPolicy(kcache::CachePolicy::kGdsf);
+    cache.Set("k1", kcache::ByteView{"12345678"}, 0, 1000);              // 优先级 100
+    cache.Set("k2", kcache::ByteView{"12345678"}, 0, 3000);              // 优先级 300
+    EXPECT_TRUE(cache.SetIfAbsent("k3", kcache::ByteView{"12345678"}));  // 按平均代价 2000 估计，优先级 200
+    cache.Set("k4", kcache::ByteView{"12345678"}, 0, 1500);              // 优先级 150
+
+    cache.Set("k5", kcache::ByteView{"12345678"}, 0, 2500);
+    EXPECT_FALSE(cache.Peek("k1").has_value());
+    EXPECT_TRUE(cache.Peek("k3").has_value());
+
+    // k4 在缓存之外被命中 10 次后优先级超过 k3
+    cache.AddFrequency("k4", 10);
+    cache.Set("k6", kcache::ByteView{"12345678"}, 0, 5000);
+    EXPECT_TRUE(cache.Peek("k4").has_value());
+    EXPECT_FALSE(cache.Peek("k3").has_value());
+}
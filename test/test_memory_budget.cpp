@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "kcache/ghost_cache.h"
+#include "kcache/group.h"
+#include "kcache/memory_budget.h"
+
+using namespace kcache;
+
+// 只保留最近淘汰的 max_bytes 字节，命中一次后移除
+TEST(GhostCacheTest, KeepsRecentEvictions) {
+    GhostCache ghost{20};
+    ghost.Add("a", 10);
+    ghost.Add("b", 10);
+    ghost.Add("c", 10);  // a 被挤出
+    EXPECT_FALSE(ghost.Hit("a"));
+    EXPECT_TRUE(ghost.Hit("b"));
+    EXPECT_FALSE(ghost.Hit("b"));
+    EXPECT_EQ(ghost.Hits(), 1);
+
+    ghost.SetMaxBytes(0);
+    EXPECT_FALSE(ghost.Hit("c"));
+}
+
+// 容量不足反复淘汰的缓存组从空闲的缓存组拿到容量，总量不变且不低于下限
+TEST(MemoryBudgetTest, MovesCapacityToThrashingGroup) {
+    auto getter = [](const std::string& key) -> ByteViewOptional { return ByteView{"0123456789"}; };
+    KCacheGroup busy("budget_busy", 100, getter);
+    KCacheGroup idle("budget_idle", 100, getter);
+
+    MemoryBudget budget{200, 30, std::chrono::milliseconds(0)};
+    ASSERT_TRUE(budget.Attach(&busy, 40));
+    ASSERT_TRUE(budget.Attach(&idle, 40));
+    EXPECT_EQ(budget.Unallocated(), 0);
+    EXPECT_FALSE(budget.Attach(&idle, 1));
+
+    // 每个缓存项 12 字节，10 个 key 循环访问需要 120 字节；幽灵缓存能记住最近淘汰的两个 key
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 10; ++i) {
+            busy.Get("k" + std::to_string(i));
+        }
+        budget.Rebalance();
+    }
+    EXPECT_GT(busy.GhostHits(), 0);
+    EXPECT_GE(busy.MaxBytes(), 120);
+    EXPECT_GE(idle.MaxBytes(), 40);
+    EXPECT_EQ(busy.MaxBytes() + idle.MaxBytes(), 200);
+}
+
+// 重复加入被拒绝；绕过预算修改的容量在下一轮被收回，通过预算调整时不超出剩余预算
+TEST(MemoryBudgetTest, KeepsTotalWithinBudget) {
+    auto getter = [](const std::string& key) -> ByteViewOptional { return ByteView{key}; };
+    KCacheGroup a("budget_a", 100, getter);
+    KCacheGroup b("budget_b", 100, getter);
+
+    MemoryBudget budget{300, 30, std::chrono::milliseconds(0)};
+    ASSERT_TRUE(budget.Attach(&a, 40));
+    EXPECT_FALSE(budget.Attach(&a, 40));
+    ASSERT_TRUE(budget.Attach(&b, 40));
+    EXPECT_EQ(a.Budget(), &budget);
+    EXPECT_EQ(budget.Unallocated(), 100);
+
+    a.SetMaxBytes(1000);
+    budget.Rebalance();
+    EXPECT_EQ(a.MaxBytes(), 200);
+    EXPECT_EQ(budget.Unallocated(), 0);
+
+    EXPECT_FALSE(budget.Resize(&b, 150));
+    EXPECT_FALSE(budget.Resize(&b, 10));
+    ASSERT_TRUE(budget.Resize(&a, 150));
+    EXPECT_TRUE(budget.Resize(&b, 150));
+    EXPECT_EQ(a.MaxBytes() + b.MaxBytes(), 300);
+
+    budget.Detach(&a);
+    EXPECT_EQ(a.Budget(), nullptr);
+    EXPECT_EQ(budget.Unallocated(), 150);
+}
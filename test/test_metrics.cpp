@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kcache/group.h"
+#include "kcache/metrics.h"
+
+using namespace kcache;
+
+// 多个线程并发累加，汇总后不丢失
+TEST(MetricsTest, ShardedCounterSumsAllShards) {
+    ShardedCounter counter;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&counter] {
+            for (int j = 0; j < 10000; ++j) {
+                ++counter;
+            }
+            counter += 5;
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(counter.Load(), 8 * 10005);
+}
+
+// 每个值都落在上界不小于它的桶里，且相对误差不超过 1/16
+TEST(MetricsTest, HistogramBucketsBoundValues) {
+    for (int64_t v : {0L, 1L, 31L, 32L, 33L, 1000L, 123456L, 1L << 30, (1L << 40) + 12345}) {
+        auto upper = LatencyHistogram::BucketUpperBound(LatencyHistogram::BucketIndex(v));
+        EXPECT_GE(upper, v);
+        EXPECT_LE(upper - v, v / 16 + 1);
+    }
+    EXPECT_EQ(LatencyHistogram::BucketIndex(1L << 50), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(MetricsTest, HistogramPercentiles) {
+    LatencyHistogram histogram;
+    for (int64_t i = 1; i <= 1000; ++i) {
+        histogram.Record(i * 1000);
+    }
+    auto summary = histogram.Snapshot().Summary();
+    EXPECT_EQ(summary.count, 1000);
+    EXPECT_NEAR(summary.p50, 500000, 500000 / 16);
+    EXPECT_NEAR(summary.p99, 990000, 990000 / 16);
+    EXPECT_NEAR(summary.max, 1000000, 1000000 / 16);
+}
+
+// 缓存组的指标按 Prometheus 文本格式输出，同名指标只有一组 HELP/TYPE
+TEST(MetricsTest, GroupMetricsRenderPrometheusText) {
+    auto& group = MakeCacheGroup("metrics_group", 1024, [](const std::string& key) -> ByteViewOptional {
+        return ByteView{"value"};
+    });
+    group.Get("k");
+    group.Get("k");
+
+    PrometheusWriter writer;
+    WriteGroupMetrics(&writer);
+    auto text = writer.Render();
+    EXPECT_NE(text.find("kcache_hits_total{group=\"metrics_group\",tier=\"local\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("kcache_misses_total{group=\"metrics_group\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("kcache_entries{group=\"metrics_group\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("kcache_latency_seconds_count{group=\"metrics_group\",path=\"load\"} 1\n"),
+              std::string::npos);
+    EXPECT_NE(text.find("le=\"+Inf\""), std::string::npos);
+    EXPECT_EQ(text.find("# TYPE kcache_hits_total"), text.rfind("# TYPE kcache_hits_total"));
+}
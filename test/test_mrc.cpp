@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "kcache/group.h"
+#include "kcache/mrc.h"
+
+using namespace kcache;
+
+// 循环访问 100 个 10 字节的 key：重用距离都是 1000 字节，容量够时除第一轮外全部命中，不够时全部未命中
+TEST(MissRatioCurveTest, CyclicAccessFullSampling) {
+    MissRatioCurve mrc{1000, 1.0};
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 100; ++i) {
+            auto key = "key" + std::to_string(i);
+            mrc.Record(key, 10);
+        }
+    }
+    EXPECT_NEAR(mrc.HitRatio(2000), 0.9, 1e-9);
+    EXPECT_EQ(mrc.HitRatio(500), 0);
+
+    auto curve = mrc.Curve(256, 1 << 20);
+    ASSERT_FALSE(curve.empty());
+    EXPECT_EQ(curve.front().cache_bytes, 256);
+    EXPECT_NEAR(curve.back().hit_ratio, 0.9, 1e-9);
+    EXPECT_LE(curve.back().cache_bytes, 2048);  // 更大的容量不会再提高命中率
+}
+
+// 跟踪的 key 数超过上限后降低采样率，按采样率放大后的距离仍然接近真实值
+TEST(MissRatioCurveTest, FixedSizeSamplingScalesDistance) {
+    MissRatioCurve mrc{200, 1.0};
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            mrc.Record("key" + std::to_string(i), 10);
+        }
+    }
+    EXPECT_LT(mrc.SampleRate(), 0.2);
+    // 真实的重用距离是 20000 字节
+    EXPECT_LT(mrc.HitRatio(10000), 0.1);
+    EXPECT_GT(mrc.HitRatio(40000), 0.8);
+}
+
+TEST(MissRatioCurveTest, GroupReportsCurve) {
+    GroupOptions opts;
+    WithMissRatioCurve(1000, 1.0)(&opts);
+    KCacheGroup group("mrc_group", 1 << 10, [](const std::string& key) -> ByteViewOptional { return ByteView{key}; },
+                      opts);
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 10; ++i) {
+            group.Get("k" + std::to_string(i));
+        }
+    }
+    auto curve = group.HitRatioCurve();
+    ASSERT_FALSE(curve.empty());
+    EXPECT_EQ(curve.front().cache_bytes, 64);
+    EXPECT_GT(curve.back().hit_ratio, 0.6);
+}
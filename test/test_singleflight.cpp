@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: MIT
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kcache/singleflight.h"
+
+using namespace kcache;
+
+// 并发请求同一个 key 只执行一次，所有调用方共享同一份结果
+TEST(SingleFlightTest, SharesResultBetweenCallers) {
+    SingleFlight sf;
+    std::atomic<int> calls{0};
+    auto launch = [&](const SingleFlight::FlightPtr& flight) {
+        ++calls;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        flight->Complete(ByteView{"value"});
+    };
+
+    const int N = 8;
+    std::vector<SingleFlight::SharedResult> results(N);
+    std::vector<std::thread> ths;
+    for (int i = 0; i < N; ++i) {
+        ths.emplace_back([&, i] { results[i] = sf.DoShared("key", launch); });
+    }
+    for (auto& t : ths) t.join();
+
+    EXPECT_EQ(calls.load(), 1);
+    for (auto& r : results) {
+        ASSERT_NE(r, nullptr);
+        EXPECT_EQ(r.get(), results[0].get());
+        EXPECT_EQ(r->value().ToString(), "value");
+    }
+}
+
+// 异常传递给所有调用方，并且不会让 key 卡在进行中
+TEST(SingleFlightTest, PropagatesException) {
+    SingleFlight sf;
+    EXPECT_THROW(sf.Do("key", []() -> SingleFlight::Result { throw std::runtime_error("boom"); }),
+                 std::runtime_error);
+
+    auto ret = sf.Do("key", [] { return SingleFlight::Result{ByteView{"ok"}}; });
+    ASSERT_TRUE(ret.has_value());
+    EXPECT_EQ(ret->ToString(), "ok");
+}
+
+// 等待者超时后返回，全部离开后这次调用被取消，之后的请求重新发起
+TEST(SingleFlightTest, TimeoutCancelsFlight) {
+    SingleFlight sf;
+    SingleFlight::FlightPtr pending;
+    auto ret = sf.DoShared(
+        "key", [&](const SingleFlight::FlightPtr& flight) { pending = flight; }, std::chrono::milliseconds(20));
+    EXPECT_EQ(ret, nullptr);
+    ASSERT_NE(pending, nullptr);
+    EXPECT_TRUE(pending->Cancelled());
+
+    std::atomic<int> calls{0};
+    ret = sf.DoShared("key", [&](const SingleFlight::FlightPtr& flight) {
+        ++calls;
+        flight->Complete(ByteView{"fresh"});
+    });
+    EXPECT_EQ(calls.load(), 1);
+    ASSERT_NE(ret, nullptr);
+    EXPECT_EQ(ret->value().ToString(), "fresh");
+
+    // 被取消的调用迟到的结果不会影响之后的请求
+    pending->Complete(ByteView{"late"});
+}
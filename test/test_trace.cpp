@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "kcache/group.h"
+#include "kcache/trace.h"
+
+using namespace kcache;
+
+// 写满后覆盖最旧的事件，导出的是最近 kCapacity 个
+TEST(TraceTest, RingKeepsLatestEvents) {
+    TraceRing ring{0};
+    for (uint64_t i = 1; i <= TraceRing::kCapacity + 10; ++i) {
+        ring.Push(i, TraceStage::kLoad, static_cast<int64_t>(i), 1);
+    }
+    std::vector<TraceEvent> events;
+    ring.Collect(&events);
+    ASSERT_EQ(events.size(), TraceRing::kCapacity);
+    EXPECT_EQ(events.front().trace_id, 11);
+    EXPECT_EQ(events.back().trace_id, TraceRing::kCapacity + 10);
+}
+
+// 被采样的未命中请求记录查缓存、等待 SingleFlight、回源和写缓存各阶段，关闭后不再记录
+TEST(TraceTest, SampledMissRecordsStages) {
+    KCacheGroup group("trace_group", 1024, [](const std::string& key) -> ByteViewOptional { return ByteView{key}; });
+
+    Tracer::SetSampleEvery(1);
+    ASSERT_TRUE(group.Get("key1").has_value());
+    Tracer::SetSampleEvery(0);
+
+    auto traces = Tracer::Dump(1);
+    ASSERT_EQ(traces.size(), 1);
+    std::vector<std::string> stages;
+    for (const auto& event : traces[0].events) {
+        stages.emplace_back(TraceStageName(event.stage));
+    }
+    for (const auto* stage : {"group_get", "cache_lock", "cache_lookup", "singleflight", "load", "cache_insert"}) {
+        EXPECT_NE(std::find(stages.begin(), stages.end(), stage), stages.end()) << stage;
+    }
+    EXPECT_EQ(Tracer::Current(), 0);
+
+    ASSERT_TRUE(group.Get("key2").has_value());
+    EXPECT_EQ(Tracer::Dump(0).size(), 1);
+}
@@ -0,0 +1,260 @@
+// 离线缓存模拟器：把 node_server 通过 --access_trace 记录的访问轨迹按不同的节点数回放，
+// 路由使用真实的一致性哈希环，每个模拟节点使用真实的缓存实现，用来在上线前评估淘汰策略和哈希环的改动
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <queue>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fmt/core.h>
+#include <gflags/gflags.h>
+
+#include "kcache/access_trace.h"
+#include "kcache/cache.h"
+#include "kcache/consistent_hash.h"
+
+using namespace kcache;
+
+DEFINE_string(trace, "", "访问轨迹文件");
+DEFINE_string(nodes, "1,2,4,8", "模拟的节点数，逗号分隔");
+DEFINE_int64(cache_mb, 64, "每个节点的缓存容量（MB），按轨迹的采样率等比缩小");
+DEFINE_string(policy, "lru", "淘汰策略，可选值：lru, gdsf");
+DEFINE_int32(load_latency_ms, 0, "模拟的回源延迟（毫秒），期间同一个 key 的未命中合并为一次回源");
+DEFINE_int32(replicas, 50, "每个节点的虚拟节点数");
+
+namespace {
+
+struct SimResult {
+    int64_t gets{0};
+    int64_t hits{0};
+    int64_t get_bytes{0};
+    int64_t hit_bytes{0};
+    int64_t loads{0};
+    int64_t deduplicated{0};  // 等待进行中的回源而没有再次回源的未命中
+    int64_t load_us{0};       // 全部回源的总耗时
+    double imbalance{0};      // 请求最多的节点相对平均值的倍数
+};
+
+auto NodeName(int i) -> std::string { return fmt::format("node-{}", i); }
+
+auto MakeRing(int nodes) -> std::unique_ptr<ConsistentHashMap> {
+    auto cfg = kDefaultConfig;
+    cfg.replicas = FLAGS_replicas;
+    cfg.max_replicas = std::max(cfg.max_replicas, FLAGS_replicas);
+    cfg.auto_rebalance = false;
+    auto ring = std::make_unique<ConsistentHashMap>(cfg);
+    std::vector<std::string> names;
+    for (int i = 0; i < nodes; ++i) {
+        names.push_back(NodeName(i));
+    }
+    ring->Add(names);
+    return ring;
+}
+
+auto MakeCache(int64_t bytes, CachePolicy policy) -> std::unique_ptr<LRUCache> {
+    auto cache = std::make_unique<LRUCache>(static_cast<int>(std::min<int64_t>(bytes, INT_MAX)));
+    cache->SetPolicy(policy);
+    return cache;
+}
+
+auto MakeValue(const AccessRecord& record) -> ByteView {
+    return ByteView{std::string(std::max<int64_t>(record.bytes - record.key.size(), 0), 'v')};
+}
+
+// 每个 key 的回源耗时（微秒）：取轨迹中该 key 最后一次记录的回源耗时，轨迹中没有回源过的 key 按平均耗时估计
+class LoadCosts {
+public:
+    explicit LoadCosts(const std::vector<AccessRecord>& records) {
+        int64_t total = 0;
+        int64_t n = 0;
+        for (const auto& record : records) {
+            if (record.cost_us > 0) {
+                costs_[record.key] = record.cost_us;
+                total += record.cost_us;
+                ++n;
+            }
+        }
+        mean_ = n > 0 ? total / n : 0;
+    }
+
+    auto Get(const std::string& key) const -> int64_t {
+        auto it = costs_.find(key);
+        return it != costs_.end() ? it->second : mean_;
+    }
+
+private:
+    std::unordered_map<std::string, int64_t> costs_;
+    int64_t mean_{0};
+};
+
+// 按 nodes 个节点回放一遍轨迹
+auto Replay(const std::vector<AccessRecord>& records, const LoadCosts& costs, int nodes, int64_t cache_bytes,
+            CachePolicy policy) -> SimResult {
+    auto ring = MakeRing(nodes);
+    std::unordered_map<std::string, int> index;
+    std::vector<std::unique_ptr<LRUCache>> caches;
+    for (int i = 0; i < nodes; ++i) {
+        index[NodeName(i)] = i;
+        caches.push_back(MakeCache(cache_bytes, policy));
+    }
+    std::vector<int64_t> requests(nodes);
+
+    // 进行中的回源：(完成时间, 记录下标)，完成时写入 owner 节点的缓存；inflight 记录每个 key 当前有效的回源，
+    // 回源期间 key 被写入或删除时取消这次回源，完成后不会用旧值覆盖新值
+    using Pending = std::pair<int64_t, size_t>;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<>> pending;
+    std::unordered_map<std::string, size_t> inflight;
+    auto latency_us = int64_t{FLAGS_load_latency_ms} * 1000;
+    auto complete = [&](int64_t now_us) {
+        while (!pending.empty() && pending.top().first <= now_us) {
+            auto i = pending.top().second;
+            pending.pop();
+            const auto& record = records[i];
+            auto it = inflight.find(record.key);
+            if (it == inflight.end() || it->second != i) {
+                continue;
+            }
+            inflight.erase(it);
+            caches[index[ring->Get(record.key)]]->Set(record.key, MakeValue(record), 0, costs.Get(record.key) * 1000);
+        }
+    };
+
+    SimResult result;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const auto& record = records[i];
+        complete(record.timestamp_us);
+        auto node = index[ring->Get(record.key)];
+        ++requests[node];
+        auto& cache = caches[node];
+        switch (record.op) {
+            case AccessOp::kGet: {
+                ++result.gets;
+                result.get_bytes += record.bytes;
+                if (cache->Get(record.key)) {
+                    ++result.hits;
+                    result.hit_bytes += record.bytes;
+                } else if (inflight.count(record.key)) {
+                    ++result.deduplicated;
+                } else {
+                    ++result.loads;
+                    result.load_us += record.cost_us > 0 ? record.cost_us : costs.Get(record.key);
+                    inflight[record.key] = i;
+                    pending.emplace(record.timestamp_us + latency_us, i);
+                    complete(record.timestamp_us);
+                }
+                break;
+            }
+            case AccessOp::kGetMiss:
+                // 数据不存在或回源失败，无论缓存多大都不会命中，只计入读取数和回源耗时
+                ++result.gets;
+                if (record.cost_us > 0) {
+                    ++result.loads;
+                    result.load_us += record.cost_us;
+                }
+                break;
+            case AccessOp::kSet:
+                inflight.erase(record.key);
+                cache->Set(record.key, MakeValue(record));
+                break;
+            case AccessOp::kDelete:
+                inflight.erase(record.key);
+                cache->Delete(record.key);
+                break;
+        }
+    }
+
+    auto mean = static_cast<double>(records.size()) / nodes;
+    if (mean > 0) {
+        result.imbalance = *std::max_element(requests.begin(), requests.end()) / mean;
+    }
+    return result;
+}
+
+// 节点数从 from 变为 to 时归属发生变化的 key 的比例
+auto MovedRatio(const std::unordered_set<std::string>& keys, int from, int to) -> double {
+    if (keys.empty() || from == 0 || to == 0) {
+        return 0;
+    }
+    auto before = MakeRing(from);
+    auto after = MakeRing(to);
+    int64_t moved = 0;
+    for (const auto& key : keys) {
+        if (before->Get(key) != after->Get(key)) {
+            ++moved;
+        }
+    }
+    return static_cast<double>(moved) / keys.size();
+}
+
+auto ParseNodes(const std::string& flag) -> std::vector<int> {
+    std::vector<int> nodes;
+    size_t begin = 0;
+    while (begin <= flag.size()) {
+        auto end = flag.find(',', begin);
+        if (end == std::string::npos) {
+            end = flag.size();
+        }
+        if (end > begin) {
+            auto n = std::stoi(flag.substr(begin, end - begin));
+            if (n > 0) {
+                nodes.push_back(n);
+            }
+        }
+        begin = end + 1;
+    }
+    return nodes;
+}
+
+auto Ratio(int64_t part, int64_t total) -> double { return total > 0 ? static_cast<double>(part) / total : 0; }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+    CachePolicy policy;
+    if (!ParseCachePolicy(FLAGS_policy, &policy)) {
+        fmt::print(stderr, "unsupported eviction policy: {}\n", FLAGS_policy);
+        return 1;
+    }
+    AccessTraceReader reader{FLAGS_trace};
+    if (!reader.IsValid()) {
+        fmt::print(stderr, "invalid access trace: {}\n", FLAGS_trace);
+        return 1;
+    }
+    std::vector<AccessRecord> records;
+    std::unordered_set<std::string> keys;
+    AccessRecord record;
+    while (reader.Next(&record)) {
+        keys.insert(record.key);
+        records.push_back(record);
+    }
+    auto nodes = ParseNodes(FLAGS_nodes);
+    if (records.empty() || nodes.empty()) {
+        fmt::print(stderr, "nothing to simulate\n");
+        return 1;
+    }
+
+    // 轨迹只包含采样的 key，容量按同样的比例缩小后，命中率与完整访问下的命中率一致
+    auto rate = reader.SampleRate();
+    auto cache_bytes = static_cast<int64_t>(static_cast<double>(FLAGS_cache_mb << 20) * rate);
+    fmt::print("trace: {}, records: {}, keys: {}, sample rate: {:.4f}, policy: {}, cache per node: {} MB\n",
+               FLAGS_trace, records.size(), keys.size(), rate, FLAGS_policy, FLAGS_cache_mb);
+    LoadCosts costs{records};
+    fmt::print("{:>6} {:>10} {:>15} {:>10} {:>10} {:>12} {:>10} {:>14} {:>14}\n", "nodes", "hit_ratio",
+               "byte_hit_ratio", "loads", "dedup", "load_time_s", "imbalance", "moved_on_join", "moved_on_leave");
+    for (auto n : nodes) {
+        auto result = Replay(records, costs, n, cache_bytes, policy);
+        auto leave = n > 1 ? fmt::format("{:.4f}", MovedRatio(keys, n, n - 1)) : std::string{"-"};
+        fmt::print("{:>6} {:>10.4f} {:>15.4f} {:>10} {:>10} {:>12.3f} {:>10.3f} {:>14.4f} {:>14}\n", n,
+                   Ratio(result.hits, result.gets), Ratio(result.hit_bytes, result.get_bytes), result.loads,
+                   result.deduplicated, result.load_us / 1e6, result.imbalance, MovedRatio(keys, n, n + 1), leave);
+    }
+    return 0;
+}